@@ -0,0 +1,183 @@
+#include "asdu_packer.h"
+
+void
+ASDUPacker_init(ASDUPacker self, CS101_AppLayerParameters alParams, CS101_CauseOfTransmission cot, int oa, int ca,
+        ASDUPacker_SendHandler handler, void* parameter)
+{
+    self->alParams = alParams;
+    self->cot = cot;
+    self->oa = oa;
+    self->ca = ca;
+    self->sendHandler = handler;
+    self->sendHandlerParameter = parameter;
+    self->maxObjects = 0;
+    self->useSequence = true;
+    self->asdu = NULL;
+    self->aborted = false;
+    self->asduCount = 0;
+    self->objectCount = 0;
+}
+
+bool
+ASDUPacker_flush(ASDUPacker self)
+{
+    if (self->asdu) {
+        int elements = CS101_ASDU_getNumberOfElements(self->asdu);
+
+        if (self->aborted == false) {
+            if (self->sendHandler(self->sendHandlerParameter, self->asdu)) {
+                self->asduCount++;
+                self->objectCount += elements;
+            }
+            else
+                self->aborted = true;
+        }
+
+        self->asdu = NULL;
+    }
+
+    return (self->aborted == false);
+}
+
+static void
+openASDU(ASDUPacker self, TypeID type, bool isSequence)
+{
+    self->asdu = CS101_ASDU_initializeStatic(&(self->asduStorage), self->alParams, isSequence, self->cot,
+            self->oa, self->ca, false, false);
+    self->asduType = type;
+    self->asduIsSequence = isSequence;
+}
+
+static bool
+addObject(ASDUPacker self, InformationObject io, TypeID type, bool startSequence)
+{
+    int ioa = InformationObject_getObjectAddress(io);
+
+    if (self->asdu) {
+        int limit = ((self->maxObjects > 0) && (self->maxObjects < ASDU_PACKER_MAX_OBJECTS)) ?
+                self->maxObjects : ASDU_PACKER_MAX_OBJECTS;
+
+        bool closeASDU;
+
+        if ((self->asduType != type) || (CS101_ASDU_getNumberOfElements(self->asdu) >= limit))
+            closeASDU = true;
+        else if (self->asduIsSequence)
+            closeASDU = (ioa != self->nextIOA);
+        else
+            closeASDU = startSequence;
+
+        if (closeASDU) {
+            if (!ASDUPacker_flush(self))
+                return false;
+        }
+    }
+
+    if (self->asdu == NULL)
+        openASDU(self, type, startSequence);
+
+    if (CS101_ASDU_addInformationObject(self->asdu, io) == false) {
+        /* ASDU is full */
+        if (!ASDUPacker_flush(self))
+            return false;
+
+        openASDU(self, type, startSequence);
+
+        CS101_ASDU_addInformationObject(self->asdu, io);
+    }
+
+    self->nextIOA = ioa + 1;
+
+    return true;
+}
+
+bool
+ASDUPacker_addPoint(ASDUPacker self, PointDB db, int index, TypeID type)
+{
+    if (self->aborted)
+        return false;
+
+    InformationObject io = PointDB_getInformationObject(db, index, type, (InformationObject) &(self->ioStorage));
+
+    if (io == NULL)
+        return true;
+
+    return addObject(self, io, type, false);
+}
+
+static TypeID
+getEncodedType(PointDB db, int index, bool untimed)
+{
+    TypeID type = (TypeID) db->type[index];
+
+    return untimed ? PointDB_getUntimedType(type) : type;
+}
+
+/* add the points at positions [start, end) of the index list (or of the table if indexes is NULL) */
+static bool
+addPointRange(ASDUPacker self, PointDB db, const int32_t* indexes, int start, int end, bool untimed)
+{
+    int runEnd = start; /* end (exclusive) of the run of consecutive IOAs containing position k */
+    int k;
+
+    for (k = start; k < end; k++) {
+        int index = indexes ? indexes[k] : k;
+
+        if (!PointDB_isMonitoredType((TypeID) db->type[index]))
+            continue;
+
+        TypeID type = getEncodedType(db, index, untimed);
+
+        if (k >= runEnd) {
+            runEnd = k + 1;
+
+            if (self->useSequence) {
+                int last = index;
+
+                while (runEnd < end) {
+                    int next = indexes ? indexes[runEnd] : runEnd;
+
+                    if ((db->ioa[next] != db->ioa[last] + 1) || (getEncodedType(db, next, untimed) != type))
+                        break;
+
+                    last = next;
+                    runEnd++;
+                }
+            }
+        }
+
+        if (self->aborted)
+            return false;
+
+        InformationObject io = PointDB_getInformationObject(db, index, type, (InformationObject) &(self->ioStorage));
+
+        if (io == NULL)
+            continue;
+
+        if (!addObject(self, io, type, (runEnd - k) >= ASDU_PACKER_MIN_SEQUENCE))
+            return false;
+    }
+
+    return true;
+}
+
+bool
+ASDUPacker_addPoints(ASDUPacker self, PointDB db, const int32_t* indexes, int count, bool untimed)
+{
+    return addPointRange(self, db, indexes, 0, count, untimed);
+}
+
+bool
+ASDUPacker_addPointRange(ASDUPacker self, PointDB db, const int32_t* indexes, int start, int end, bool untimed)
+{
+    return addPointRange(self, db, indexes, start, end, untimed);
+}
+
+bool
+ASDUPacker_addMonitoredPoints(ASDUPacker self, PointDB db)
+{
+    /* integrated totals are not part of a GI response and are sorted into one range */
+    if (!addPointRange(self, db, NULL, 0, db->counterFirst, true))
+        return false;
+
+    return addPointRange(self, db, NULL, db->counterFirst + db->counterCount, PointDB_getCount(db), true);
+}
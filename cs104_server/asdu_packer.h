@@ -0,0 +1,113 @@
+#ifndef ASDU_PACKER_H_
+#define ASDU_PACKER_H_
+
+#include <stdbool.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+
+/*
+ * Packs information objects of consecutive points into as few ASDUs as
+ * possible. An ASDU holds objects of one type only and is filled up to the
+ * maxSizeOfASDU of the application layer parameters. A new ASDU is opened
+ * when the current one is full or the type changes.
+ *
+ * Runs of consecutive IOAs of the same type are sent as sequence ASDUs
+ * (SQ=1) where only the first object carries its IOA. Sparse points are
+ * sent with SQ=0.
+ */
+
+/**
+ * Called for every completed ASDU. The ASDU is only valid during the call.
+ *
+ * \return false to abort packing (e.g. the connection is gone)
+ */
+typedef bool (*ASDUPacker_SendHandler)(void* parameter, CS101_ASDU asdu);
+
+typedef struct sASDUPacker* ASDUPacker;
+
+struct sASDUPacker {
+    CS101_AppLayerParameters alParams;
+    CS101_CauseOfTransmission cot;
+    int oa;
+    int ca;
+
+    ASDUPacker_SendHandler sendHandler;
+    void* sendHandlerParameter;
+
+    /* upper limit of objects per ASDU, 0 = as many as fit */
+    int maxObjects;
+
+    /* use SQ=1 ASDUs for runs of consecutive IOAs (default: true) */
+    bool useSequence;
+
+    struct sCS101_StaticASDU asduStorage;
+    CS101_ASDU asdu;    /* ASDU being filled or NULL */
+    TypeID asduType;
+    bool asduIsSequence;
+    int nextIOA;        /* IOA that continues the sequence ASDU */
+
+    PointIOBuffer ioStorage;
+
+    bool aborted;
+
+    /* statistics */
+    int asduCount;
+    int objectCount;
+};
+
+/* Number of objects is encoded in 7 bits of the VSQ */
+#define ASDU_PACKER_MAX_OBJECTS 127
+
+/*
+ * Shortest run of consecutive IOAs that starts a sequence ASDU. Shorter runs
+ * save less IOA bytes than an additional ASDU costs (APCI + ASDU header).
+ */
+#define ASDU_PACKER_MIN_SEQUENCE 6
+
+void
+ASDUPacker_init(ASDUPacker self, CS101_AppLayerParameters alParams, CS101_CauseOfTransmission cot, int oa, int ca,
+        ASDUPacker_SendHandler handler, void* parameter);
+
+/**
+ * Add the point with the given index encoded as type. A single point never
+ * starts a sequence ASDU but continues one when its IOA is the next in it.
+ *
+ * \return false when the send handler aborted packing
+ */
+bool
+ASDUPacker_addPoint(ASDUPacker self, PointDB db, int index, TypeID type);
+
+/**
+ * Add the monitored points of a list of point indexes (ordered by type and
+ * IOA for best packing). Runs of consecutive IOAs are sent as sequence ASDUs.
+ * The caller holds the table lock.
+ *
+ * \param indexes point indexes, or NULL for the first count points of the table
+ * \param untimed encode time tagged types with their untimed variant (GI, cyclic)
+ */
+bool
+ASDUPacker_addPoints(ASDUPacker self, PointDB db, const int32_t* indexes, int count, bool untimed);
+
+/**
+ * Like ASDUPacker_addPoints, for the list positions [start, end) only. A
+ * response refused by the connection continues at start = the number of
+ * objects sent before (see objectCount).
+ */
+bool
+ASDUPacker_addPointRange(ASDUPacker self, PointDB db, const int32_t* indexes, int start, int end, bool untimed);
+
+/**
+ * Add all monitored points of the table with their untimed types (GI response).
+ * The caller holds the table lock.
+ */
+bool
+ASDUPacker_addMonitoredPoints(ASDUPacker self, PointDB db);
+
+/**
+ * Send the ASDU currently being filled.
+ */
+bool
+ASDUPacker_flush(ASDUPacker self);
+
+#endif /* ASDU_PACKER_H_ */
@@ -0,0 +1,44 @@
+#include <stdlib.h>
+
+#include "ca_router.h"
+
+CARouter
+CARouter_create(void)
+{
+    return (CARouter) calloc(1, sizeof(struct sCARouter));
+}
+
+void
+CARouter_destroy(CARouter self)
+{
+    if (self) {
+        int i;
+        for (i = 0; i < CA_ROUTER_PAGE_SIZE; i++)
+            free(self->pages[i]);
+
+        free(self);
+    }
+}
+
+bool
+CARouter_add(CARouter self, int ca, void* target)
+{
+    if ((ca < 0) || (ca > 0xffff) || (target == NULL))
+        return false;
+
+    if (CARouter_lookup(self, ca))
+        return false;
+
+    void*** page = &(self->pages[ca >> 8]);
+
+    if (*page == NULL) {
+        *page = (void**) calloc(CA_ROUTER_PAGE_SIZE, sizeof(void*));
+
+        if (*page == NULL)
+            return false;
+    }
+
+    (*page)[ca & 0xff] = target;
+
+    return true;
+}
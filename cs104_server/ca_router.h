@@ -0,0 +1,52 @@
+#ifndef CA_ROUTER_H_
+#define CA_ROUTER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Maps the common address (CA) of a received ASDU to the logical station
+ * serving it.
+ *
+ * The 16 bit address space is split into 256 pages of 256 entries. Pages
+ * are allocated only for ranges that contain a station, so a lookup is two
+ * array accesses and a few stations cost a few kB regardless of their
+ * addresses. Broadcast requests are not routed, the endpoint fans them out
+ * to its own list of stations.
+ */
+
+#define CA_ROUTER_PAGE_SIZE 256
+
+typedef struct sCARouter* CARouter;
+
+struct sCARouter {
+    void** pages[CA_ROUTER_PAGE_SIZE];
+};
+
+CARouter
+CARouter_create(void);
+
+void
+CARouter_destroy(CARouter self);
+
+/**
+ * \param ca common address 0..65535
+ * \param target the station serving the address
+ *
+ * \return false when the address is already routed or out of range
+ */
+bool
+CARouter_add(CARouter self, int ca, void* target);
+
+/**
+ * \return the station serving the address, NULL when the address is unknown
+ */
+static inline void*
+CARouter_lookup(CARouter self, int ca)
+{
+    void** page = self->pages[(ca >> 8) & 0xff];
+
+    return page ? page[ca & 0xff] : NULL;
+}
+
+#endif /* CA_ROUTER_H_ */
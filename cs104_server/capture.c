@@ -0,0 +1,470 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include "capture.h"
+
+#define PCAP_MAGIC 0xa1b2c3d4
+#define PCAP_LINKTYPE_RAW 101       /* packets start with the IPv4 header */
+
+#define IP_HEADER_SIZE 20
+#define TCP_HEADER_SIZE 20
+
+#define TCP_FIN 0x01
+#define TCP_SYN 0x02
+#define TCP_PSH 0x08
+#define TCP_ACK 0x10
+
+typedef struct {
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLength;
+    uint32_t linkType;
+} PcapFileHeader;
+
+typedef struct {
+    uint32_t seconds;
+    uint32_t microseconds;
+    uint32_t capturedLength;
+    uint32_t length;
+} PcapRecordHeader;
+
+static uint64_t
+getTimeInUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+/* "a.b.c.d" to host byte order, 0 when not an IPv4 address */
+static uint32_t
+parseAddress(const char* text)
+{
+    struct in_addr address;
+
+    if (text && (inet_pton(AF_INET, text, &address) == 1))
+        return ntohl(address.s_addr);
+
+    return 0;
+}
+
+Capture
+Capture_create(const char* path, uint64_t maxFileSize, int maxFiles, int maxConnections, int ringSize)
+{
+    Capture self = (Capture) calloc(1, sizeof(struct sCapture));
+
+    if (self) {
+        int size = 1;
+
+        if (ringSize <= 0)
+            ringSize = CAPTURE_DEFAULT_RING_SIZE;
+        while (size < ringSize)
+            size <<= 1;
+
+        if (maxConnections <= 0)
+            maxConnections = CAPTURE_DEFAULT_CONNECTIONS;
+
+        self->path = strdup(path);
+        self->maxFileSize = maxFileSize;
+        self->maxFiles = (maxFiles > 0) ? maxFiles : 1;
+        self->streams = (struct sCaptureStream*) calloc(maxConnections, sizeof(struct sCaptureStream));
+        self->streamCount = maxConnections;
+        self->ringSize = size;
+    }
+
+    return self;
+}
+
+static bool
+openFile(Capture self)
+{
+    self->file = fopen(self->path, "wb");
+
+    if (self->file == NULL)
+        return false;
+
+    /* the frames are small, let stdio batch them */
+    setvbuf(self->file, NULL, _IOFBF, 1 << 20);
+
+    PcapFileHeader header;
+    header.magic = PCAP_MAGIC;
+    header.versionMajor = 2;
+    header.versionMinor = 4;
+    header.thisZone = 0;
+    header.sigFigs = 0;
+    header.snapLength = 65535;
+    header.linkType = PCAP_LINKTYPE_RAW;
+
+    fwrite(&header, sizeof(header), 1, self->file);
+    self->fileSize = sizeof(header);
+
+    return true;
+}
+
+/* path -> path.1 -> path.2 ..., the oldest is removed */
+static void
+rotate(Capture self)
+{
+    size_t nameSize = strlen(self->path) + 16;
+    char* from = (char*) malloc(nameSize);
+    char* to = (char*) malloc(nameSize);
+
+    fclose(self->file);
+    self->file = NULL;
+
+    if (self->maxFiles > 1) {
+        snprintf(from, nameSize, "%s.%d", self->path, self->maxFiles - 1);
+        remove(from);
+
+        for (int i = self->maxFiles - 2; i >= 1; i--) {
+            snprintf(from, nameSize, "%s.%d", self->path, i);
+            snprintf(to, nameSize, "%s.%d", self->path, i + 1);
+            rename(from, to);
+        }
+
+        snprintf(to, nameSize, "%s.1", self->path);
+        rename(self->path, to);
+    }
+
+    free(from);
+    free(to);
+
+    self->rotations++;
+
+    openFile(self);
+}
+
+static uint16_t
+ipChecksum(const uint8_t* header)
+{
+    uint32_t sum = 0;
+
+    for (int i = 0; i < IP_HEADER_SIZE; i += 2)
+        sum += (uint32_t) ((header[i] << 8) | header[i + 1]);
+
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+
+    return (uint16_t) ~sum;
+}
+
+static void
+putUInt16(uint8_t* buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t) (value >> 8);
+    buffer[1] = (uint8_t) value;
+}
+
+static void
+putUInt32(uint8_t* buffer, uint32_t value)
+{
+    putUInt16(buffer, (uint16_t) (value >> 16));
+    putUInt16(buffer + 2, (uint16_t) value);
+}
+
+/* one IPv4/TCP packet of the connection, sequence numbers advance by the payload */
+static void
+writeSegment(Capture self, CaptureStream stream, uint64_t timestamp, bool fromServer, uint8_t flags,
+        const uint8_t* data, int length)
+{
+    uint8_t headers[IP_HEADER_SIZE + TCP_HEADER_SIZE];
+    int packetSize = IP_HEADER_SIZE + TCP_HEADER_SIZE + length;
+
+    if ((self->file) && (self->maxFileSize > 0) &&
+            (self->fileSize + sizeof(PcapRecordHeader) + packetSize > self->maxFileSize))
+        rotate(self);
+
+    if (self->file == NULL)
+        return;
+
+    uint32_t* sequence = fromServer ? &(stream->serverSequence) : &(stream->peerSequence);
+    uint32_t acknowledgement = fromServer ? stream->peerSequence : stream->serverSequence;
+
+    uint8_t* ip = headers;
+    ip[0] = 0x45;       /* IPv4, 20 byte header */
+    ip[1] = 0;
+    putUInt16(ip + 2, (uint16_t) packetSize);
+    putUInt16(ip + 4, self->ipIdentification++);
+    putUInt16(ip + 6, 0x4000);  /* don't fragment */
+    ip[8] = 64;
+    ip[9] = 6;          /* TCP */
+    putUInt16(ip + 10, 0);
+    putUInt32(ip + 12, fromServer ? stream->localAddress : stream->peerAddress);
+    putUInt32(ip + 16, fromServer ? stream->peerAddress : stream->localAddress);
+    putUInt16(ip + 10, ipChecksum(ip));
+
+    /* the TCP checksum is left 0, Wireshark does not verify it by default */
+    uint8_t* tcp = headers + IP_HEADER_SIZE;
+    memset(tcp, 0, TCP_HEADER_SIZE);
+    putUInt16(tcp, fromServer ? stream->localPort : stream->peerPort);
+    putUInt16(tcp + 2, fromServer ? stream->peerPort : stream->localPort);
+    putUInt32(tcp + 4, *sequence);
+    putUInt32(tcp + 8, (flags & TCP_ACK) ? acknowledgement : 0);
+    tcp[12] = (TCP_HEADER_SIZE / 4) << 4;
+    tcp[13] = flags;
+    putUInt16(tcp + 14, 65535);
+
+    PcapRecordHeader record;
+    record.seconds = (uint32_t) (timestamp / 1000000);
+    record.microseconds = (uint32_t) (timestamp % 1000000);
+    record.capturedLength = (uint32_t) packetSize;
+    record.length = (uint32_t) packetSize;
+
+    fwrite(&record, sizeof(record), 1, self->file);
+    fwrite(headers, sizeof(headers), 1, self->file);
+    if (length > 0)
+        fwrite(data, 1, length, self->file);
+
+    self->fileSize += sizeof(record) + packetSize;
+    self->bytes += sizeof(record) + packetSize;
+
+    /* SYN and FIN count as one byte */
+    *sequence += (uint32_t) length + ((flags & (TCP_SYN | TCP_FIN)) ? 1 : 0);
+}
+
+/* write the queued frames of one connection, return their count */
+static int
+drainStream(Capture self, CaptureStream stream)
+{
+    int state = __atomic_load_n(&(stream->state), __ATOMIC_ACQUIRE);
+
+    if ((state == CAPTURE_STREAM_FREE) || (state == CAPTURE_STREAM_OPENING))
+        return 0;
+
+    if (!stream->started) {
+        /* three-way handshake, so that Wireshark sees the start of the stream */
+        stream->peerSequence = stream->id * 0x10000;
+        stream->serverSequence = 0x80000000 + stream->id * 0x10000;
+
+        writeSegment(self, stream, stream->openTime, false, TCP_SYN, NULL, 0);
+        writeSegment(self, stream, stream->openTime, true, TCP_SYN | TCP_ACK, NULL, 0);
+        writeSegment(self, stream, stream->openTime, false, TCP_ACK, NULL, 0);
+
+        stream->started = true;
+    }
+
+    uint64_t head = __atomic_load_n(&(stream->head), __ATOMIC_ACQUIRE);
+    int count = 0;
+
+    while (stream->tail < head) {
+        CaptureFrame* frame = &(stream->frames[stream->tail & stream->mask]);
+
+        writeSegment(self, stream, frame->timestamp, frame->sent, TCP_PSH | TCP_ACK, frame->data, frame->length);
+
+        stream->tail++;
+        count++;
+    }
+
+    __atomic_store_n(&(stream->tail), head, __ATOMIC_RELEASE);
+
+    self->frames += count;
+
+    if (state == CAPTURE_STREAM_CLOSED) {
+        /* all frames were queued before the close */
+        writeSegment(self, stream, stream->closeTime, true, TCP_FIN | TCP_ACK, NULL, 0);
+        writeSegment(self, stream, stream->closeTime, false, TCP_FIN | TCP_ACK, NULL, 0);
+
+        stream->started = false;
+        stream->head = 0;
+        stream->tail = 0;
+        __atomic_store_n(&(stream->connection), NULL, __ATOMIC_RELAXED);
+        __atomic_store_n(&(stream->state), CAPTURE_STREAM_FREE, __ATOMIC_RELEASE);
+    }
+
+    return count;
+}
+
+static void*
+writerThread(void* parameter)
+{
+    Capture self = (Capture) parameter;
+    uint64_t lastFlush = getTimeInUs();
+    bool pending = false;
+
+    for (;;) {
+        bool running = __atomic_load_n(&(self->running), __ATOMIC_ACQUIRE);
+        int count = 0;
+
+        for (int i = 0; i < self->streamCount; i++)
+            count += drainStream(self, &(self->streams[i]));
+
+        if (count > 0)
+            pending = true;
+
+        uint64_t now = getTimeInUs();
+
+        if (pending && (self->file) && ((now - lastFlush >= CAPTURE_FLUSH_INTERVAL * 1000) || !running)) {
+            fflush(self->file);
+            pending = false;
+            lastFlush = now;
+        }
+
+        if (!running)
+            break;
+
+        if (count == 0)
+            Thread_sleep(CAPTURE_POLL_INTERVAL);
+    }
+
+    return NULL;
+}
+
+bool
+Capture_start(Capture self)
+{
+    if (!openFile(self))
+        return false;
+
+    self->running = true;
+    self->thread = Thread_create(writerThread, self, false);
+    Thread_start(self->thread);
+
+    return true;
+}
+
+bool
+Capture_openConnection(Capture self, IMasterConnection connection, const char* peerAddress, const char* localAddress,
+        int localPort)
+{
+    for (int i = 0; i < self->streamCount; i++) {
+        CaptureStream stream = &(self->streams[i]);
+        int expected = CAPTURE_STREAM_FREE;
+
+        /* several worker threads may open connections at the same time */
+        if (!__atomic_compare_exchange_n(&(stream->state), &expected, CAPTURE_STREAM_OPENING, false,
+                __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            continue;
+
+        if (stream->frames == NULL) {
+            stream->frames = (CaptureFrame*) malloc(self->ringSize * sizeof(CaptureFrame));
+            stream->mask = (uint32_t) (self->ringSize - 1);
+        }
+
+        stream->id = __atomic_add_fetch(&(self->nextId), 1, __ATOMIC_RELAXED);
+        stream->localAddress = parseAddress(localAddress);
+        stream->localPort = (uint16_t) localPort;
+        stream->openTime = getTimeInUs();
+
+        /* "a.b.c.d:port", otherwise a made-up peer */
+        char address[64];
+        const char* colon = peerAddress ? strrchr(peerAddress, ':') : NULL;
+
+        stream->peerAddress = 0;
+        stream->peerPort = (uint16_t) (49152 + stream->id % 16384);
+
+        if (colon && (colon - peerAddress < (int) sizeof(address))) {
+            memcpy(address, peerAddress, colon - peerAddress);
+            address[colon - peerAddress] = 0;
+
+            stream->peerAddress = parseAddress(address);
+            if (stream->peerAddress)
+                stream->peerPort = (uint16_t) atoi(colon + 1);
+        }
+
+        __atomic_store_n(&(stream->connection), connection, __ATOMIC_RELAXED);
+        __atomic_store_n(&(stream->state), CAPTURE_STREAM_ACTIVE, __ATOMIC_RELEASE);
+
+        return true;
+    }
+
+    __atomic_add_fetch(&(self->uncaptured), 1, __ATOMIC_RELAXED);
+
+    return false;
+}
+
+static CaptureStream
+findStream(Capture self, IMasterConnection connection)
+{
+    for (int i = 0; i < self->streamCount; i++) {
+        CaptureStream stream = &(self->streams[i]);
+
+        if ((__atomic_load_n(&(stream->connection), __ATOMIC_RELAXED) == connection) &&
+                (__atomic_load_n(&(stream->state), __ATOMIC_ACQUIRE) == CAPTURE_STREAM_ACTIVE))
+            return stream;
+    }
+
+    return NULL;
+}
+
+void
+Capture_closeConnection(Capture self, IMasterConnection connection)
+{
+    CaptureStream stream = findStream(self, connection);
+
+    if (stream) {
+        stream->closeTime = getTimeInUs();
+        __atomic_store_n(&(stream->state), CAPTURE_STREAM_CLOSED, __ATOMIC_RELEASE);
+    }
+}
+
+void
+Capture_addFrame(Capture self, IMasterConnection connection, const uint8_t* msg, int msgSize, bool sent)
+{
+    CaptureStream stream = findStream(self, connection);
+
+    if (stream == NULL) {
+        __atomic_add_fetch(&(self->uncapturedFrames), 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    uint64_t head = stream->head;
+
+    if (head - __atomic_load_n(&(stream->tail), __ATOMIC_ACQUIRE) > stream->mask) {
+        __atomic_add_fetch(&(stream->dropped), 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    if (msgSize > CAPTURE_MAX_FRAME)
+        msgSize = CAPTURE_MAX_FRAME;
+
+    CaptureFrame* frame = &(stream->frames[head & stream->mask]);
+    frame->timestamp = getTimeInUs();
+    frame->length = (uint16_t) msgSize;
+    frame->sent = sent;
+    memcpy(frame->data, msg, msgSize);
+
+    __atomic_store_n(&(stream->head), head + 1, __ATOMIC_RELEASE);
+}
+
+uint64_t
+Capture_getDroppedFrames(Capture self)
+{
+    uint64_t dropped = __atomic_load_n(&(self->uncapturedFrames), __ATOMIC_RELAXED);
+
+    for (int i = 0; i < self->streamCount; i++)
+        dropped += __atomic_load_n(&(self->streams[i].dropped), __ATOMIC_RELAXED);
+
+    return dropped;
+}
+
+void
+Capture_destroy(Capture self)
+{
+    if (self) {
+        if (self->running) {
+            __atomic_store_n(&(self->running), false, __ATOMIC_RELEASE);
+            Thread_destroy(self->thread);
+        }
+
+        if (self->file)
+            fclose(self->file);
+
+        for (int i = 0; i < self->streamCount; i++)
+            free(self->streams[i].frames);
+
+        free(self->streams);
+        free(self->path);
+        free(self);
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef CAPTURE_H_
+#define CAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "cs104_slave.h"
+#include "hal_thread.h"
+
+/*
+ * Capture of the raw APDUs of all master connections into a pcap file.
+ *
+ * The raw message handler of the slave copies each APDU with a time stamp
+ * into the ring of its connection (one producer, the thread ticking the
+ * slave, and one consumer). A background thread drains the rings and
+ * writes the frames as IPv4/TCP packets (LINKTYPE_RAW) with synthetic
+ * headers: a handshake when the connection opens, consecutive sequence
+ * and acknowledgement numbers and a FIN when it closes. Wireshark follows
+ * each connection as a TCP stream and decodes it with its IEC 104
+ * dissector (port 2404, other ports with "Decode As").
+ *
+ * The file is rotated when it reaches maxFileSize: path is renamed to
+ * path.1, path.1 to path.2 and so on, the oldest of maxFiles is removed.
+ *
+ * A full ring drops the frame and counts it, the producer never waits.
+ * Frames of one connection are written in order, frames of different
+ * connections only roughly (per drain round). The number of connections
+ * captured at the same time is fixed when the capture is created; the
+ * frames of further connections are counted as dropped.
+ */
+
+#define CAPTURE_MAX_FRAME 256           /* APDU length is at most 255 */
+#define CAPTURE_DEFAULT_RING_SIZE 256   /* frames per connection */
+#define CAPTURE_DEFAULT_CONNECTIONS 64
+#define CAPTURE_POLL_INTERVAL 5         /* ms the writer sleeps when all rings are empty */
+#define CAPTURE_FLUSH_INTERVAL 200      /* ms between fflush of the file */
+
+typedef struct {
+    uint64_t timestamp;     /* us since epoch */
+    uint16_t length;
+    uint8_t sent;           /* true = server to master */
+    uint8_t data[CAPTURE_MAX_FRAME];
+} CaptureFrame;
+
+typedef enum {
+    CAPTURE_STREAM_FREE,
+    CAPTURE_STREAM_OPENING,
+    CAPTURE_STREAM_ACTIVE,
+    CAPTURE_STREAM_CLOSED
+} CaptureStreamState;
+
+typedef struct sCaptureStream* CaptureStream;
+
+struct sCaptureStream {
+    int state;                  /* CaptureStreamState */
+    IMasterConnection connection;
+    uint32_t id;
+
+    uint32_t localAddress;      /* host byte order */
+    uint32_t peerAddress;
+    uint16_t localPort;
+    uint16_t peerPort;
+    uint64_t openTime;          /* us */
+    uint64_t closeTime;
+
+    CaptureFrame* frames;
+    uint32_t mask;
+    uint64_t head;              /* producer */
+    uint64_t tail;              /* writer */
+
+    /* writer only */
+    bool started;               /* handshake written */
+    uint32_t serverSequence;
+    uint32_t peerSequence;
+
+    uint64_t dropped;
+};
+
+typedef struct sCapture* Capture;
+
+struct sCapture {
+    char* path;
+    uint64_t maxFileSize;       /* bytes, 0 = no rotation */
+    int maxFiles;
+
+    struct sCaptureStream* streams;
+    int streamCount;
+    int ringSize;
+    uint32_t nextId;
+
+    FILE* file;
+    uint64_t fileSize;
+    uint16_t ipIdentification;
+
+    /* statistics */
+    uint64_t frames;            /* written */
+    uint64_t bytes;
+    int rotations;
+    uint64_t uncaptured;        /* connections opened while all streams were in use */
+    uint64_t uncapturedFrames;  /* frames of those connections */
+
+    bool running;
+    Thread thread;
+};
+
+/**
+ * \param path the capture file
+ * \param maxFileSize rotate the file at this size (bytes), 0 for no rotation
+ * \param maxFiles number of files kept (path, path.1, ...)
+ * \param maxConnections connections captured at the same time, 0 for CAPTURE_DEFAULT_CONNECTIONS
+ * \param ringSize frames per connection ring, rounded up to a power of two
+ */
+Capture
+Capture_create(const char* path, uint64_t maxFileSize, int maxFiles, int maxConnections, int ringSize);
+
+/**
+ * \brief Open the file and start the writer thread
+ *
+ * \return false when the file cannot be created
+ */
+bool
+Capture_start(Capture self);
+
+/**
+ * \brief Start capturing a new connection (call on CS104_CON_EVENT_CONNECTION_OPENED)
+ *
+ * \param peerAddress "a.b.c.d:port" as returned by IMasterConnection_getPeerAddress
+ * \param localAddress IPv4 address of the server side (of the endpoint), NULL or "0.0.0.0" when unknown
+ * \param localPort TCP port of the server
+ *
+ * \return false when all streams are in use, the connection is not captured
+ */
+bool
+Capture_openConnection(Capture self, IMasterConnection connection, const char* peerAddress, const char* localAddress,
+        int localPort);
+
+/**
+ * \brief Stop capturing a connection (call on CS104_CON_EVENT_CONNECTION_CLOSED)
+ */
+void
+Capture_closeConnection(Capture self, IMasterConnection connection);
+
+/**
+ * \brief Copy one APDU into the ring of its connection, never blocks
+ *
+ * Has to be called from the thread that ticks the slave of the connection.
+ */
+void
+Capture_addFrame(Capture self, IMasterConnection connection, const uint8_t* msg, int msgSize, bool sent);
+
+/**
+ * \brief Frames dropped on full rings or of connections that are not captured
+ */
+uint64_t
+Capture_getDroppedFrames(Capture self);
+
+/**
+ * \brief Write the queued frames, stop the writer thread and close the file
+ */
+void
+Capture_destroy(Capture self);
+
+#endif /* CAPTURE_H_ */
@@ -0,0 +1,204 @@
+#include <stddef.h>
+
+#include "command.h"
+
+static bool
+decodeSingleCommand(InformationObject io, Command* command)
+{
+    SingleCommand sc = (SingleCommand) io;
+
+    command->value.i = SingleCommand_getState(sc);
+    command->select = SingleCommand_isSelect(sc);
+
+    return true;
+}
+
+static bool
+decodeDoubleCommand(InformationObject io, Command* command)
+{
+    DoubleCommand dc = (DoubleCommand) io;
+
+    /* 1 = OFF, 2 = ON like the double point, 0 and 3 are not permitted */
+    command->value.i = DoubleCommand_getState(dc);
+    command->select = DoubleCommand_isSelect(dc);
+
+    return (command->value.i == IEC60870_DOUBLE_POINT_OFF) || (command->value.i == IEC60870_DOUBLE_POINT_ON);
+}
+
+static bool
+decodeStepCommand(InformationObject io, Command* command)
+{
+    StepCommand rc = (StepCommand) io;
+
+    command->value.i = StepCommand_getState(rc);
+    command->select = StepCommand_isSelect(rc);
+
+    return (command->value.i == IEC60870_STEP_LOWER) || (command->value.i == IEC60870_STEP_HIGHER);
+}
+
+static bool
+decodeSetpointNormalized(InformationObject io, Command* command)
+{
+    SetpointCommandNormalized se = (SetpointCommandNormalized) io;
+
+    command->value.f = SetpointCommandNormalized_getValue(se);
+    command->select = SetpointCommandNormalized_isSelect(se);
+
+    return true;
+}
+
+static bool
+decodeSetpointScaled(InformationObject io, Command* command)
+{
+    SetpointCommandScaled se = (SetpointCommandScaled) io;
+
+    command->value.i = SetpointCommandScaled_getValue(se);
+    command->select = SetpointCommandScaled_isSelect(se);
+
+    return true;
+}
+
+static bool
+decodeSetpointShort(InformationObject io, Command* command)
+{
+    SetpointCommandShort se = (SetpointCommandShort) io;
+
+    command->value.f = SetpointCommandShort_getValue(se);
+    command->select = SetpointCommandShort_isSelect(se);
+
+    return true;
+}
+
+static bool
+decodeBitstringCommand(InformationObject io, Command* command)
+{
+    command->value.u = Bitstring32Command_getValue((Bitstring32Command) io);
+    command->select = false;
+
+    return true;
+}
+
+/* setpoints and bitstrings are written and confirmed, switching commands also terminated */
+static const CommandType commandTypes[128] = {
+    [C_SC_NA_1] = { C_SC_NA_1, true, decodeSingleCommand },
+    [C_DC_NA_1] = { C_DC_NA_1, true, decodeDoubleCommand },
+    [C_RC_NA_1] = { C_RC_NA_1, true, decodeStepCommand },
+    [C_SE_NA_1] = { C_SE_NA_1, false, decodeSetpointNormalized },
+    [C_SE_NB_1] = { C_SE_NB_1, false, decodeSetpointScaled },
+    [C_SE_NC_1] = { C_SE_NC_1, false, decodeSetpointShort },
+    [C_BO_NA_1] = { C_BO_NA_1, false, decodeBitstringCommand },
+
+    /* the time tagged objects start like the untimed ones */
+    [C_SC_TA_1] = { C_SC_NA_1, true, decodeSingleCommand },
+    [C_DC_TA_1] = { C_DC_NA_1, true, decodeDoubleCommand },
+    [C_RC_TA_1] = { C_RC_NA_1, true, decodeStepCommand },
+    [C_SE_TA_1] = { C_SE_NA_1, false, decodeSetpointNormalized },
+    [C_SE_TB_1] = { C_SE_NB_1, false, decodeSetpointScaled },
+    [C_SE_TC_1] = { C_SE_NC_1, false, decodeSetpointShort },
+    [C_BO_TA_1] = { C_BO_NA_1, false, decodeBitstringCommand }
+};
+
+const CommandType*
+Command_getType(TypeID type)
+{
+    if ((unsigned int) type >= 128)
+        return NULL;
+
+    const CommandType* commandType = &(commandTypes[type]);
+
+    return commandType->decode ? commandType : NULL;
+}
+
+CommandResult
+Command_decode(const CommandType* type, PointDB db, InformationObject io, Command* command)
+{
+    command->index = PointDB_lookup(db, InformationObject_getObjectAddress(io));
+
+    if (command->index == -1)
+        return COMMAND_UNKNOWN_IOA;
+
+    if (db->type[command->index] != type->pointType)
+        return COMMAND_UNKNOWN_TYPE;
+
+    if (!type->decode(io, command))
+        return COMMAND_INVALID;
+
+    return command->select ? COMMAND_SELECT : COMMAND_EXECUTE;
+}
+
+/* step positions are 7 bit signed */
+static int32_t
+limitStep(int32_t value)
+{
+    return (value < -64) ? -64 : ((value > 63) ? 63 : value);
+}
+
+bool
+Command_getStatusValue(const CommandType* type, PointValue command, TypeID statusType, PointValue* status)
+{
+    statusType = PointDB_getUntimedType(statusType);
+
+    switch (type->pointType) {
+    case C_SC_NA_1:
+    case C_DC_NA_1:
+    {
+        bool on = (type->pointType == C_SC_NA_1) ? (command.i != 0) : (command.i == IEC60870_DOUBLE_POINT_ON);
+
+        if (statusType == M_SP_NA_1)
+            status->i = on;
+        else if (statusType == M_DP_NA_1)
+            status->i = on ? IEC60870_DOUBLE_POINT_ON : IEC60870_DOUBLE_POINT_OFF;
+        else
+            return false;
+
+        return true;
+    }
+
+    case C_RC_NA_1:
+    {
+        int32_t step = (command.i == IEC60870_STEP_HIGHER) ? 1 : -1;
+
+        if (statusType == M_ST_NA_1)
+            status->i = limitStep(status->i + step);
+        else if (statusType == M_ME_NB_1)
+            status->i += step;
+        else
+            return false;
+
+        return true;
+    }
+
+    case C_SE_NA_1:
+    case C_SE_NC_1:
+        if ((statusType == M_ME_NA_1) || (statusType == M_ME_NC_1))
+            status->f = command.f;
+        else if (statusType == M_ME_NB_1)
+            status->i = (int32_t) command.f;
+        else
+            return false;
+
+        return true;
+
+    case C_SE_NB_1:
+        if (statusType == M_ME_NB_1)
+            status->i = command.i;
+        else if ((statusType == M_ME_NA_1) || (statusType == M_ME_NC_1))
+            status->f = (float) command.i;
+        else if (statusType == M_ST_NA_1)
+            status->i = limitStep(command.i);
+        else
+            return false;
+
+        return true;
+
+    case C_BO_NA_1:
+        if (statusType != M_BO_NA_1)
+            return false;
+
+        status->u = command.u;
+        return true;
+
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+
+/*
+ * Decoding of received commands (control direction).
+ *
+ * The command types are kept in a table indexed by the type identification:
+ * single, double and regulating step commands, normalized, scaled and short
+ * floating point setpoints, bitstring commands, each also with CP56Time2a.
+ * A time tagged command addresses the point of the type without time tag.
+ *
+ * The target is found through the IOA hash index of the point table, so the
+ * cost of a command does not depend on the number of points. Targets are
+ * point lines of the control type in the configuration, e.g.
+ *
+ *   46;6000;1      double command, state OFF
+ *   50;6100;0.5    short floating point setpoint
+ *
+ * A control point can be linked to a monitored point (status=IOA), which
+ * follows an executed command: single and double points take the switching
+ * state, step positions and scaled values move one step, measurands take
+ * the setpoint and bitstrings the commanded bits.
+ */
+
+typedef enum {
+    COMMAND_EXECUTE,        /* set the value of the target point */
+    COMMAND_SELECT,         /* select of a select-before-operate command */
+    COMMAND_UNKNOWN_IOA,    /* no point with the IOA */
+    COMMAND_UNKNOWN_TYPE,   /* the point with the IOA has another type */
+    COMMAND_INVALID         /* value not permitted (double command 0/3, step 0/3) */
+} CommandResult;
+
+typedef struct {
+    int index;              /* of the target point */
+    PointValue value;       /* in the representation of the point type */
+    bool select;
+} Command;
+
+typedef bool (*CommandDecoder)(InformationObject io, Command* command);
+
+typedef struct {
+    TypeID pointType;       /* type of the target points */
+    bool terminate;         /* execution is reported with ACT_TERM */
+    CommandDecoder decode;  /* false for values not permitted */
+} CommandType;
+
+/**
+ * \return the description of a command type, NULL when the type
+ *         identification is not a supported command
+ */
+const CommandType*
+Command_getType(TypeID type);
+
+/**
+ * \brief Decode a command and look up its target
+ *
+ * \param io the information object of the command ASDU
+ * \param command the target and value, valid for COMMAND_EXECUTE and COMMAND_SELECT
+ */
+CommandResult
+Command_decode(const CommandType* type, PointDB db, InformationObject io, Command* command);
+
+/**
+ * \brief Compute the state of a linked status point after a command
+ *
+ * \param command the value of the executed command
+ * \param statusType type of the status point
+ * \param status the current value of the status point, replaced by the new one
+ *
+ * \return false when the status type cannot follow the command type
+ */
+bool
+Command_getStatusValue(const CommandType* type, PointValue command, TypeID statusType, PointValue* status);
+
+#endif /* COMMAND_H_ */
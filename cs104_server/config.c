@@ -0,0 +1,440 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "config.h"
+
+static double
+getMonotonicTimeInMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+#ifdef _WIN32
+/* the C library of WIN32 has no getline: the line up to the '\n', -1 at the end of the file */
+static long
+getline(char** buffer, size_t* size, FILE* file)
+{
+    size_t length = 0;
+
+    while (true) {
+        if (*size - length < 2) {
+            size_t newSize = (*size > 0) ? (*size * 2) : 256;
+            char* newBuffer = (char*) realloc(*buffer, newSize);
+
+            if (newBuffer == NULL)
+                return -1;
+
+            *buffer = newBuffer;
+            *size = newSize;
+        }
+
+        if (fgets(*buffer + length, (int) (*size - length), file) == NULL)
+            return (length > 0) ? (long) length : -1;
+
+        length += strlen(*buffer + length);
+
+        if ((*buffer)[length - 1] == '\n')
+            return (long) length;
+    }
+}
+#endif
+
+typedef struct {
+    Config config;
+    PointDB db;
+    ConfigAttributeHandler handler;
+    void* parameter;
+
+    /* line of every point for duplicate messages, indexes are stable until the table is sorted */
+    int* pointLines;
+    int pointLineCapacity;
+} LoadState;
+
+static char*
+trim(char* str)
+{
+    while (isspace((unsigned char) *str))
+        str++;
+
+    char* end = str + strlen(str);
+
+    while ((end > str) && isspace((unsigned char) end[-1]))
+        end--;
+
+    *end = '\0';
+
+    return str;
+}
+
+void
+Config_reportError(Config self, int line, const char* format, ...)
+{
+    va_list args;
+
+    printf("%s:%d: ", self->path, line);
+
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+
+    printf("\n");
+
+    self->errorCount++;
+}
+
+static void
+addEntry(LoadState* state, int line, const char* key, const char* value)
+{
+    Config self = state->config;
+
+    int i;
+    for (i = 0; i < self->entryCount; i++) {
+        if (strcmp(self->entries[i].key, key) == 0) {
+            Config_reportError(self, line, "%s already set on line %d, ignored", key, self->entries[i].line);
+            return;
+        }
+    }
+
+    if (self->entryCount == self->entryCapacity) {
+        int newCapacity = (self->entryCapacity > 0) ? (self->entryCapacity * 2) : 16;
+
+        ConfigEntry* entries = (ConfigEntry*) realloc(self->entries, newCapacity * sizeof(ConfigEntry));
+
+        if (entries == NULL)
+            return;
+
+        self->entries = entries;
+        self->entryCapacity = newCapacity;
+    }
+
+    ConfigEntry* entry = &(self->entries[self->entryCount++]);
+
+    entry->key = strdup(key);
+    entry->value = strdup(value);
+    entry->line = line;
+}
+
+/* type;ioa;value[;attributes] */
+static void
+addPoint(LoadState* state, int line, char* text)
+{
+    Config self = state->config;
+    PointDB db = state->db;
+
+    char* pos;
+    char* end;
+
+    long type = strtol(text, &end, 10);
+
+    if ((end == text) || (*end != ';')) {
+        Config_reportError(self, line, "invalid point definition: %s", text);
+        return;
+    }
+
+    pos = end + 1;
+    long ioa = strtol(pos, &end, 10);
+
+    if ((end == pos) || (*end != ';')) {
+        Config_reportError(self, line, "invalid point definition: %s", text);
+        return;
+    }
+
+    pos = end + 1;
+    float value = strtof(pos, &end);
+
+    if ((end == pos) || ((*end != ';') && (*end != '\0'))) {
+        Config_reportError(self, line, "invalid point definition: %s", text);
+        return;
+    }
+
+    if ((ioa < 1) || (ioa > POINT_DB_MAX_IOA)) {
+        Config_reportError(self, line, "%ld is not a valid ioa value", ioa);
+        return;
+    }
+
+    int existing = PointDB_lookup(db, (int) ioa);
+
+    if (existing != -1) {
+        Config_reportError(self, line, "duplicate IOA %ld (defined on line %d), ignored", ioa,
+                (existing < state->pointLineCapacity) ? state->pointLines[existing] : 0);
+        return;
+    }
+
+    int idx = PointDB_add(db, (TypeID) type, (int) ioa, value);
+
+    if (idx == -1) {
+        Config_reportError(self, line, "unsupported point type %ld for IOA %ld, ignored", type, ioa);
+        return;
+    }
+
+    if (idx >= state->pointLineCapacity) {
+        int newCapacity = (state->pointLineCapacity > 0) ? (state->pointLineCapacity * 2) : 1024;
+
+        int* lines = (int*) realloc(state->pointLines, newCapacity * sizeof(int));
+
+        if (lines) {
+            state->pointLines = lines;
+            state->pointLineCapacity = newCapacity;
+        }
+    }
+
+    if (idx < state->pointLineCapacity)
+        state->pointLines[idx] = line;
+
+    self->pointCount++;
+
+    if ((*end == ';') && state->handler)
+        state->handler(state->parameter, self, db, idx, end + 1, line);
+}
+
+uint32_t
+Config_parseSeconds(const char* str)
+{
+    double seconds = atof(str);
+
+    return (seconds > 0) ? (uint32_t) (seconds * 1000 + 0.5) : 0;
+}
+
+void
+Config_parsePointAttributes(void* parameter, Config config, PointDB db, int idx, char* attributes, int line)
+{
+    char* attribute = strtok(attributes, ";\r\n");
+
+    ValueModelParameters model;
+    bool hasModel = false;
+    ValueModelParameters_init(&model, VALUE_MODEL_TOGGLE);
+
+    while (attribute) {
+        if (strncmp(attribute, "step=", 5) == 0) {
+            /* counter increment per step (integrated totals) */
+            db->increment[idx] = atoi(attribute + 5);
+        }
+        else if (strcmp(attribute, "periodic") == 0) {
+            db->flags[idx] |= POINT_DB_FLAG_PERIODIC;
+        }
+        else if (strncmp(attribute, "periodic=", 9) == 0) {
+            db->flags[idx] |= POINT_DB_FLAG_PERIODIC;
+            db->period[idx] = Config_parseSeconds(attribute + 9);
+        }
+        else if (strcmp(attribute, "sbo") == 0) {
+            db->flags[idx] |= POINT_DB_FLAG_SELECT;
+        }
+        else if (strncmp(attribute, "sbo=", 4) == 0) {
+            db->flags[idx] |= POINT_DB_FLAG_SELECT;
+            db->period[idx] = Config_parseSeconds(attribute + 4);
+        }
+        else if (strncmp(attribute, "status=", 7) == 0) {
+            db->link[idx] = atoi(attribute + 7);
+        }
+        else if (strncmp(attribute, "delay=", 6) == 0) {
+            db->delay[idx] = Config_parseSeconds(attribute + 6);
+        }
+        else if (strncmp(attribute, "model=", 6) == 0) {
+            if (ValueModel_parseKind(attribute + 6, &model.kind))
+                hasModel = true;
+            else
+                Config_reportError(config, line, "unknown value model \"%s\" for IOA %d", attribute + 6, db->ioa[idx]);
+        }
+        else if (strncmp(attribute, "rate=", 5) == 0) {
+            double rate = atof(attribute + 5);
+            model.minInterval = model.maxInterval = (rate > 0) ? (uint32_t) (1000.0 / rate + 0.5) : 1000;
+        }
+        else if (strncmp(attribute, "min=", 4) == 0) {
+            model.min = (float) atof(attribute + 4);
+        }
+        else if (strncmp(attribute, "max=", 4) == 0) {
+            model.max = (float) atof(attribute + 4);
+        }
+        else if (strncmp(attribute, "delta=", 6) == 0) {
+            model.delta = (float) atof(attribute + 6);
+        }
+        else if (strncmp(attribute, "cycle=", 6) == 0) {
+            model.cycle = (float) atof(attribute + 6);
+        }
+        else if (strncmp(attribute, "group=", 6) == 0) {
+            uint16_t groups = 0;
+            char* pos = attribute + 6;
+
+            while (*pos) {
+                int group = (int) strtol(pos, &pos, 10);
+
+                if (group >= 1 && group <= POINT_DB_MAX_GROUPS)
+                    groups |= (uint16_t) (1 << (group - 1));
+                else
+                    Config_reportError(config, line, "invalid group %d for IOA %d", group, db->ioa[idx]);
+
+                if (*pos != ',')
+                    break;
+                pos++;
+            }
+
+            PointDB_setGroups(db, idx, groups);
+        }
+        else
+            Config_reportError(config, line, "unknown point attribute \"%s\" for IOA %d", attribute, db->ioa[idx]);
+
+        attribute = strtok(NULL, ";\r\n");
+    }
+
+    if (hasModel && parameter)
+        EventGenerator_addModel((EventGenerator) parameter, db->ioa[idx], &model);
+}
+
+/* settings: key=value lines are added as entries, points: only the point list is read */
+static void
+readFile(LoadState* state, FILE* file, bool settings)
+{
+    Config self = state->config;
+
+    char* buffer = NULL;
+    size_t bufferSize = 0;
+    bool inPointList = false;
+    int line = 0;
+
+    while (getline(&buffer, &bufferSize, file) != -1) {
+        char* text = trim(buffer);
+
+        line++;
+
+        if ((text[0] == '\0') || (text[0] == '#'))
+            continue;
+
+        if (inPointList && (isdigit((unsigned char) text[0]) || (text[0] == '-'))) {
+            if (state->db)
+                addPoint(state, line, text);
+
+            continue;
+        }
+
+        char* separator = strchr(text, '=');
+
+        if (separator == NULL) {
+            if (settings)
+                Config_reportError(self, line, "expected key=value: %s", text);
+
+            continue;
+        }
+
+        *separator = '\0';
+
+        char* key = trim(text);
+        char* value = trim(separator + 1);
+
+        if (strcmp(key, "MESS") == 0)
+            inPointList = true;
+        else if (settings)
+            addEntry(state, line, key, value);
+    }
+
+    if (settings)
+        self->lineCount = line;
+
+    free(buffer);
+    free(state->pointLines);
+}
+
+Config
+Config_load(const char* path, PointDB db, ConfigAttributeHandler handler, void* parameter)
+{
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL) {
+        perror("Failed to open configuration file");
+        return NULL;
+    }
+
+    Config self = (Config) calloc(1, sizeof(struct sConfig));
+
+    double start = getMonotonicTimeInMs();
+
+    LoadState state;
+    self->path = strdup(path);
+
+    state.config = self;
+    state.db = db;
+    state.handler = handler;
+    state.parameter = parameter;
+    state.pointLines = NULL;
+    state.pointLineCapacity = 0;
+
+    readFile(&state, file, true);
+
+    fclose(file);
+
+    if (db && !PointDB_sort(db))
+        Config_reportError(self, self->lineCount, "out of memory sorting the points");
+
+    self->loadTime = getMonotonicTimeInMs() - start;
+
+    return self;
+}
+
+bool
+Config_loadPoints(Config self, PointDB db, ConfigAttributeHandler handler, void* parameter)
+{
+    FILE* file = fopen(self->path, "r");
+
+    if (file == NULL) {
+        perror("Failed to open configuration file");
+        return false;
+    }
+
+    double start = getMonotonicTimeInMs();
+
+    LoadState state;
+
+    state.config = self;
+    state.db = db;
+    state.handler = handler;
+    state.parameter = parameter;
+    state.pointLines = NULL;
+    state.pointLineCapacity = 0;
+
+    readFile(&state, file, false);
+
+    fclose(file);
+
+    if (!PointDB_sort(db)) {
+        Config_reportError(self, self->lineCount, "out of memory sorting the points");
+        return false;
+    }
+
+    self->loadTime += getMonotonicTimeInMs() - start;
+
+    return true;
+}
+
+const char*
+Config_get(Config self, const char* key)
+{
+    int i;
+    for (i = 0; i < self->entryCount; i++) {
+        if (strcmp(self->entries[i].key, key) == 0)
+            return self->entries[i].value;
+    }
+
+    return NULL;
+}
+
+void
+Config_destroy(Config self)
+{
+    if (self) {
+        int i;
+        for (i = 0; i < self->entryCount; i++) {
+            free(self->entries[i].key);
+            free(self->entries[i].value);
+        }
+
+        free(self->entries);
+        free(self->path);
+        free(self);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdbool.h>
+
+#include "point_db.h"
+#include "event_generator.h"
+
+/*
+ * Server configuration file, settings and point list read in a single pass.
+ *
+ *   key=value                       settings (first definition wins)
+ *   MESS=                           start of the point list
+ *   type;ioa;value[;attributes]     point definitions
+ *
+ * Point lines are added to the point table while the file is read, the
+ * attributes after the third ';' are passed to a handler. Empty lines and
+ * lines starting with '#' are skipped, settings may also follow the point
+ * list. Problems are reported with their line number and counted; the line
+ * is skipped and loading continues.
+ *
+ * When the point list may not be needed (IMAGE replaces it), the settings
+ * are loaded without a table and the list is read later with
+ * Config_loadPoints.
+ */
+
+typedef struct sConfig* Config;
+
+/**
+ * Called for every point with attributes, before the table is sorted.
+ *
+ * \param config the configuration being loaded, for Config_reportError
+ * \param index index of the new point
+ * \param attributes the text after the third ';' (can be modified)
+ * \param line line number for messages
+ */
+typedef void (*ConfigAttributeHandler)(void* parameter, Config config, PointDB db, int index, char* attributes,
+        int line);
+
+typedef struct sConfigEntry {
+    char* key;
+    char* value;
+    int line;
+} ConfigEntry;
+
+struct sConfig {
+    char* path;
+
+    ConfigEntry* entries;
+    int entryCount;
+    int entryCapacity;
+
+    /* load report */
+    int lineCount;
+    int pointCount;
+    int errorCount;
+    double loadTime;        /* ms */
+};
+
+/**
+ * Read the settings and the point list, the table is sorted afterwards.
+ *
+ * \param db table for the points of the MESS= list, NULL to skip the list
+ * \param handler called for point attributes, can be NULL
+ *
+ * \return the settings, NULL when the file cannot be opened
+ */
+Config
+Config_load(const char* path, PointDB db, ConfigAttributeHandler handler, void* parameter);
+
+/**
+ * Read the point list of a configuration loaded without a table, the table
+ * is sorted afterwards. The settings are not read again, pointCount and
+ * errorCount include the points.
+ *
+ * \return false when the file cannot be opened or there is no memory to sort
+ *         the table
+ */
+bool
+Config_loadPoints(Config self, PointDB db, ConfigAttributeHandler handler, void* parameter);
+
+/**
+ * \brief Report a problem as "path:line: message" and count it in errorCount
+ */
+void
+Config_reportError(Config self, int line, const char* format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 3, 4)))
+#endif
+;
+
+/**
+ * \return the value of the setting, NULL when the key is not set
+ */
+const char*
+Config_get(Config self, const char* key);
+
+void
+Config_destroy(Config self);
+
+/**
+ * Convert a time in seconds (fractions allowed, e.g. 0.25) to ms.
+ */
+uint32_t
+Config_parseSeconds(const char* str);
+
+/**
+ * ConfigAttributeHandler for the point attributes, separated by ';':
+ *
+ *   group=1,2          interrogation groups (counters: counter group 1..4)
+ *   step=N             counter increment per step (integrated totals)
+ *   periodic[=s]       cyclic transmission, optionally with an own period
+ *   sbo[=s]            control points: execute only after a select, optionally with an own select timeout
+ *   status=IOA         control points: monitored point following executed commands
+ *   delay=s            control points: operating time until the status follows and the command terminates
+ *   model=toggle|walk|sine|ramp|step   value model for spontaneous events
+ *   rate=N, min=, max=, delta=, cycle=s   value model parameters
+ *
+ * \param parameter EventGenerator the value models are added to, NULL to ignore the models
+ */
+void
+Config_parsePointAttributes(void* parameter, Config config, PointDB db, int idx, char* attributes, int line);
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,115 @@
+#include <string.h>
+
+#include "counters.h"
+
+void
+Counters_freeze(PointDB db, int group, bool reset, uint64_t timestamp)
+{
+    if ((group < 0) || (group > POINT_DB_MAX_COUNTER_GROUPS))
+        return;
+
+    PointDB_lock(db);
+
+    PointValue* running = db->value + db->counterFirst;
+
+    if (group == 0) {
+        memcpy(db->frozen, running, db->counterCount * sizeof(PointValue));
+
+        if (reset)
+            memset(running, 0, db->counterCount * sizeof(PointValue));
+    }
+    else {
+        const int32_t* points = db->counterGroupPoints[group];
+        int i;
+
+        for (i = 0; i < db->counterGroupCount[group]; i++) {
+            int offset = points[i] - db->counterFirst;
+
+            db->frozen[offset] = running[offset];
+
+            if (reset)
+                running[offset].i = 0;
+        }
+    }
+
+    db->freezeGeneration[group] = ++(db->freezeCount);
+    db->freezeTime[group] = timestamp;
+
+    PointDB_unlock(db);
+}
+
+void
+Counters_reset(PointDB db, int group)
+{
+    if ((group < 0) || (group > POINT_DB_MAX_COUNTER_GROUPS))
+        return;
+
+    PointDB_lock(db);
+
+    if (group == 0)
+        memset(db->value + db->counterFirst, 0, db->counterCount * sizeof(PointValue));
+    else {
+        int i;
+        for (i = 0; i < db->counterGroupCount[group]; i++)
+            db->value[db->counterGroupPoints[group][i]].i = 0;
+    }
+
+    PointDB_unlock(db);
+}
+
+void
+Counters_advance(PointDB db)
+{
+    PointDB_lock(db);
+
+    int i;
+    for (i = db->counterFirst; i < db->counterFirst + db->counterCount; i++)
+        db->value[i].u += (uint32_t) db->increment[i];
+
+    PointDB_unlock(db);
+}
+
+PointDB
+Counters_createSnapshot(PointDB db, int group)
+{
+    if ((group < 0) || (group > POINT_DB_MAX_COUNTER_GROUPS))
+        return NULL;
+
+    PointDB self = PointDB_create();
+
+    if (self == NULL)
+        return NULL;
+
+    PointDB_lock(db);
+
+    const int32_t* points = db->counterGroupPoints[group];
+    int i;
+
+    for (i = 0; i < db->counterGroupCount[group]; i++) {
+        int idx = PointDB_add(self, (TypeID) db->type[points[i]], db->ioa[points[i]], 0.f);
+
+        if (idx == -1)
+            continue;
+
+        self->quality[idx] = db->quality[points[i]];
+        self->groups[idx] = db->groups[points[i]];
+    }
+
+    /* the order is kept, sorting builds the counter range */
+    if (!PointDB_sort(self)) {
+        PointDB_unlock(db);
+        PointDB_release(self);
+        return NULL;
+    }
+
+    for (i = 0; i < self->counterCount; i++)
+        self->frozen[i] = db->frozen[PointDB_lookup(db, self->ioa[self->counterFirst + i]) - db->counterFirst];
+
+    memcpy(self->freezeGeneration, db->freezeGeneration, sizeof(self->freezeGeneration));
+    memcpy(self->freezeTime, db->freezeTime, sizeof(self->freezeTime));
+    self->freezeCount = db->freezeCount;
+
+    PointDB_unlock(db);
+
+    return self;
+}
@@ -0,0 +1,51 @@
+#ifndef COUNTERS_H_
+#define COUNTERS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "point_db.h"
+
+/*
+ * Integrated totals simulation: counters advance by their increment on a
+ * schedule, counter interrogation commands freeze and/or reset them.
+ *
+ * A general freeze (group 0) copies the whole counter range of the value
+ * column into the frozen readings with one memcpy. Group freezes walk the
+ * counter group index. All functions take the table lock.
+ */
+
+/**
+ * Freeze the counters of a group (0 = all counters).
+ *
+ * \param reset set the running counters to zero after freezing
+ * \param timestamp freeze time reported with M_IT_TB_1
+ */
+void
+Counters_freeze(PointDB db, int group, bool reset, uint64_t timestamp);
+
+/**
+ * Reset the running counters of a group (0 = all counters) without freezing.
+ */
+void
+Counters_reset(PointDB db, int group);
+
+/**
+ * Add the configured increment to all running counters.
+ */
+void
+Counters_advance(PointDB db);
+
+/**
+ * Copy the counters of a group (0 = all counters) with their frozen readings
+ * and freeze sequence numbers into a table of their own, ordered like the
+ * group index. A counter interrogation response is sent from the copy, so a
+ * freeze by another master or a reload does not change a partly sent
+ * response.
+ *
+ * \return the copy, NULL when out of memory
+ */
+PointDB
+Counters_createSnapshot(PointDB db, int group);
+
+#endif /* COUNTERS_H_ */
@@ -0,0 +1,466 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "event_generator.h"
+#include "asdu_packer.h"
+#include "hal_time.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const char* modelNames[] = { "toggle", "walk", "sine", "ramp", "step" };
+
+void
+ValueModelParameters_init(ValueModelParameters* self, ValueModelKind kind)
+{
+    self->kind = kind;
+    self->minInterval = 1000;
+    self->maxInterval = 1000;
+    self->min = 0.f;
+    self->max = 100.f;
+    self->delta = 1.f;
+    self->cycle = 60.f;
+}
+
+bool
+ValueModel_parseKind(const char* name, ValueModelKind* kind)
+{
+    int i;
+    for (i = 0; i < (int) (sizeof(modelNames) / sizeof(modelNames[0])); i++) {
+        if (strcmp(name, modelNames[i]) == 0) {
+            *kind = (ValueModelKind) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+EventGenerator
+EventGenerator_create(PointDB db, TimerWheel wheel)
+{
+    EventGenerator self = (EventGenerator) calloc(1, sizeof(struct sEventGenerator));
+
+    if (self) {
+        self->db = db;
+        self->wheel = wheel;
+        self->rateMultiplier = 1;
+    }
+
+    return self;
+}
+
+void
+EventGenerator_destroy(EventGenerator self)
+{
+    if (self) {
+        free(self->models);
+        free(self->pending);
+        free(self->isPending);
+        free(self);
+    }
+}
+
+bool
+EventGenerator_addModel(EventGenerator self, int ioa, const ValueModelParameters* parameters)
+{
+    if (self->modelCount == self->modelCapacity) {
+        int newCapacity = (self->modelCapacity > 0) ? (self->modelCapacity * 2) : 64;
+
+        ValueModel models = (ValueModel) realloc(self->models, newCapacity * sizeof(struct sValueModel));
+
+        if (models == NULL)
+            return false;
+
+        self->models = models;
+        self->modelCapacity = newCapacity;
+    }
+
+    ValueModel model = &(self->models[self->modelCount++]);
+
+    model->parameters = *parameters;
+    model->ioa = ioa;
+    model->index = -1;
+    model->state = parameters->min;
+    model->generator = self;
+
+    if (model->parameters.maxInterval < model->parameters.minInterval)
+        model->parameters.maxInterval = model->parameters.minInterval;
+
+    return true;
+}
+
+void
+EventGenerator_copyModels(EventGenerator self, EventGenerator other)
+{
+    int i;
+    for (i = 0; i < other->modelCount; i++)
+        EventGenerator_addModel(self, other->models[i].ioa, &(other->models[i].parameters));
+}
+
+static bool
+isSwitchType(TypeID type)
+{
+    type = PointDB_getUntimedType(type);
+
+    return (type == M_SP_NA_1) || (type == M_DP_NA_1);
+}
+
+static bool
+isMeasurandType(TypeID type)
+{
+    type = PointDB_getUntimedType(type);
+
+    return (type == M_ME_NA_1) || (type == M_ME_NB_1) || (type == M_ME_NC_1);
+}
+
+static float
+limitValue(TypeID type, float value)
+{
+    switch (PointDB_getUntimedType(type)) {
+    case M_ME_NA_1:
+        /* normalized value range [-1, 1 - 2^-15] */
+        if (value < -1.f) return -1.f;
+        if (value > 32767.f / 32768.f) return 32767.f / 32768.f;
+        return value;
+    case M_ME_NB_1:
+        if (value < -32768.f) return -32768.f;
+        if (value > 32767.f) return 32767.f;
+        return value;
+    default:
+        return value;
+    }
+}
+
+static uint32_t
+getNextInterval(EventGenerator self, ValueModel model)
+{
+    uint32_t interval = model->parameters.minInterval;
+
+    if (model->parameters.maxInterval > interval)
+        interval += (uint32_t) rand() % (model->parameters.maxInterval - interval + 1);
+
+    interval /= (uint32_t) self->rateMultiplier;
+
+    /* the intervals are in station time */
+    if (self->clock)
+        interval = (uint32_t) ((double) interval / self->clock->speed);
+
+    return (interval > 0) ? interval : 1;
+}
+
+/* station time of a monotonic time (ms) */
+static uint64_t
+getStationTime(EventGenerator self, uint64_t monotonic)
+{
+    return self->clock ? StationClock_getTime(self->clock, monotonic) : Hal_getTimeInMs();
+}
+
+uint64_t
+EventGenerator_getTime(EventGenerator self)
+{
+    return self->clock ? StationClock_now(self->clock) : Hal_getTimeInMs();
+}
+
+/* caller holds the table lock; time = time tag of the batch (ms since 1970) */
+static void
+updatePoint(EventGenerator self, ValueModel model, uint64_t time)
+{
+    PointDB db = self->db;
+    int index = model->index;
+
+    if (index == -1)
+        return;
+
+    TypeID type = (TypeID) db->type[index];
+    ValueModelParameters* parameters = &(model->parameters);
+
+    PointValue value = db->value[index];
+    float newValue = 0.f;
+
+    switch (parameters->kind) {
+    case VALUE_MODEL_TOGGLE:
+        if (PointDB_getUntimedType(type) == M_DP_NA_1)
+            value.i = (value.i == IEC60870_DOUBLE_POINT_ON) ? IEC60870_DOUBLE_POINT_OFF : IEC60870_DOUBLE_POINT_ON;
+        else
+            value.i = !value.i;
+        break;
+
+    case VALUE_MODEL_RANDOM_WALK:
+        newValue = model->state + parameters->delta * (2.f * (float) rand() / (float) RAND_MAX - 1.f);
+
+        if (newValue < parameters->min) newValue = parameters->min;
+        if (newValue > parameters->max) newValue = parameters->max;
+        break;
+
+    case VALUE_MODEL_SINE:
+        newValue = (parameters->max + parameters->min) / 2.f + (parameters->max - parameters->min) / 2.f *
+                (float) sin(2.0 * M_PI * fmod((double) time, parameters->cycle * 1000.0) / (parameters->cycle * 1000.0));
+        break;
+
+    case VALUE_MODEL_RAMP:
+        newValue = model->state + parameters->delta;
+
+        if (newValue > parameters->max)
+            newValue = parameters->min;
+        break;
+
+    case VALUE_MODEL_STEP:
+        newValue = (model->state == parameters->max) ? parameters->min : parameters->max;
+        break;
+    }
+
+    if (parameters->kind != VALUE_MODEL_TOGGLE) {
+        model->state = newValue;
+
+        newValue = limitValue(type, newValue);
+
+        if (PointDB_getUntimedType(type) == M_ME_NB_1)
+            value.i = (int32_t) lrintf(newValue);
+        else
+            value.f = newValue;
+    }
+
+    PointDB_setValue(db, index, value, IEC60870_QUALITY_GOOD, time);
+
+    if (self->isPending[index] == 0) {
+        self->isPending[index] = 1;
+        self->pending[self->pendingCount++] = index;
+    }
+}
+
+static void
+modelTimerHandler(void* parameter, uint64_t expiry)
+{
+    ValueModel model = (ValueModel) parameter;
+    EventGenerator self = model->generator;
+
+    PointDB_lock(self->db);
+    updatePoint(self, model, getStationTime(self, expiry));
+    PointDB_unlock(self->db);
+
+    TimerWheel_add(self->wheel, expiry + getNextInterval(self, model), 0, modelTimerHandler, model);
+}
+
+static bool
+isModelSupported(ValueModelKind kind, TypeID type)
+{
+    if (kind == VALUE_MODEL_TOGGLE)
+        return isSwitchType(type);
+    else
+        return isMeasurandType(type);
+}
+
+int
+EventGenerator_start(EventGenerator self, CS101_AppLayerParameters alParams, int oa, int ca, bool startTimers,
+        uint32_t defaultMinInterval, uint32_t defaultMaxInterval)
+{
+    PointDB db = self->db;
+    int pointCount = PointDB_getCount(db);
+    int i;
+
+    self->alParams = alParams;
+    self->oa = oa;
+    self->ca = ca;
+
+    self->pending = (int32_t*) malloc((pointCount > 0 ? pointCount : 1) * sizeof(int32_t));
+    self->isPending = (uint8_t*) calloc(pointCount > 0 ? pointCount : 1, sizeof(uint8_t));
+
+    PointDB_lock(db);
+
+    /* explicitly configured models; the table is sorted now -> resolve the point indexes */
+    int modelCount = 0;
+
+    for (i = 0; i < self->modelCount; i++) {
+        ValueModel model = &(self->models[i]);
+        int index = PointDB_lookup(db, model->ioa);
+
+        if ((index == -1) || !isModelSupported(model->parameters.kind, (TypeID) db->type[index]))
+            continue;
+
+        /* marks the point as having a model */
+        self->isPending[index] = 1;
+
+        self->models[modelCount] = *model;
+        self->models[modelCount].index = index;
+        modelCount++;
+    }
+
+    if (defaultMinInterval > 0) {
+        for (i = 0; i < pointCount; i++) {
+            TypeID type = (TypeID) db->type[i];
+            ValueModelParameters parameters;
+
+            if (self->isPending[i])
+                continue;
+
+            if (isSwitchType(type))
+                ValueModelParameters_init(&parameters, VALUE_MODEL_TOGGLE);
+            else if (isMeasurandType(type)) {
+                /* walk around the configured value */
+                float value = (PointDB_getUntimedType(type) == M_ME_NB_1) ? (float) db->value[i].i : db->value[i].f;
+                float span = fabsf(value) * 0.1f + ((PointDB_getUntimedType(type) == M_ME_NA_1) ? 0.1f : 1.f);
+
+                ValueModelParameters_init(&parameters, VALUE_MODEL_RANDOM_WALK);
+                parameters.min = value - span;
+                parameters.max = value + span;
+                parameters.delta = span / 10.f;
+            }
+            else
+                continue;
+
+            parameters.minInterval = defaultMinInterval;
+            parameters.maxInterval = defaultMaxInterval;
+
+            if (!EventGenerator_addModel(self, db->ioa[i], &parameters))
+                break;
+
+            ValueModel model = &(self->models[self->modelCount - 1]);
+
+            model->index = i;
+
+            /* compact in place: explicit models are in [0, modelCount) */
+            self->models[modelCount++] = *model;
+        }
+    }
+
+    self->modelCount = modelCount;
+
+    uint64_t now = TimerWheel_getMonotonicTime();
+
+    for (i = 0; i < self->modelCount; i++) {
+        ValueModel model = &(self->models[i]);
+
+        model->generator = self;
+
+        if (model->parameters.kind != VALUE_MODEL_TOGGLE) {
+            float value = (PointDB_getUntimedType((TypeID) db->type[model->index]) == M_ME_NB_1) ?
+                    (float) db->value[model->index].i : db->value[model->index].f;
+
+            if ((model->parameters.kind == VALUE_MODEL_RANDOM_WALK) || (model->parameters.kind == VALUE_MODEL_RAMP))
+                model->state = value;
+        }
+
+        self->isPending[model->index] = 0;
+
+        /* random phase, so models with the same rate don't fire in the same tick */
+        if (startTimers)
+            TimerWheel_add(self->wheel, now + 1 + (uint64_t) getNextInterval(self, model) * (uint64_t) rand() / RAND_MAX, 0,
+                    modelTimerHandler, model);
+    }
+
+    PointDB_unlock(db);
+
+    return self->modelCount;
+}
+
+void
+EventGenerator_generate(EventGenerator self, int count, uint64_t now)
+{
+    if (self->modelCount == 0)
+        return;
+
+    /* one time tag for the whole batch */
+    uint64_t time = getStationTime(self, now);
+
+    PointDB_lock(self->db);
+
+    int i;
+    for (i = 0; i < count; i++) {
+        updatePoint(self, &(self->models[self->nextModel]), time);
+
+        if (++(self->nextModel) == self->modelCount)
+            self->nextModel = 0;
+    }
+
+    PointDB_unlock(self->db);
+}
+
+static bool
+enqueueASDU(void* parameter, CS101_ASDU asdu)
+{
+    SlaveQueue_enqueue((SlaveQueue) parameter, asdu);
+
+    return true;
+}
+
+static int
+compareIndexes(const void* a, const void* b)
+{
+    int32_t i1 = *((const int32_t*) a);
+    int32_t i2 = *((const int32_t*) b);
+
+    return (i1 < i2) ? -1 : (i1 > i2);
+}
+
+int
+EventGenerator_flush(EventGenerator self, SlaveQueue queue)
+{
+    int count = self->pendingCount;
+
+    if (count == 0)
+        return 0;
+
+    /* table order = ordered by type and IOA */
+    qsort(self->pending, count, sizeof(int32_t), compareIndexes);
+
+    struct sASDUPacker packer;
+    ASDUPacker_init(&packer, self->alParams, CS101_COT_SPONTANEOUS, self->oa, self->ca, enqueueASDU, queue);
+
+    PointDB_lock(self->db);
+
+    /* events keep the time tag of the point type */
+    ASDUPacker_addPoints(&packer, self->db, self->pending, count, false);
+    ASDUPacker_flush(&packer);
+
+    PointDB_unlock(self->db);
+
+    SlaveQueue_transmit(queue);
+
+    int i;
+    for (i = 0; i < count; i++)
+        self->isPending[self->pending[i]] = 0;
+
+    self->pendingCount = 0;
+
+    self->eventCount += count;
+    self->asduCount += packer.asduCount;
+
+    return count;
+}
+
+void
+EventGenerator_notify(EventGenerator self, int index)
+{
+    if (self->isPending && (self->isPending[index] == 0)) {
+        self->isPending[index] = 1;
+        self->pending[self->pendingCount++] = index;
+    }
+}
+
+void
+EventGenerator_setPointDB(EventGenerator self, PointDB db)
+{
+    int pointCount = PointDB_getCount(db);
+
+    free(self->pending);
+    free(self->isPending);
+
+    self->db = db;
+    self->pending = (int32_t*) malloc((pointCount > 0 ? pointCount : 1) * sizeof(int32_t));
+    self->isPending = (uint8_t*) calloc(pointCount > 0 ? pointCount : 1, sizeof(uint8_t));
+    self->pendingCount = 0;
+
+    int i;
+    for (i = 0; i < self->modelCount; i++) {
+        ValueModel model = &(self->models[i]);
+        int index = PointDB_lookup(db, model->ioa);
+
+        if ((index != -1) && !isModelSupported(model->parameters.kind, (TypeID) db->type[index]))
+            index = -1;
+
+        model->index = index;
+    }
+}
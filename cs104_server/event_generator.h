@@ -0,0 +1,189 @@
+#ifndef EVENT_GENERATOR_H_
+#define EVENT_GENERATOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+#include "timer_wheel.h"
+#include "slave_queue.h"
+#include "station_clock.h"
+
+/*
+ * Spontaneous event generator.
+ *
+ * Every point with a value model gets its own timer in the timer wheel. On
+ * expiry the model computes the next value, the point is updated in the
+ * table and queued as changed. EventGenerator_flush sends the queued points
+ * as spontaneous ASDUs (COT 3), ordered like the table so the ASDUPacker
+ * can batch them by type. A point that changes several times before the
+ * flush is reported once with its latest value.
+ *
+ * Without timers (load generator mode) the models are stepped round robin
+ * by EventGenerator_generate instead.
+ *
+ * With a station clock the events carry its time and the model intervals
+ * are in station time: at a clock speed of 60 a model with one event per
+ * minute fires every second. The time tags of a batch (the timers expired
+ * in one advance of the wheel, one EventGenerator_generate call) are
+ * computed from the time of the batch, not read per object.
+ *
+ * Models:
+ *   toggle  single/double points: ON <-> OFF
+ *   walk    measurands: random change of at most delta, limited to [min, max]
+ *   sine    measurands: sine between min and max with a period of cycle seconds
+ *   ramp    measurands: increases by delta, wraps from max to min
+ *   step    measurands: jumps between min and max
+ */
+
+typedef enum {
+    VALUE_MODEL_TOGGLE,
+    VALUE_MODEL_RANDOM_WALK,
+    VALUE_MODEL_SINE,
+    VALUE_MODEL_RAMP,
+    VALUE_MODEL_STEP
+} ValueModelKind;
+
+typedef struct {
+    ValueModelKind kind;
+
+    /* the interval between two events is random in [minInterval, maxInterval] ms */
+    uint32_t minInterval;
+    uint32_t maxInterval;
+
+    float min;
+    float max;
+    float delta;
+    float cycle;        /* sine period in s */
+} ValueModelParameters;
+
+typedef struct sValueModel* ValueModel;
+typedef struct sEventGenerator* EventGenerator;
+
+struct sValueModel {
+    ValueModelParameters parameters;
+
+    int32_t ioa;
+    int32_t index;      /* point index, resolved by EventGenerator_start, -1 = point removed */
+    float state;        /* current value of ramp and random walk */
+
+    EventGenerator generator;
+};
+
+struct sEventGenerator {
+    PointDB db;
+    TimerWheel wheel;
+
+    CS101_AppLayerParameters alParams;
+    int oa;
+    int ca;
+
+    ValueModel models;
+    int modelCount;
+    int modelCapacity;
+
+    /* event rates of all models are multiplied by this factor */
+    int rateMultiplier;
+
+    /* time tags and model time, NULL = system time */
+    StationClock clock;
+
+    /* next model stepped by EventGenerator_generate */
+    int nextModel;
+
+    /* changed points waiting for the next flush */
+    int32_t* pending;
+    int pendingCount;
+    uint8_t* isPending;
+
+    /* statistics */
+    uint64_t eventCount;
+    uint64_t asduCount;
+};
+
+/**
+ * Initialize the parameters with the defaults of the model kind
+ * (one event per second).
+ */
+void
+ValueModelParameters_init(ValueModelParameters* self, ValueModelKind kind);
+
+/**
+ * \return true when name is a model name (toggle, walk, sine, ramp, step)
+ */
+bool
+ValueModel_parseKind(const char* name, ValueModelKind* kind);
+
+EventGenerator
+EventGenerator_create(PointDB db, TimerWheel wheel);
+
+void
+EventGenerator_destroy(EventGenerator self);
+
+/**
+ * Assign a value model to a point. Can be called before the point table
+ * is sorted.
+ */
+bool
+EventGenerator_addModel(EventGenerator self, int ioa, const ValueModelParameters* parameters);
+
+/**
+ * Add copies of the models of another generator (before EventGenerator_start).
+ */
+void
+EventGenerator_copyModels(EventGenerator self, EventGenerator other);
+
+/**
+ * \return the current time of the generator in ms since 1970 (station clock
+ *         or system time)
+ */
+uint64_t
+EventGenerator_getTime(EventGenerator self);
+
+/**
+ * Resolve the points of the models and start their timers.
+ *
+ * \param startTimers false when the models are stepped by EventGenerator_generate
+ * \param defaultMinInterval when > 0 every single/double point and measurand
+ *        without a model gets a toggle or random walk model with an event
+ *        interval in [defaultMinInterval, defaultMaxInterval] ms
+ *
+ * \return the number of started models
+ */
+int
+EventGenerator_start(EventGenerator self, CS101_AppLayerParameters alParams, int oa, int ca, bool startTimers,
+        uint32_t defaultMinInterval, uint32_t defaultMaxInterval);
+
+/**
+ * Step the next count models (round robin) and queue the changed points.
+ *
+ * \param now monotonic time of the batch (ms), all its events get the same time tag
+ */
+void
+EventGenerator_generate(EventGenerator self, int count, uint64_t now);
+
+/**
+ * Send the points changed since the last flush.
+ *
+ * \return the number of reported points
+ */
+int
+EventGenerator_flush(EventGenerator self, SlaveQueue queue);
+
+/**
+ * Report a point changed by someone else with the next flush (caller holds
+ * the table lock).
+ */
+void
+EventGenerator_notify(EventGenerator self, int index);
+
+/**
+ * Move the models to a new table (hot reload): the points are resolved
+ * again by IOA, models of removed points stop changing. Pending events are
+ * dropped, flush before.
+ */
+void
+EventGenerator_setPointDB(EventGenerator self, PointDB db);
+
+#endif /* EVENT_GENERATOR_H_ */
@@ -0,0 +1,343 @@
+/*
+ * Station interrogation benchmark
+ *
+ * Encodes the GI response of a synthetic point table with one information
+ * object per ASDU (the old interrogationHandler), with packed SQ=0 ASDUs and
+ * with packed ASDUs using SQ=1 for consecutive IOAs. It also measures serving
+ * the response from the pre-encoded GI cache. It reports encode time, number
+ * of APDUs, bytes on the wire and the number of k windows the response
+ * takes (computed from the APDU count, a lower bound of the round trips).
+ *
+ * The loopback part measures what a master sees: a CS104_Connection sends
+ * C_IC_NA_1 to a threadless slave on 127.0.0.1 and the time from sending the
+ * activation to receiving the ACT_TERM is taken, for the old one object per
+ * ASDU response and for the packed response. Transmission, the k window and
+ * the acknowledgements of the master are part of this time.
+ *
+ * usage: gi_benchmark [number of points ...]   (default: 10000 100000)
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "cs104_slave.h"
+#include "cs104_connection.h"
+#include "point_db.h"
+#include "asdu_packer.h"
+#include "gi_cache.h"
+
+#define APCI_SIZE 6
+#define K_WINDOW 12
+#define REPETITIONS 20
+
+#define LOOPBACK_PORT 12404
+#define LOOPBACK_REPETITIONS 5
+#define LOOPBACK_TIMEOUT 60000   /* ms for one interrogation */
+
+typedef struct {
+    int headerSize;
+    long frames;
+    long bytes;
+} WireCounter;
+
+static bool
+countFrame(void* parameter, CS101_ASDU asdu)
+{
+    WireCounter* counter = (WireCounter*) parameter;
+
+    counter->frames++;
+    counter->bytes += APCI_SIZE + counter->headerSize + CS101_ASDU_getPayloadSize(asdu);
+
+    return true;
+}
+
+static double
+nowInMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/* Dense IOA ranges with a typical substation mix of point types */
+static PointDB
+createPointTable(int numberOfPoints)
+{
+    PointDB db = PointDB_create();
+
+    int i;
+    for (i = 0; i < numberOfPoints; i++) {
+        TypeID type;
+
+        switch ((i * 10) / numberOfPoints) {
+        case 0: case 1: case 2: case 3:
+            type = M_SP_NA_1;
+            break;
+        case 4: case 5:
+            type = M_DP_NA_1;
+            break;
+        case 6: case 7:
+            type = M_ME_NB_1;
+            break;
+        default:
+            type = M_ME_NC_1;
+            break;
+        }
+
+        PointDB_add(db, type, 1000 + i, (float) (i % 3));
+    }
+
+    PointDB_sort(db);
+
+    return db;
+}
+
+static void
+runBenchmark(PointDB db, CS101_AppLayerParameters alParams, const char* name, int maxObjects, bool useSequence)
+{
+    WireCounter counter;
+    struct sASDUPacker packer;
+    int i;
+
+    counter.headerSize = alParams->sizeOfTypeId + alParams->sizeOfVSQ + alParams->sizeOfCOT + alParams->sizeOfCA;
+
+    double start = nowInMs();
+
+    for (i = 0; i < REPETITIONS; i++) {
+        counter.frames = 0;
+        counter.bytes = 0;
+
+        ASDUPacker_init(&packer, alParams, CS101_COT_INTERROGATED_BY_STATION, 0, 1, countFrame, &counter);
+        packer.maxObjects = maxObjects;
+        packer.useSequence = useSequence;
+
+        ASDUPacker_addMonitoredPoints(&packer, db);
+        ASDUPacker_flush(&packer);
+    }
+
+    double encodeTime = (nowInMs() - start) / REPETITIONS;
+
+    printf("  %-24s %10.3f ms %9ld APDUs %11ld bytes %8ld k windows\n", name, encodeTime,
+            counter.frames, counter.bytes, (counter.frames + K_WINDOW - 1) / K_WINDOW);
+}
+
+static void
+runCacheBenchmark(PointDB db, CS101_AppLayerParameters alParams)
+{
+    WireCounter counter;
+    int i;
+
+    counter.headerSize = alParams->sizeOfTypeId + alParams->sizeOfVSQ + alParams->sizeOfCOT + alParams->sizeOfCA;
+
+    GICache cache = GICache_create(db, NULL, PointDB_getCount(db), alParams, CS101_COT_INTERROGATED_BY_STATION, 0, 1);
+
+    double start = nowInMs();
+
+    for (i = 0; i < REPETITIONS; i++) {
+        counter.frames = 0;
+        counter.bytes = 0;
+
+        int frame = 0;
+        GICache_send(cache, &frame, countFrame, &counter);
+    }
+
+    double sendTime = (nowInMs() - start) / REPETITIONS;
+
+    printf("  %-24s %10.3f ms %9ld APDUs %11ld bytes %8ld k windows\n", "GI cache (unchanged)", sendTime,
+            counter.frames, counter.bytes, (counter.frames + K_WINDOW - 1) / K_WINDOW);
+
+    GICache_destroy(cache);
+}
+
+/* slave side of the loopback benchmark, the response mode is switched between the runs */
+typedef struct {
+    PointDB db;
+    int maxObjects;
+    bool useSequence;
+} LoopbackServer;
+
+/* master side, written by the receive thread of the connection */
+typedef struct {
+    bool started;
+    bool terminated;
+    long frames;
+    double terminationTime;
+} LoopbackMaster;
+
+static bool
+sendToMaster(void* parameter, CS101_ASDU asdu)
+{
+    return IMasterConnection_sendASDU((IMasterConnection) parameter, asdu);
+}
+
+static bool
+loopbackInterrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
+{
+    LoopbackServer* server = (LoopbackServer*) parameter;
+    struct sASDUPacker packer;
+
+    IMasterConnection_sendACT_CON(connection, asdu, false);
+
+    /* the high priority queue holds the whole response, the slave sends it as the k window allows */
+    ASDUPacker_init(&packer, IMasterConnection_getApplicationLayerParameters(connection), CS101_COT_INTERROGATED_BY_STATION,
+            0, CS101_ASDU_getCA(asdu), sendToMaster, connection);
+    packer.maxObjects = server->maxObjects;
+    packer.useSequence = server->useSequence;
+
+    PointDB_lock(server->db);
+    ASDUPacker_addMonitoredPoints(&packer, server->db);
+    ASDUPacker_flush(&packer);
+    PointDB_unlock(server->db);
+
+    IMasterConnection_sendACT_TERM(connection, asdu);
+
+    return true;
+}
+
+static void
+loopbackConnectionHandler(void* parameter, CS104_Connection connection, CS104_ConnectionEvent event)
+{
+    LoopbackMaster* master = (LoopbackMaster*) parameter;
+
+    if (event == CS104_CONNECTION_STARTDT_CON_RECEIVED)
+        __atomic_store_n(&(master->started), true, __ATOMIC_RELEASE);
+}
+
+static bool
+loopbackASDUHandler(void* parameter, int address, CS101_ASDU asdu)
+{
+    LoopbackMaster* master = (LoopbackMaster*) parameter;
+
+    if (CS101_ASDU_getTypeID(asdu) != C_IC_NA_1)
+        master->frames++;
+    else if (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION_TERMINATION) {
+        master->terminationTime = nowInMs();
+        __atomic_store_n(&(master->terminated), true, __ATOMIC_RELEASE);
+    }
+
+    return true;
+}
+
+/* tick the slave until the flag is set, false on timeout */
+static bool
+tickUntil(CS104_Slave slave, bool* flag)
+{
+    double deadline = nowInMs() + LOOPBACK_TIMEOUT;
+
+    while (__atomic_load_n(flag, __ATOMIC_ACQUIRE) == false) {
+        if (nowInMs() > deadline)
+            return false;
+
+        CS104_Slave_tick(slave);
+    }
+
+    return true;
+}
+
+static void
+runLoopbackBenchmark(CS104_Slave slave, CS104_Connection connection, LoopbackServer* server, LoopbackMaster* master,
+        const char* name, int maxObjects, bool useSequence)
+{
+    double total = 0;
+    int i;
+
+    server->maxObjects = maxObjects;
+    server->useSequence = useSequence;
+
+    for (i = 0; i < LOOPBACK_REPETITIONS; i++) {
+        master->frames = 0;
+        __atomic_store_n(&(master->terminated), false, __ATOMIC_RELEASE);
+
+        double start = nowInMs();
+
+        CS104_Connection_sendInterrogationCommand(connection, CS101_COT_ACTIVATION, 1, IEC60870_QOI_STATION);
+
+        if (!tickUntil(slave, &(master->terminated))) {
+            printf("  %-24s no ACT_TERM within %d ms\n", name, LOOPBACK_TIMEOUT);
+            return;
+        }
+
+        total += master->terminationTime - start;
+    }
+
+    printf("  %-24s %10.3f ms %9ld APDUs\n", name, total / LOOPBACK_REPETITIONS, master->frames);
+}
+
+static void
+runLoopbackBenchmarks(PointDB db)
+{
+    LoopbackServer server = { db, 0, true };
+    LoopbackMaster master = { false, false, 0, 0 };
+
+    CS104_Slave slave = CS104_Slave_create(10, PointDB_getCount(db) + 16);
+    CS104_Slave_setLocalAddress(slave, "127.0.0.1");
+    CS104_Slave_setLocalPort(slave, LOOPBACK_PORT);
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    CS104_Slave_setInterrogationHandler(slave, loopbackInterrogationHandler, &server);
+    CS104_Slave_startThreadless(slave);
+
+    CS104_Connection connection = CS104_Connection_create("127.0.0.1", LOOPBACK_PORT);
+    CS104_Connection_setConnectionHandler(connection, loopbackConnectionHandler, &master);
+    CS104_Connection_setASDUReceivedHandler(connection, loopbackASDUHandler, &master);
+
+    printf("GI activation to ACT_TERM over loopback (k = %d, average of %d runs):\n",
+            CS104_Slave_getConnectionParameters(slave)->k, LOOPBACK_REPETITIONS);
+
+    if (CS104_Connection_connect(connection)) {
+        CS104_Connection_sendStartDT(connection);
+
+        if (tickUntil(slave, &(master.started))) {
+            runLoopbackBenchmark(slave, connection, &server, &master, "one object per ASDU", 1, false);
+            runLoopbackBenchmark(slave, connection, &server, &master, "packed ASDUs (SQ=1 runs)", 0, true);
+        }
+        else
+            printf("  no STARTDT_CON from the slave\n");
+    }
+    else
+        printf("  cannot connect to 127.0.0.1:%d\n", LOOPBACK_PORT);
+
+    CS104_Connection_destroy(connection);
+
+    CS104_Slave_stopThreadless(slave);
+    CS104_Slave_destroy(slave);
+}
+
+int
+main(int argc, char** argv)
+{
+    static const int defaultSizes[] = { 10000, 100000 };
+
+    struct sCS101_AppLayerParameters alParams = {
+        /* .sizeOfTypeId = */ 1,
+        /* .sizeOfVSQ = */ 1,
+        /* .sizeOfCOT = */ 2,
+        /* .originatorAddress = */ 0,
+        /* .sizeOfCA = */ 2,
+        /* .sizeOfIOA = */ 3,
+        /* .maxSizeOfASDU = */ 249
+    };
+
+    int numberOfRuns = (argc > 1) ? (argc - 1) : 2;
+
+    int run;
+    for (run = 0; run < numberOfRuns; run++) {
+        int numberOfPoints = (argc > 1) ? atoi(argv[run + 1]) : defaultSizes[run];
+
+        PointDB db = createPointTable(numberOfPoints);
+
+        printf("GI response encoding for %d points (average of %d runs):\n", numberOfPoints, REPETITIONS);
+
+        runBenchmark(db, &alParams, "one object per ASDU", 1, false);
+        runBenchmark(db, &alParams, "packed ASDUs (SQ=0)", 0, false);
+        runBenchmark(db, &alParams, "packed ASDUs (SQ=1 runs)", 0, true);
+        runCacheBenchmark(db, &alParams);
+
+        runLoopbackBenchmarks(db);
+
+        PointDB_destroy(db);
+    }
+
+    return 0;
+}
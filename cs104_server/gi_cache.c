@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "gi_cache.h"
+
+static bool
+recordFrame(void* parameter, CS101_ASDU asdu)
+{
+    GICache self = (GICache) parameter;
+
+    if (self->frameCount == self->frameCapacity) {
+        int newCapacity = (self->frameCapacity > 0) ? (self->frameCapacity * 2) : 16;
+
+        GICacheFrame frames = (GICacheFrame) realloc(self->frames, newCapacity * sizeof(struct sGICacheFrame));
+
+        if (frames == NULL)
+            return false;
+
+        self->frames = frames;
+        self->frameCapacity = newCapacity;
+    }
+
+    GICacheFrame frame = &(self->frames[self->frameCount]);
+
+    /* the static ASDU points into itself and must not move -> separate allocation */
+    frame->asdu = (CS101_StaticASDU) malloc(sizeof(struct sCS101_StaticASDU));
+
+    if (frame->asdu == NULL)
+        return false;
+
+    CS101_ASDU_clone(asdu, frame->asdu);
+
+    frame->type = CS101_ASDU_getTypeID(asdu);
+    frame->isSequence = CS101_ASDU_isSequence(asdu);
+    frame->first = (self->frameCount > 0) ? (self->frames[self->frameCount - 1].first + self->frames[self->frameCount - 1].count) : 0;
+    frame->count = CS101_ASDU_getNumberOfElements(asdu);
+    frame->version = PointDB_getVersion(self->db);
+
+    frame->minIndex = self->points[frame->first];
+    frame->maxIndex = self->points[frame->first];
+
+    int i;
+    for (i = frame->first + 1; i < frame->first + frame->count; i++) {
+        if (self->points[i] < frame->minIndex)
+            frame->minIndex = self->points[i];
+        if (self->points[i] > frame->maxIndex)
+            frame->maxIndex = self->points[i];
+    }
+
+    self->frameCount++;
+
+    return true;
+}
+
+GICache
+GICache_create(PointDB db, const int32_t* indexes, int count, CS101_AppLayerParameters alParams,
+        CS101_CauseOfTransmission cot, int oa, int ca)
+{
+    GICache self = (GICache) calloc(1, sizeof(struct sGICache));
+
+    if (self) {
+        self->db = db;
+        self->alParams = alParams;
+        self->cot = cot;
+        self->oa = oa;
+        self->ca = ca;
+        self->lock = Semaphore_create(1);
+        self->references = 1;
+
+        PointDB_lock(db);
+
+        /* only points reported by GI are part of the response, so a frame covers consecutive list entries */
+        self->points = (int32_t*) malloc((count > 0 ? count : 1) * sizeof(int32_t));
+
+        int i;
+        for (i = 0; i < count; i++) {
+            int index = indexes ? indexes[i] : i;
+
+            if (PointDB_isInterrogatedType((TypeID) db->type[index]))
+                self->points[self->pointCount++] = index;
+        }
+
+        struct sASDUPacker packer;
+        ASDUPacker_init(&packer, alParams, cot, oa, ca, recordFrame, self);
+        ASDUPacker_addPoints(&packer, db, self->points, self->pointCount, true);
+        ASDUPacker_flush(&packer);
+
+        PointDB_unlock(db);
+    }
+
+    return self;
+}
+
+GICache
+GICache_createEncoded(PointDB db, const int32_t* points, int pointCount, CS101_AppLayerParameters alParams,
+        CS101_CauseOfTransmission cot, int oa, int ca, const GICacheEncodedFrame* frames, int frameCount,
+        const uint8_t* asdus)
+{
+    GICache self = (GICache) calloc(1, sizeof(struct sGICache));
+
+    if (self == NULL)
+        return NULL;
+
+    self->db = db;
+    self->alParams = alParams;
+    self->cot = cot;
+    self->oa = oa;
+    self->ca = ca;
+    self->lock = Semaphore_create(1);
+    self->references = 1;
+
+    self->points = (int32_t*) malloc((pointCount > 0 ? pointCount : 1) * sizeof(int32_t));
+    memcpy(self->points, points, pointCount * sizeof(int32_t));
+    self->pointCount = pointCount;
+
+    self->frames = (GICacheFrame) calloc((frameCount > 0 ? frameCount : 1), sizeof(struct sGICacheFrame));
+    self->frameCapacity = (frameCount > 0 ? frameCount : 1);
+
+    int i;
+    for (i = 0; i < frameCount; i++) {
+        GICacheFrame frame = &(self->frames[i]);
+
+        CS101_ASDU asdu = CS101_ASDU_createFromBuffer(alParams, (uint8_t*) asdus, frames[i].length);
+
+        if (asdu == NULL) {
+            GICache_destroy(self);
+            return NULL;
+        }
+
+        frame->asdu = (CS101_StaticASDU) malloc(sizeof(struct sCS101_StaticASDU));
+        CS101_ASDU_clone(asdu, frame->asdu);
+        CS101_ASDU_destroy(asdu);
+
+        frame->type = (TypeID) frames[i].type;
+        frame->isSequence = frames[i].isSequence;
+        frame->first = frames[i].first;
+        frame->count = frames[i].count;
+        frame->minIndex = frames[i].minIndex;
+        frame->maxIndex = frames[i].maxIndex;
+        frame->version = PointDB_getVersion(db);
+
+        self->frameCount++;
+
+        asdus += frames[i].length;
+    }
+
+    return self;
+}
+
+void
+GICache_destroy(GICache self)
+{
+    if (self) {
+        int i;
+        for (i = 0; i < self->frameCount; i++)
+            free(self->frames[i].asdu);
+
+        free(self->frames);
+        free(self->points);
+        Semaphore_destroy(self->lock);
+        free(self);
+    }
+}
+
+GICache
+GICache_retain(GICache self)
+{
+    __atomic_add_fetch(&(self->references), 1, __ATOMIC_RELAXED);
+
+    return self;
+}
+
+void
+GICache_release(GICache self)
+{
+    if (self && (__atomic_sub_fetch(&(self->references), 1, __ATOMIC_ACQ_REL) == 0))
+        GICache_destroy(self);
+}
+
+/* caller holds the table lock */
+static void
+encodeFrame(GICache self, GICacheFrame frame)
+{
+    PointIOBuffer ioStorage;
+
+    CS101_ASDU asdu = CS101_ASDU_initializeStatic(frame->asdu, self->alParams, frame->isSequence, self->cot,
+            self->oa, self->ca, false, false);
+
+    int i;
+    for (i = frame->first; i < frame->first + frame->count; i++) {
+        InformationObject io = PointDB_getInformationObject(self->db, self->points[i], frame->type,
+                (InformationObject) &ioStorage);
+
+        CS101_ASDU_addInformationObject(asdu, io);
+    }
+
+    frame->version = PointDB_getVersion(self->db);
+}
+
+bool
+GICache_send(GICache self, int* frame, ASDUPacker_SendHandler handler, void* parameter)
+{
+    int i;
+
+    Semaphore_wait(self->lock);
+
+    /* each frame is checked right before it is sent: a frame refused by the connection
+     * is checked again when the response continues, the frames after it not at all */
+    for (i = *frame; i < self->frameCount; i++) {
+        GICacheFrame f = &(self->frames[i]);
+
+        PointDB_lock(self->db);
+
+        bool changed = PointDB_isChangedSince(self->db, f->minIndex, f->maxIndex, f->version);
+
+        if (changed)
+            encodeFrame(self, f);
+
+        PointDB_unlock(self->db);
+
+        if (handler(parameter, (CS101_ASDU) f->asdu) == false)
+            break;
+
+        if (changed)
+            self->misses++;
+        else
+            self->hits++;
+    }
+
+    *frame = i;
+
+    Semaphore_post(self->lock);
+
+    return (i >= self->frameCount);
+}
+
+const uint8_t*
+GICache_getEncodedFrame(GICache self, int frame, GICacheEncodedFrame* layout)
+{
+    GICacheFrame f = &(self->frames[frame]);
+
+    layout->first = f->first;
+    layout->count = f->count;
+    layout->minIndex = f->minIndex;
+    layout->maxIndex = f->maxIndex;
+    layout->type = (uint8_t) f->type;
+    layout->isSequence = f->isSequence ? 1 : 0;
+    layout->length = (uint16_t) (f->asdu->asduHeaderLength + f->asdu->payloadSize);
+
+    return f->asdu->asdu;
+}
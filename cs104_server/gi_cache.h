@@ -0,0 +1,139 @@
+#ifndef GI_CACHE_H_
+#define GI_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "hal_thread.h"
+#include "point_db.h"
+#include "asdu_packer.h"
+
+/*
+ * Pre-encoded interrogation response for a list of points.
+ *
+ * The response is encoded once with the ASDUPacker and kept as a list of
+ * frames. Each frame remembers the table version it was encoded at and the
+ * range of point indexes it covers. Before the frames are sent, only frames
+ * whose points changed since then are encoded again. Frame boundaries never
+ * move because the encoded size of a point depends on its type only.
+ */
+
+typedef struct sGICacheFrame* GICacheFrame;
+
+struct sGICacheFrame {
+    CS101_StaticASDU asdu;
+    TypeID type;
+    bool isSequence;
+
+    int first;          /* position of the first point in the point list */
+    int count;
+
+    int minIndex;       /* point index range covered by the frame */
+    int maxIndex;
+
+    uint64_t version;   /* table version when encoded */
+};
+
+/* Layout of a frame encoded before, as stored in a binary point image */
+typedef struct {
+    int32_t first;
+    int32_t count;
+    int32_t minIndex;
+    int32_t maxIndex;
+    uint8_t type;
+    uint8_t isSequence;
+    uint16_t length;    /* size of the raw ASDU */
+} GICacheEncodedFrame;
+
+typedef struct sGICache* GICache;
+
+struct sGICache {
+    PointDB db;
+
+    CS101_AppLayerParameters alParams;
+    CS101_CauseOfTransmission cot;
+    int oa;
+    int ca;
+
+    int32_t* points;    /* indexes of the monitored points */
+    int pointCount;
+
+    GICacheFrame frames;
+    int frameCount;
+    int frameCapacity;
+
+    Semaphore lock;
+
+    /* statistics: frames sent without/with encoding */
+    uint64_t hits;
+    uint64_t misses;
+
+    /* owners of the cache (station, pending GI responses), see GICache_release */
+    int references;
+};
+
+/**
+ * Create the cache for the given point indexes (NULL for all points of the table)
+ * and encode all frames.
+ */
+GICache
+GICache_create(PointDB db, const int32_t* indexes, int count, CS101_AppLayerParameters alParams,
+        CS101_CauseOfTransmission cot, int oa, int ca);
+
+/**
+ * Create the cache from frames encoded before (see GICache_getEncodedFrame),
+ * no point is encoded. The frames have to be encoded from the same table
+ * with the same application layer parameters.
+ *
+ * \param points indexes of the monitored points of the response
+ * \param asdus the raw ASDUs of all frames, one after another
+ *
+ * \return the cache, NULL when a frame cannot be decoded
+ */
+GICache
+GICache_createEncoded(PointDB db, const int32_t* points, int pointCount, CS101_AppLayerParameters alParams,
+        CS101_CauseOfTransmission cot, int oa, int ca, const GICacheEncodedFrame* frames, int frameCount,
+        const uint8_t* asdus);
+
+void
+GICache_destroy(GICache self);
+
+/**
+ * Take another reference to the cache (any thread). A response continued
+ * later keeps the cache it started with.
+ *
+ * \return the cache
+ */
+GICache
+GICache_retain(GICache self);
+
+/**
+ * Drop a reference, the last one destroys the cache. The create functions
+ * return the cache with one reference.
+ */
+void
+GICache_release(GICache self);
+
+/**
+ * \param layout returns the layout of the frame
+ *
+ * \return the raw ASDU of the frame (layout->length bytes)
+ */
+const uint8_t*
+GICache_getEncodedFrame(GICache self, int frame, GICacheEncodedFrame* layout);
+
+/**
+ * Pass the frames to the send handler, starting with the given frame. A
+ * frame whose points changed is encoded again just before it is passed.
+ * When the handler refuses a frame (send window of the connection full) the
+ * response can be continued with that frame later.
+ *
+ * \param frame first frame to send, returns the first frame not sent
+ *
+ * \return true when the last frame was sent
+ */
+bool
+GICache_send(GICache self, int* frame, ASDUPacker_SendHandler handler, void* parameter);
+
+#endif /* GI_CACHE_H_ */
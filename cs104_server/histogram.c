@@ -0,0 +1,79 @@
+#include <string.h>
+
+#include "histogram.h"
+
+void
+Histogram_init(Histogram* self)
+{
+    memset(self, 0, sizeof(Histogram));
+}
+
+void
+Histogram_add(Histogram* self, const Histogram* other)
+{
+    uint64_t count = __atomic_load_n(&(other->count), __ATOMIC_RELAXED);
+
+    if (count == 0)
+        return;
+
+    uint64_t min = __atomic_load_n(&(other->min), __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&(other->max), __ATOMIC_RELAXED);
+
+    if ((self->count == 0) || (min < self->min))
+        self->min = min;
+    if (max > self->max)
+        self->max = max;
+
+    self->count += count;
+    self->sum += __atomic_load_n(&(other->sum), __ATOMIC_RELAXED);
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        self->counts[i] += __atomic_load_n(&(other->counts[i]), __ATOMIC_RELAXED);
+}
+
+/* highest value that falls into the bucket */
+static uint64_t
+getBucketEnd(int bucket)
+{
+    if (bucket < HISTOGRAM_SUB_BUCKETS)
+        return (uint64_t) bucket;
+
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKET_BITS - 1;
+    uint64_t mantissa = (uint64_t) (bucket % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS);
+    int shift = exponent - HISTOGRAM_SUB_BUCKET_BITS;
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+uint64_t
+Histogram_getPercentile(const Histogram* self, double fraction)
+{
+    uint64_t total = 0;
+
+    /* the counts may run ahead of count while another thread records */
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+        total += self->counts[i];
+
+    if (total == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t) (fraction * (double) total + 0.5);
+
+    if (rank < 1)
+        rank = 1;
+    if (rank > total)
+        rank = total;
+
+    uint64_t seen = 0;
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += self->counts[i];
+
+        if (seen >= rank) {
+            uint64_t value = getBucketEnd(i);
+            return (value < self->max) ? value : self->max;
+        }
+    }
+
+    return self->max;
+}
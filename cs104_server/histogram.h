@@ -0,0 +1,93 @@
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Log-linear histogram of non-negative integer values (HDR style).
+ *
+ * Values below 2^HISTOGRAM_SUB_BUCKET_BITS have a bucket each. Above, every
+ * power of two is split into 2^HISTOGRAM_SUB_BUCKET_BITS equal buckets, so
+ * a bucket is at most 1/32 (about 3 %) of its value wide at any magnitude.
+ * Values up to 2^HISTOGRAM_MAX_EXPONENT (about 18 minutes in ns) are
+ * resolved, larger ones go into the last bucket; min, max, count and sum
+ * are exact.
+ *
+ * Recording is meant for a single writer thread: the counts are updated
+ * with relaxed stores, so another thread may read (Histogram_add) while
+ * values are recorded.
+ */
+
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_EXPONENT 40
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_EXPONENT - HISTOGRAM_SUB_BUCKET_BITS + 2) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct sHistogram Histogram;
+
+struct sHistogram {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t counts[HISTOGRAM_BUCKETS];
+};
+
+void
+Histogram_init(Histogram* self);
+
+static inline int
+Histogram_getBucket(uint64_t value)
+{
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return (int) value;
+
+    int exponent = 63 - __builtin_clzll(value);
+
+    if (exponent > HISTOGRAM_MAX_EXPONENT)
+        return HISTOGRAM_BUCKETS - 1;
+
+    /* the top HISTOGRAM_SUB_BUCKET_BITS + 1 bits of the value, without the leading one */
+    int subBucket = (int) (value >> (exponent - HISTOGRAM_SUB_BUCKET_BITS)) - HISTOGRAM_SUB_BUCKETS;
+
+    return (exponent - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+/**
+ * \brief Record one value (single writer)
+ */
+static inline void
+Histogram_record(Histogram* self, uint64_t value)
+{
+    int bucket = Histogram_getBucket(value);
+
+    __atomic_store_n(&(self->counts[bucket]), self->counts[bucket] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&(self->sum), self->sum + value, __ATOMIC_RELAXED);
+
+    if ((self->count == 0) || (value < self->min))
+        __atomic_store_n(&(self->min), value, __ATOMIC_RELAXED);
+    if (value > self->max)
+        __atomic_store_n(&(self->max), value, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&(self->count), self->count + 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Add the counts of other (may be recorded to at the same time) to self
+ */
+void
+Histogram_add(Histogram* self, const Histogram* other);
+
+/**
+ * \brief Value below which the given fraction of the recorded values lies
+ *
+ * Returns the upper end of the bucket holding the percentile, limited to
+ * the recorded maximum.
+ *
+ * \param fraction 0.5 for the median, 0.999 for p99.9
+ */
+uint64_t
+Histogram_getPercentile(const Histogram* self, double fraction);
+
+#endif /* HISTOGRAM_H_ */
@@ -0,0 +1,30 @@
+#ifndef IOA_HASH_H_
+#define IOA_HASH_H_
+
+#include <stdint.h>
+
+/*
+ * Hash of an information object address for the open addressing tables
+ * (IOA index of the point table, select state of the commands).
+ *
+ * The tables take the low bits of the hash as the slot. A plain
+ * multiplicative hash leaves the low bits depending on the low bits of the
+ * IOA only, so IOA plans with a power of two stride (256 or 1024 per RTU)
+ * pile up in a few probe chains. The murmur3 finalizer mixes every bit of
+ * the IOA into the low bits.
+ */
+static inline uint32_t
+IOAHash_get(int32_t ioa)
+{
+    uint32_t hash = (uint32_t) ioa;
+
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+#endif /* IOA_HASH_H_ */
@@ -0,0 +1,99 @@
+#include <stdlib.h>
+
+#include "load_generator.h"
+
+LoadGenerator
+LoadGenerator_create(EventGenerator generator, SlaveQueue queue, double rate, LoadUnit unit, double bucketSize)
+{
+    LoadGenerator self = (LoadGenerator) calloc(1, sizeof(struct sLoadGenerator));
+
+    if (self) {
+        self->generator = generator;
+        self->queue = queue;
+        self->rate = rate;
+        self->unit = unit;
+        self->bucketSize = (bucketSize >= 1.0) ? bucketSize : rate / 100.0;
+
+        if (self->bucketSize < 1.0)
+            self->bucketSize = 1.0;
+
+        /* until measured: as many objects as fit into an ASDU of single points */
+        self->objectsPerASDU = 30.0;
+
+        self->startTime = TimerWheel_getMonotonicTime();
+        self->lastTime = self->startTime;
+    }
+
+    return self;
+}
+
+void
+LoadGenerator_destroy(LoadGenerator self)
+{
+    free(self);
+}
+
+void
+LoadGenerator_setDutyCycle(LoadGenerator self, uint32_t onTime, uint32_t offTime)
+{
+    self->onTime = onTime;
+    self->offTime = offTime;
+}
+
+static bool
+isOn(LoadGenerator self, uint64_t now)
+{
+    if (self->offTime == 0)
+        return true;
+
+    return ((now - self->startTime) % (self->onTime + self->offTime)) < self->onTime;
+}
+
+int
+LoadGenerator_tick(LoadGenerator self, uint64_t now)
+{
+    EventGenerator generator = self->generator;
+
+    /* measure the objects per ASDU of the last flushes */
+    if (generator->asduCount > self->lastASDUCount) {
+        double measured = (double) (generator->eventCount - self->lastEventCount) /
+                (double) (generator->asduCount - self->lastASDUCount);
+
+        self->objectsPerASDU = 0.9 * self->objectsPerASDU + 0.1 * measured;
+
+        self->lastEventCount = generator->eventCount;
+        self->lastASDUCount = generator->asduCount;
+    }
+
+    if (isOn(self, now)) {
+        self->tokens += self->rate * (double) (now - self->lastTime) / 1000.0;
+
+        if (self->tokens > self->bucketSize)
+            self->tokens = self->bucketSize;
+    }
+
+    self->lastTime = now;
+
+    if (self->tokens < 1.0)
+        return 0;
+
+    /* back off while the queue is full, the saved tokens allow to catch up later */
+    if (SlaveQueue_isBlocked(self->queue) || (SlaveQueue_getFill(self->queue) >= self->queue->size)) {
+        self->backoffCount++;
+        return 0;
+    }
+
+    int tokens = (int) self->tokens;
+    int events;
+
+    if (self->unit == LOAD_UNIT_ASDUS)
+        events = (int) (tokens * self->objectsPerASDU + 0.5);
+    else
+        events = tokens;
+
+    self->tokens -= tokens;
+
+    EventGenerator_generate(generator, events, now);
+
+    return events;
+}
@@ -0,0 +1,80 @@
+#ifndef LOAD_GENERATOR_H_
+#define LOAD_GENERATOR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "event_generator.h"
+#include "slave_queue.h"
+
+/*
+ * Rate controlled load generator.
+ *
+ * A token bucket paces the spontaneous events of the EventGenerator to a
+ * target rate of events or ASDUs per second. The bucket size sets the
+ * burst shape: tokens saved while the generator is throttled (or during
+ * the off phase of the duty cycle) can be spent at once up to this size.
+ *
+ * For an ASDU rate the number of events per token is taken from the
+ * objects per ASDU measured by the previous flushes (closed loop). While
+ * the slave's queue is full, no events are generated (back off) so no
+ * messages have to be dropped.
+ */
+
+typedef enum {
+    LOAD_UNIT_EVENTS,
+    LOAD_UNIT_ASDUS
+} LoadUnit;
+
+typedef struct sLoadGenerator* LoadGenerator;
+
+struct sLoadGenerator {
+    EventGenerator generator;
+    SlaveQueue queue;
+
+    double rate;            /* target rate per second */
+    LoadUnit unit;
+    double bucketSize;      /* burst size in tokens */
+
+    uint32_t onTime;        /* duty cycle in ms, offTime 0 = always on */
+    uint32_t offTime;
+
+    double tokens;
+    uint64_t startTime;
+    uint64_t lastTime;
+
+    double objectsPerASDU;
+    uint64_t lastEventCount;
+    uint64_t lastASDUCount;
+
+    /* statistics */
+    uint64_t backoffCount;  /* ticks skipped because the queue was full */
+};
+
+/**
+ * \param rate target rate in unit per second
+ * \param bucketSize burst size in unit, < 1 for the default (10 ms of the rate)
+ */
+LoadGenerator
+LoadGenerator_create(EventGenerator generator, SlaveQueue queue, double rate, LoadUnit unit, double bucketSize);
+
+void
+LoadGenerator_destroy(LoadGenerator self);
+
+/**
+ * Generate load only during onTime ms of every onTime + offTime ms.
+ */
+void
+LoadGenerator_setDutyCycle(LoadGenerator self, uint32_t onTime, uint32_t offTime);
+
+/**
+ * Refill the bucket and generate the events allowed until now. The events
+ * are sent with the next EventGenerator_flush.
+ *
+ * \return number of generated events
+ */
+int
+LoadGenerator_tick(LoadGenerator self, uint64_t now);
+
+#endif /* LOAD_GENERATOR_H_ */
@@ -0,0 +1,310 @@
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "hal_time.h"
+#include "logger.h"
+
+#define WRITE_BUFFER_SIZE 65536
+
+static const char* levelNames[] = { "DEBUG", "INFO", "WARNING", "ERROR" };
+
+static const char* categoryNames[LOG_CATEGORY_COUNT] = {
+    "server", "config", "connection", "interrogation", "command", "message", "statistics"
+};
+
+Logger
+Logger_create(int capacity, FILE* console)
+{
+    Logger self = (Logger) calloc(1, sizeof(struct sLogger));
+
+    if (self) {
+        uint64_t size = 1;
+
+        if (capacity <= 0)
+            capacity = LOGGER_DEFAULT_CAPACITY;
+
+        while (size < (uint64_t) capacity)
+            size <<= 1;
+
+        self->records = (LogRecord*) malloc(size * sizeof(LogRecord));
+        self->capacity = size;
+        self->mask = size - 1;
+        self->level = LOG_INFO;
+        self->console = console;
+
+        /* slot i is free for the producer that takes position i */
+        for (uint64_t i = 0; i < size; i++)
+            self->records[i].sequence = i;
+    }
+
+    return self;
+}
+
+void
+Logger_setFile(Logger self, FILE* file)
+{
+    self->file = file;
+}
+
+void
+Logger_setLevel(Logger self, LogLevel level)
+{
+    self->level = level;
+}
+
+void
+Logger_setRateLimit(Logger self, uint32_t rateLimit)
+{
+    self->rateLimit = rateLimit;
+}
+
+bool
+Logger_parseLevel(const char* name, LogLevel* level)
+{
+    for (int i = LOG_DEBUG; i <= LOG_ERROR; i++) {
+        if (strcasecmp(name, levelNames[i]) == 0) {
+            *level = (LogLevel) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* false when the category used up its records for the current second */
+static bool
+checkRate(Logger self, LogCategory category, uint64_t timestamp)
+{
+    LogRateWindow* rate = &(self->rates[category]);
+    uint64_t window = timestamp / 1000;
+    uint64_t current = __atomic_load_n(&(rate->window), __ATOMIC_RELAXED);
+
+    /* the producer that moves the window resets the count, a few records at the edge may slip through */
+    if ((current != window) &&
+            __atomic_compare_exchange_n(&(rate->window), &current, window, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        __atomic_store_n(&(rate->count), 0, __ATOMIC_RELAXED);
+
+    return __atomic_add_fetch(&(rate->count), 1, __ATOMIC_RELAXED) <= self->rateLimit;
+}
+
+bool
+Logger_log(Logger self, LogLevel level, LogCategory category, const char* format, ...)
+{
+    if ((self == NULL) || (level < self->level))
+        return false;
+
+    uint64_t timestamp = Hal_getTimeInMs();
+
+    if ((self->rateLimit > 0) && !checkRate(self, category, timestamp)) {
+        __atomic_add_fetch(&(self->suppressed), 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    /* bounded multi-producer ring: a slot is free when its sequence equals the position */
+    uint64_t position = __atomic_load_n(&(self->enqueuePosition), __ATOMIC_RELAXED);
+    LogRecord* record;
+
+    for (;;) {
+        record = &(self->records[position & self->mask]);
+
+        uint64_t sequence = __atomic_load_n(&(record->sequence), __ATOMIC_ACQUIRE);
+        int64_t difference = (int64_t) (sequence - position);
+
+        if (difference == 0) {
+            if (__atomic_compare_exchange_n(&(self->enqueuePosition), &position, position + 1, true,
+                    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (difference < 0) {
+            /* the writer did not free this slot yet: ring full */
+            __atomic_add_fetch(&(self->dropped), 1, __ATOMIC_RELAXED);
+            return false;
+        }
+        else
+            position = __atomic_load_n(&(self->enqueuePosition), __ATOMIC_RELAXED);
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(record->text, LOGGER_TEXT_SIZE, format, args);
+    va_end(args);
+
+    if (length < 0)
+        length = 0;
+    if (length >= LOGGER_TEXT_SIZE)
+        length = LOGGER_TEXT_SIZE - 1;
+
+    /* one record is one line */
+    while ((length > 0) && (record->text[length - 1] == '\n'))
+        length--;
+
+    record->timestamp = timestamp;
+    record->level = (uint8_t) level;
+    record->category = (uint8_t) category;
+    record->length = (uint16_t) length;
+
+    __atomic_store_n(&(record->sequence), position + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static int
+formatRecord(const LogRecord* record, char* buffer, int size, time_t* lastSecond, char* timeText)
+{
+    time_t second = (time_t) (record->timestamp / 1000);
+
+    /* localtime only once per second */
+    if (second != *lastSecond) {
+        struct tm tm;
+#ifdef _WIN32
+        localtime_s(&tm, &second);
+#else
+        localtime_r(&second, &tm);
+#endif
+        strftime(timeText, 20, "%Y-%m-%d %H:%M:%S", &tm);
+        *lastSecond = second;
+    }
+
+    return snprintf(buffer, size, "%s.%03d %-7s %s: %.*s\n", timeText, (int) (record->timestamp % 1000),
+            levelNames[record->level], categoryNames[record->category], record->length, record->text);
+}
+
+static void
+writeBuffer(Logger self, const char* buffer, size_t length)
+{
+    if (length == 0)
+        return;
+
+    if (self->console) {
+        fwrite(buffer, 1, length, self->console);
+        fflush(self->console);
+    }
+
+    if (self->file) {
+        fwrite(buffer, 1, length, self->file);
+        fflush(self->file);
+    }
+}
+
+/* write all records available now, return their count */
+static int
+writeRecords(Logger self, char* buffer, time_t* lastSecond, char* timeText)
+{
+    size_t used = 0;
+    int count = 0;
+
+    for (;;) {
+        LogRecord* record = &(self->records[self->dequeuePosition & self->mask]);
+
+        if (__atomic_load_n(&(record->sequence), __ATOMIC_ACQUIRE) != self->dequeuePosition + 1)
+            break;
+
+        if (WRITE_BUFFER_SIZE - used < LOGGER_TEXT_SIZE + 64) {
+            writeBuffer(self, buffer, used);
+            used = 0;
+        }
+
+        used += formatRecord(record, buffer + used, (int) (WRITE_BUFFER_SIZE - used), lastSecond, timeText);
+
+        /* free the slot for the producer one lap ahead */
+        __atomic_store_n(&(record->sequence), self->dequeuePosition + self->capacity, __ATOMIC_RELEASE);
+        self->dequeuePosition++;
+        count++;
+    }
+
+    writeBuffer(self, buffer, used);
+
+    self->written += count;
+
+    return count;
+}
+
+static void
+reportLosses(Logger self, uint64_t* lastDropped, uint64_t* lastSuppressed)
+{
+    uint64_t dropped = __atomic_load_n(&(self->dropped), __ATOMIC_RELAXED);
+    uint64_t suppressed = __atomic_load_n(&(self->suppressed), __ATOMIC_RELAXED);
+
+    if ((dropped != *lastDropped) || (suppressed != *lastSuppressed)) {
+        Logger_log(self, LOG_WARNING, LOG_CATEGORY_SERVER, "%llu log records dropped (ring full), %llu suppressed (rate limit)",
+                (unsigned long long) (dropped - *lastDropped), (unsigned long long) (suppressed - *lastSuppressed));
+
+        *lastDropped = dropped;
+        *lastSuppressed = suppressed;
+    }
+}
+
+static void*
+writerThread(void* parameter)
+{
+    Logger self = (Logger) parameter;
+
+    char* buffer = (char*) malloc(WRITE_BUFFER_SIZE);
+    char timeText[20];
+    time_t lastSecond = -1;
+
+    uint64_t lastReport = Hal_getTimeInMs();
+    uint64_t lastDropped = 0;
+    uint64_t lastSuppressed = 0;
+
+    while (__atomic_load_n(&(self->running), __ATOMIC_ACQUIRE)) {
+        if (writeRecords(self, buffer, &lastSecond, timeText) == 0)
+            Thread_sleep(LOGGER_FLUSH_INTERVAL);
+
+        uint64_t now = Hal_getTimeInMs();
+
+        if (now - lastReport >= 1000) {
+            reportLosses(self, &lastDropped, &lastSuppressed);
+            lastReport = now;
+        }
+    }
+
+    /* records queued before the stop, then the final loss report */
+    writeRecords(self, buffer, &lastSecond, timeText);
+    reportLosses(self, &lastDropped, &lastSuppressed);
+    writeRecords(self, buffer, &lastSecond, timeText);
+
+    free(buffer);
+
+    return NULL;
+}
+
+void
+Logger_start(Logger self)
+{
+    if (self->running)
+        return;
+
+    self->running = true;
+    self->thread = Thread_create(writerThread, self, false);
+    Thread_start(self->thread);
+}
+
+void
+Logger_destroy(Logger self)
+{
+    if (self) {
+        if (self->running) {
+            __atomic_store_n(&(self->running), false, __ATOMIC_RELEASE);
+            Thread_destroy(self->thread);
+        }
+        else {
+            /* never started: write what was queued */
+            char* buffer = (char*) malloc(WRITE_BUFFER_SIZE);
+            char timeText[20];
+            time_t lastSecond = -1;
+
+            writeRecords(self, buffer, &lastSecond, timeText);
+            free(buffer);
+        }
+
+        if (self->file)
+            fclose(self->file);
+
+        free(self->records);
+        free(self);
+    }
+}
@@ -0,0 +1,150 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hal_thread.h"
+
+/*
+ * Asynchronous log writer.
+ *
+ * Producers (the main thread, the station worker threads) format their
+ * message into a fixed-size record of a bounded lock-free ring and return.
+ * One background thread takes the records out, adds the time stamp, level
+ * and category and writes them in batches to the console and the optional
+ * log file, with one fflush per batch.
+ *
+ * Producers never wait for the disk or the terminal:
+ *   - records below the log level are discarded before formatting
+ *   - every category may be limited to rateLimit records per second, the
+ *     excess is counted as suppressed
+ *   - when the ring is full, the record is counted as dropped
+ *
+ * The writer thread reports new drops and suppressions once a second.
+ */
+
+#define LOGGER_DEFAULT_CAPACITY 4096    /* records, rounded up to a power of two */
+#define LOGGER_TEXT_SIZE 112            /* message bytes per record, longer ones are truncated */
+#define LOGGER_FLUSH_INTERVAL 10        /* ms the writer sleeps when the ring is empty */
+
+typedef enum {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+} LogLevel;
+
+typedef enum {
+    LOG_CATEGORY_SERVER,
+    LOG_CATEGORY_CONFIG,
+    LOG_CATEGORY_CONNECTION,
+    LOG_CATEGORY_INTERROGATION,
+    LOG_CATEGORY_COMMAND,
+    LOG_CATEGORY_MESSAGE,       /* raw APDUs */
+    LOG_CATEGORY_STATISTICS,
+    LOG_CATEGORY_COUNT
+} LogCategory;
+
+typedef struct {
+    uint64_t sequence;      /* ring slot state */
+    uint64_t timestamp;     /* ms since epoch */
+    uint8_t level;
+    uint8_t category;
+    uint16_t length;
+    char text[LOGGER_TEXT_SIZE];
+} LogRecord;
+
+typedef struct {
+    uint64_t window;        /* second of the current window */
+    uint32_t count;         /* records in the current window */
+} LogRateWindow;
+
+typedef struct sLogger* Logger;
+
+struct sLogger {
+    LogRecord* records;
+    uint64_t capacity;
+    uint64_t mask;
+
+    uint64_t enqueuePosition;   /* shared by the producers */
+    uint64_t dequeuePosition;   /* writer thread only */
+
+    LogLevel level;
+    uint32_t rateLimit;         /* records per second and category, 0 = unlimited */
+    LogRateWindow rates[LOG_CATEGORY_COUNT];
+
+    FILE* console;
+    FILE* file;
+
+    /* statistics */
+    uint64_t written;
+    uint64_t dropped;           /* ring full */
+    uint64_t suppressed;        /* over the rate limit */
+
+    bool running;
+    Thread thread;
+};
+
+/**
+ * \param capacity number of records in the ring, 0 for LOGGER_DEFAULT_CAPACITY
+ * \param console stream for all records (usually stdout), may be NULL
+ */
+Logger
+Logger_create(int capacity, FILE* console);
+
+/**
+ * \brief Log file written in addition to the console, the logger closes it
+ *
+ * Must be set before Logger_start.
+ */
+void
+Logger_setFile(Logger self, FILE* file);
+
+void
+Logger_setLevel(Logger self, LogLevel level);
+
+/**
+ * \param rateLimit records per second and category, 0 = unlimited
+ */
+void
+Logger_setRateLimit(Logger self, uint32_t rateLimit);
+
+/**
+ * \brief Parse "debug", "info", "warning" or "error"
+ *
+ * \return false for an unknown name, level is unchanged
+ */
+bool
+Logger_parseLevel(const char* name, LogLevel* level);
+
+/**
+ * \brief Start the writer thread
+ *
+ * Records logged before are kept in the ring and written once it runs.
+ */
+void
+Logger_start(Logger self);
+
+/**
+ * \brief Queue a message, never blocks
+ *
+ * Safe to call from any thread.
+ *
+ * \return false when the record was filtered, suppressed or dropped
+ */
+bool
+Logger_log(Logger self, LogLevel level, LogCategory category, const char* format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 4, 5)))
+#endif
+;
+
+/**
+ * \brief Write all queued records, stop the writer thread and close the log file
+ */
+void
+Logger_destroy(Logger self);
+
+#endif /* LOGGER_H_ */
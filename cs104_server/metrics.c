@@ -0,0 +1,427 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+#include "metrics.h"
+
+/* ms the server waits for a connection before it checks for the stop */
+#define ACCEPT_TIMEOUT 200
+
+__thread MetricsCounters* metricsThreadCounters = NULL;
+
+/* blocks of all threads, only appended */
+static MetricsCounters* threadCounters = NULL;
+static Semaphore registryLock = NULL;
+
+void
+Metrics_init(void)
+{
+    if (registryLock == NULL)
+        registryLock = Semaphore_create(1);
+}
+
+MetricsCounters*
+Metrics_registerThread(void)
+{
+    MetricsCounters* counters = (MetricsCounters*) calloc(1, sizeof(MetricsCounters));
+
+    Semaphore_wait(registryLock);
+    counters->next = threadCounters;
+    __atomic_store_n(&threadCounters, counters, __ATOMIC_RELEASE);
+    Semaphore_post(registryLock);
+
+    metricsThreadCounters = counters;
+
+    return counters;
+}
+
+void
+MetricsBuffer_append(MetricsBuffer* self, const char* format, ...)
+{
+    for (;;) {
+        int available = self->capacity - self->length;
+
+        va_list args;
+        va_start(args, format);
+        int length = (available > 0) ? vsnprintf(self->data + self->length, available, format, args)
+                : vsnprintf(NULL, 0, format, args);
+        va_end(args);
+
+        if ((length < 0) || (length < available)) {
+            if (length > 0)
+                self->length += length;
+            return;
+        }
+
+        int capacity = (self->capacity > 0) ? self->capacity * 2 : 4096;
+        while (capacity - self->length <= length)
+            capacity *= 2;
+
+        char* data = (char*) realloc(self->data, capacity);
+        if (data == NULL)
+            return;
+
+        self->data = data;
+        self->capacity = capacity;
+    }
+}
+
+void
+Metrics_recordLatency(int type, MetricsPhase phase, uint64_t latency)
+{
+    MetricsCounters* counters = Metrics_getCounters();
+    Histogram* histogram = counters->latency[type & (METRICS_MAX_TYPE - 1)][phase];
+
+    if (histogram == NULL) {
+        histogram = (Histogram*) malloc(sizeof(Histogram));
+        if (histogram == NULL)
+            return;
+
+        Histogram_init(histogram);
+
+        /* a scrape may already look for it */
+        __atomic_store_n(&(counters->latency[type & (METRICS_MAX_TYPE - 1)][phase]), histogram, __ATOMIC_RELEASE);
+    }
+
+    Histogram_record(histogram, latency);
+}
+
+bool
+Metrics_getLatency(int type, MetricsPhase phase, Histogram* result)
+{
+    bool found = false;
+
+    for (MetricsCounters* c = __atomic_load_n(&threadCounters, __ATOMIC_ACQUIRE); c; c = c->next) {
+        Histogram* histogram = __atomic_load_n(&(c->latency[type][phase]), __ATOMIC_ACQUIRE);
+
+        if (histogram) {
+            Histogram_add(result, histogram);
+            found = true;
+        }
+    }
+
+    return found && (result->count > 0);
+}
+
+#define SUM(field, result) \
+    do { \
+        result = 0; \
+        for (MetricsCounters* c = first; c; c = c->next) \
+            result += __atomic_load_n(&(c->field), __ATOMIC_RELAXED); \
+    } while (0)
+
+void
+Metrics_write(MetricsBuffer* out)
+{
+    MetricsCounters* first = __atomic_load_n(&threadCounters, __ATOMIC_ACQUIRE);
+    uint64_t value, value2;
+
+    MetricsBuffer_append(out, "# HELP iec104_asdus_sent_total ASDUs sent by type and cause of transmission\n"
+            "# TYPE iec104_asdus_sent_total counter\n");
+
+    for (int type = 0; type < METRICS_MAX_TYPE; type++) {
+        for (int cot = 0; cot < METRICS_MAX_COT; cot++) {
+            SUM(asdus[type][cot], value);
+
+            if (value > 0)
+                MetricsBuffer_append(out, "iec104_asdus_sent_total{type=\"%d\",cot=\"%d\"} %llu\n", type, cot,
+                        (unsigned long long) value);
+        }
+    }
+
+    MetricsBuffer_append(out, "# HELP iec104_objects_sent_total Information objects sent by type and cause of transmission\n"
+            "# TYPE iec104_objects_sent_total counter\n");
+
+    for (int type = 0; type < METRICS_MAX_TYPE; type++) {
+        for (int cot = 0; cot < METRICS_MAX_COT; cot++) {
+            SUM(objects[type][cot], value);
+
+            if (value > 0)
+                MetricsBuffer_append(out, "iec104_objects_sent_total{type=\"%d\",cot=\"%d\"} %llu\n", type, cot,
+                        (unsigned long long) value);
+        }
+    }
+
+    SUM(connectionsOpened, value);
+    SUM(connectionsClosed, value2);
+    MetricsBuffer_append(out, "# HELP iec104_connections_opened_total Master connections opened\n"
+            "# TYPE iec104_connections_opened_total counter\n"
+            "iec104_connections_opened_total %llu\n", (unsigned long long) value);
+    MetricsBuffer_append(out, "# HELP iec104_connections_open Master connections open now\n"
+            "# TYPE iec104_connections_open gauge\n"
+            "iec104_connections_open %lld\n", (long long) (value - value2));
+
+    SUM(connectionsActivated, value);
+    SUM(connectionsDeactivated, value2);
+    MetricsBuffer_append(out, "# HELP iec104_connections_active Master connections activated by STARTDT\n"
+            "# TYPE iec104_connections_active gauge\n"
+            "iec104_connections_active %lld\n", (long long) (value - value2));
+
+    SUM(interrogations, value);
+    SUM(interrogationTime, value2);
+    MetricsBuffer_append(out, "# HELP iec104_interrogation_duration_seconds Time from the activation to the ACT_TERM of a station or group interrogation\n"
+            "# TYPE iec104_interrogation_duration_seconds summary\n"
+            "iec104_interrogation_duration_seconds_sum %.6f\n"
+            "iec104_interrogation_duration_seconds_count %llu\n", value2 / 1e6, (unsigned long long) value);
+
+    SUM(kWindowStalls, value);
+    SUM(kWindowStallTime, value2);
+    MetricsBuffer_append(out, "# HELP iec104_k_window_stalls_total Times an active connection had a full send window\n"
+            "# TYPE iec104_k_window_stalls_total counter\n"
+            "iec104_k_window_stalls_total %llu\n", (unsigned long long) value);
+    MetricsBuffer_append(out, "# HELP iec104_k_window_stall_seconds_total Time active connections spent with a full send window\n"
+            "# TYPE iec104_k_window_stall_seconds_total counter\n"
+            "iec104_k_window_stall_seconds_total %.6f\n", value2 / 1e6);
+
+    static const char* phaseNames[METRICS_PHASES] = { "con", "term" };
+    static const double quantiles[] = { 0.5, 0.99, 0.999 };
+
+    Histogram* merged = (Histogram*) malloc(sizeof(Histogram));
+
+    MetricsBuffer_append(out, "# HELP iec104_command_latency_seconds Receipt of an activation to ACT_CON (con) or ACT_TERM (term)\n"
+            "# TYPE iec104_command_latency_seconds summary\n");
+
+    for (int type = 0; type < METRICS_MAX_TYPE; type++) {
+        for (int phase = 0; phase < METRICS_PHASES; phase++) {
+            Histogram_init(merged);
+
+            if (!Metrics_getLatency(type, (MetricsPhase) phase, merged))
+                continue;
+
+            for (int q = 0; q < 3; q++)
+                MetricsBuffer_append(out, "iec104_command_latency_seconds{type=\"%d\",phase=\"%s\",quantile=\"%g\"} %.9f\n",
+                        type, phaseNames[phase], quantiles[q], Histogram_getPercentile(merged, quantiles[q]) / 1e9);
+
+            MetricsBuffer_append(out, "iec104_command_latency_seconds_sum{type=\"%d\",phase=\"%s\"} %.9f\n"
+                    "iec104_command_latency_seconds_count{type=\"%d\",phase=\"%s\"} %llu\n"
+                    "iec104_command_latency_max_seconds{type=\"%d\",phase=\"%s\"} %.9f\n",
+                    type, phaseNames[phase], merged->sum / 1e9, type, phaseNames[phase],
+                    (unsigned long long) merged->count, type, phaseNames[phase], merged->max / 1e9);
+        }
+    }
+
+    free(merged);
+}
+
+#ifndef _WIN32
+
+static int
+createSocket(const char* address, char** unixPath)
+{
+    int fd;
+
+    if (strncmp(address, "unix:", 5) == 0) {
+        struct sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+
+        if (strlen(address + 5) >= sizeof(local.sun_path))
+            return -1;
+
+        strcpy(local.sun_path, address + 5);
+
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        /* a socket file left from a previous run */
+        unlink(local.sun_path);
+
+        if (bind(fd, (struct sockaddr*) &local, sizeof(local)) < 0) {
+            close(fd);
+            return -1;
+        }
+
+        *unixPath = strdup(local.sun_path);
+    }
+    else {
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        const char* colon = strrchr(address, ':');
+
+        if (colon) {
+            char ip[64];
+            int length = (int) (colon - address);
+
+            if (length >= (int) sizeof(ip))
+                return -1;
+
+            memcpy(ip, address, length);
+            ip[length] = 0;
+
+            if (inet_pton(AF_INET, ip, &local.sin_addr) != 1)
+                return -1;
+
+            address = colon + 1;
+        }
+
+        local.sin_port = htons((uint16_t) atoi(address));
+
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+
+        int reuse = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (bind(fd, (struct sockaddr*) &local, sizeof(local)) < 0) {
+            close(fd);
+            return -1;
+        }
+    }
+
+    if (listen(fd, 4) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+MetricsServer
+MetricsServer_create(const char* address, MetricsServer_CollectHandler handler, void* parameter)
+{
+    char* unixPath = NULL;
+    int fd = createSocket(address, &unixPath);
+
+    if (fd < 0)
+        return NULL;
+
+    MetricsServer self = (MetricsServer) calloc(1, sizeof(struct sMetricsServer));
+
+    if (self) {
+        self->socket = fd;
+        self->unixPath = unixPath;
+        self->collectHandler = handler;
+        self->collectParameter = parameter;
+    }
+
+    return self;
+}
+
+static void
+sendAll(int fd, const char* data, int length)
+{
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+
+        if (sent <= 0)
+            return;
+
+        data += sent;
+        length -= (int) sent;
+    }
+}
+
+/* any request gets the metrics, the request itself is not parsed */
+static void
+answerRequest(MetricsServer self, int fd)
+{
+    char request[1024];
+    struct pollfd pfd = { fd, POLLIN, 0 };
+
+    if ((poll(&pfd, 1, 1000) <= 0) || (recv(fd, request, sizeof(request), 0) <= 0))
+        return;
+
+    MetricsBuffer body = { NULL, 0, 0 };
+
+    Metrics_write(&body);
+
+    if (self->collectHandler)
+        self->collectHandler(self->collectParameter, &body);
+
+    char header[160];
+    int headerLength = snprintf(header, sizeof(header),
+            "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\n"
+            "Connection: close\r\n\r\n", body.length);
+
+    sendAll(fd, header, headerLength);
+    sendAll(fd, body.data, body.length);
+
+    free(body.data);
+
+    self->scrapes++;
+}
+
+static void*
+serverThread(void* parameter)
+{
+    MetricsServer self = (MetricsServer) parameter;
+
+    while (__atomic_load_n(&(self->running), __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { self->socket, POLLIN, 0 };
+
+        if (poll(&pfd, 1, ACCEPT_TIMEOUT) <= 0)
+            continue;
+
+        int fd = accept(self->socket, NULL, NULL);
+
+        if (fd >= 0) {
+            answerRequest(self, fd);
+            close(fd);
+        }
+    }
+
+    return NULL;
+}
+
+void
+MetricsServer_start(MetricsServer self)
+{
+    self->running = true;
+    self->thread = Thread_create(serverThread, self, false);
+    Thread_start(self->thread);
+}
+
+void
+MetricsServer_destroy(MetricsServer self)
+{
+    if (self) {
+        if (self->running) {
+            __atomic_store_n(&(self->running), false, __ATOMIC_RELEASE);
+            Thread_destroy(self->thread);
+        }
+
+        close(self->socket);
+
+        if (self->unixPath) {
+            unlink(self->unixPath);
+            free(self->unixPath);
+        }
+
+        free(self);
+    }
+}
+
+#else
+
+/* the listener uses BSD and UNIX sockets with poll; the counters work without it */
+MetricsServer
+MetricsServer_create(const char* address, MetricsServer_CollectHandler handler, void* parameter)
+{
+    return NULL;
+}
+
+void
+MetricsServer_start(MetricsServer self)
+{
+}
+
+void
+MetricsServer_destroy(MetricsServer self)
+{
+    free(self);
+}
+
+#endif /* _WIN32 */
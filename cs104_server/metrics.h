@@ -0,0 +1,185 @@
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+#include "hal_thread.h"
+#include "histogram.h"
+
+/*
+ * Counters of the running server, exported in the Prometheus text format.
+ *
+ * Every thread counts into its own MetricsCounters block, registered on
+ * first use. The owner is the only writer, so counting is a plain
+ * increment without a lock or a read-modify-write atomic. A scrape sums the
+ * blocks of all threads; it may see a block in the middle of an update,
+ * the totals are consistent at the next scrape.
+ *
+ * Command latencies (receipt of the activation to the confirmation) go
+ * into per-thread log-linear histograms by type identification and phase,
+ * merged at scrape time and exported as quantiles.
+ *
+ * A MetricsServer answers HTTP requests on a TCP port or a UNIX socket
+ * with the counters of all threads followed by what its collect handler
+ * adds (gauges owned by other modules, e.g. queue fill levels).
+ */
+
+#define METRICS_MAX_TYPE 128    /* type identifications 0..127 */
+#define METRICS_MAX_COT 64      /* causes of transmission 0..63 */
+
+typedef enum {
+    METRICS_PHASE_CON,      /* activation to ACT_CON */
+    METRICS_PHASE_TERM,     /* activation to ACT_TERM */
+    METRICS_PHASES
+} MetricsPhase;
+
+typedef struct sMetricsCounters MetricsCounters;
+
+struct sMetricsCounters {
+    /* ASDUs and information objects sent, by type and cause of transmission */
+    uint64_t asdus[METRICS_MAX_TYPE][METRICS_MAX_COT];
+    uint64_t objects[METRICS_MAX_TYPE][METRICS_MAX_COT];
+
+    uint64_t connectionsOpened;
+    uint64_t connectionsClosed;
+    uint64_t connectionsActivated;
+    uint64_t connectionsDeactivated;
+
+    uint64_t interrogations;        /* station and group interrogations answered */
+    uint64_t interrogationTime;     /* us, activation received to ACT_TERM sent, sum */
+
+    uint64_t kWindowStalls;         /* an active connection found with a full send window */
+    uint64_t kWindowStallTime;      /* us, sum */
+
+    /* ns, allocated on the first latency of the type */
+    Histogram* latency[METRICS_MAX_TYPE][METRICS_PHASES];
+
+    MetricsCounters* next;
+};
+
+/* the block of the calling thread, NULL before the first Metrics_getCounters */
+extern __thread MetricsCounters* metricsThreadCounters;
+
+/**
+ * \brief Create the lock of the thread registry
+ *
+ * Called once by the main thread before any other thread counts. The
+ * registry and the blocks live until the process ends.
+ */
+void
+Metrics_init(void);
+
+/**
+ * \brief Register a block for the calling thread (used by Metrics_getCounters)
+ */
+MetricsCounters*
+Metrics_registerThread(void);
+
+static inline MetricsCounters*
+Metrics_getCounters(void)
+{
+    MetricsCounters* counters = metricsThreadCounters;
+
+    if (counters == NULL)
+        counters = Metrics_registerThread();
+
+    return counters;
+}
+
+/* only the owning thread writes, the relaxed store lets the scraper read without a data race */
+#define METRICS_ADD(counter, value) __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+
+/**
+ * \brief Count one ASDU sent by the calling thread
+ */
+static inline void
+Metrics_countASDU(int type, int cot, int objects)
+{
+    MetricsCounters* counters = Metrics_getCounters();
+
+    type &= METRICS_MAX_TYPE - 1;
+    cot &= METRICS_MAX_COT - 1;
+
+    METRICS_ADD(counters->asdus[type][cot], 1);
+    METRICS_ADD(counters->objects[type][cot], objects);
+}
+
+/**
+ * \brief Record a command latency of the calling thread
+ *
+ * \param type type identification of the command
+ * \param latency ns from the receipt of the activation
+ */
+void
+Metrics_recordLatency(int type, MetricsPhase phase, uint64_t latency);
+
+/**
+ * \brief Merge the latencies of all threads
+ *
+ * \param result initialized histogram the latencies are added to
+ *
+ * \return false when no latency of the type and phase was recorded
+ */
+bool
+Metrics_getLatency(int type, MetricsPhase phase, Histogram* result);
+
+typedef struct {
+    char* data;
+    int length;
+    int capacity;
+} MetricsBuffer;
+
+/**
+ * \brief Append formatted text to the buffer, growing it
+ */
+void
+MetricsBuffer_append(MetricsBuffer* self, const char* format, ...)
+#ifdef __GNUC__
+    __attribute__((format(printf, 2, 3)))
+#endif
+;
+
+/**
+ * \brief Write the sums of all thread counters in the Prometheus text format
+ */
+void
+Metrics_write(MetricsBuffer* out);
+
+/**
+ * \brief Called for every scrape to add metrics after the thread counters
+ */
+typedef void (*MetricsServer_CollectHandler)(void* parameter, MetricsBuffer* out);
+
+typedef struct sMetricsServer* MetricsServer;
+
+struct sMetricsServer {
+    int socket;
+    char* unixPath;         /* NULL for TCP */
+
+    MetricsServer_CollectHandler collectHandler;
+    void* collectParameter;
+
+    uint64_t scrapes;
+
+    bool running;
+    Thread thread;
+};
+
+/**
+ * \param address "port" or "ip:port" for HTTP over TCP (the ip defaults to 127.0.0.1),
+ *                "unix:path" for HTTP over a UNIX socket
+ *
+ * \return NULL when the socket cannot be created
+ */
+MetricsServer
+MetricsServer_create(const char* address, MetricsServer_CollectHandler handler, void* parameter);
+
+void
+MetricsServer_start(MetricsServer self);
+
+void
+MetricsServer_destroy(MetricsServer self);
+
+#endif /* METRICS_H_ */
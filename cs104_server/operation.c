@@ -0,0 +1,111 @@
+#include <stdlib.h>
+
+#include "operation.h"
+
+static void
+removeFromList(OperationList self, Operation operation)
+{
+    if (operation->prev)
+        operation->prev->next = operation->next;
+    else
+        self->first = operation->next;
+
+    if (operation->next)
+        operation->next->prev = operation->prev;
+
+    self->count--;
+}
+
+static void
+operationTimeout(void* parameter, uint64_t expiry)
+{
+    Operation operation = (Operation) parameter;
+    OperationList self = operation->list;
+
+    removeFromList(self, operation);
+
+    self->handler(self->handlerParameter, operation);
+
+    free(operation);
+}
+
+OperationList
+OperationList_create(TimerWheel timers, OperationList_CompletionHandler handler, void* parameter)
+{
+    OperationList self = (OperationList) calloc(1, sizeof(struct sOperationList));
+
+    if (self) {
+        self->timers = timers;
+        self->handler = handler;
+        self->handlerParameter = parameter;
+    }
+
+    return self;
+}
+
+void
+OperationList_destroy(OperationList self)
+{
+    if (self) {
+        Operation operation = self->first;
+
+        while (operation) {
+            Operation next = operation->next;
+
+            TimerWheel_cancel(self->timers, operation->timer);
+            free(operation);
+
+            operation = next;
+        }
+
+        free(self);
+    }
+}
+
+bool
+OperationList_add(OperationList self, int ioa, PointValue value, IMasterConnection connection, CS101_ASDU asdu,
+        uint64_t received, uint32_t delay)
+{
+    Operation operation = (Operation) calloc(1, sizeof(struct sOperation));
+
+    if (operation == NULL)
+        return false;
+
+    operation->ioa = ioa;
+    operation->type = CS101_ASDU_getTypeID(asdu);
+    operation->value = value;
+    operation->connection = connection;
+    operation->received = received;
+    operation->list = self;
+
+    CS101_ASDU_clone(asdu, &(operation->asdu));
+
+    operation->timer = TimerWheel_add(self->timers, TimerWheel_getMonotonicTime() + delay, 0, operationTimeout,
+            operation);
+
+    if (operation->timer == -1) {
+        free(operation);
+        return false;
+    }
+
+    operation->next = self->first;
+
+    if (self->first)
+        self->first->prev = operation;
+
+    self->first = operation;
+    self->count++;
+
+    return true;
+}
+
+void
+OperationList_removeConnection(OperationList self, IMasterConnection connection)
+{
+    Operation operation;
+
+    for (operation = self->first; operation; operation = operation->next) {
+        if (operation->connection == connection)
+            operation->connection = NULL;
+    }
+}
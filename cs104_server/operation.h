@@ -0,0 +1,82 @@
+#ifndef OPERATION_H_
+#define OPERATION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+#include "timer_wheel.h"
+
+/*
+ * Executed commands waiting for their operating time.
+ *
+ * An operation keeps what its completion needs: the commanded point and
+ * value, a copy of the command ASDU for the ACT_TERM and the connection it
+ * came from. Every operation is a one shot timer in the timer wheel of the
+ * endpoint; on expiry the completion handler is called and the operation
+ * is freed. When the connection closes its operations still complete, but
+ * without a connection to terminate the command on.
+ *
+ * Like the select state, the list is used by the worker thread of the
+ * endpoint only.
+ */
+
+typedef struct sOperation* Operation;
+typedef struct sOperationList* OperationList;
+
+typedef void (*OperationList_CompletionHandler)(void* parameter, Operation operation);
+
+struct sOperation {
+    int32_t ioa;                    /* of the control point */
+    TypeID type;                    /* type identification of the command */
+    PointValue value;
+
+    IMasterConnection connection;   /* NULL when closed meanwhile */
+    struct sCS101_StaticASDU asdu;  /* copy of the command */
+    uint64_t received;              /* ns, monotonic time the command was received */
+
+    int timer;
+    OperationList list;
+    Operation prev;
+    Operation next;
+};
+
+struct sOperationList {
+    Operation first;
+    int count;
+
+    TimerWheel timers;              /* of the endpoint, not owned */
+
+    OperationList_CompletionHandler handler;
+    void* handlerParameter;
+};
+
+OperationList
+OperationList_create(TimerWheel timers, OperationList_CompletionHandler handler, void* parameter);
+
+/**
+ * Destroy the list, pending operations are dropped without completion.
+ */
+void
+OperationList_destroy(OperationList self);
+
+/**
+ * \brief Schedule the completion of a command
+ *
+ * \param asdu the command, copied
+ * \param delay operating time in ms
+ *
+ * \return false when out of memory
+ */
+bool
+OperationList_add(OperationList self, int ioa, PointValue value, IMasterConnection connection, CS101_ASDU asdu,
+        uint64_t received, uint32_t delay);
+
+/**
+ * \brief Forget a closed connection, its operations complete without ACT_TERM
+ */
+void
+OperationList_removeConnection(OperationList self, IMasterConnection connection);
+
+#endif /* OPERATION_H_ */
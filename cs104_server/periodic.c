@@ -0,0 +1,198 @@
+#include <stdlib.h>
+#include <time.h>
+
+#include "periodic.h"
+#include "asdu_packer.h"
+
+static double
+getMonotonicTimeInMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool
+enqueueASDU(void* parameter, CS101_ASDU asdu)
+{
+    /* the ASDU is copied, so the packer can reuse its storage; transmitted after the table is unlocked */
+    SlaveQueue_enqueue((SlaveQueue) parameter, asdu);
+
+    return true;
+}
+
+PeriodicScan
+PeriodicScan_create(PointDB db, const int32_t* indexes, int count, uint32_t period,
+        CS101_AppLayerParameters alParams, int oa, int ca, SlaveQueue queue)
+{
+    PeriodicScan self = (PeriodicScan) calloc(1, sizeof(struct sPeriodicScan));
+
+    if (self) {
+        self->db = db;
+        self->alParams = alParams;
+        self->oa = oa;
+        self->ca = ca;
+        self->queue = queue;
+        self->period = period;
+
+        self->points = (int32_t*) malloc((count > 0 ? count : 1) * sizeof(int32_t));
+
+        int i;
+        for (i = 0; i < count; i++) {
+            if (PointDB_isInterrogatedType((TypeID) db->type[indexes[i]]))
+                self->points[self->pointCount++] = indexes[i];
+        }
+    }
+
+    return self;
+}
+
+typedef struct {
+    uint32_t period;
+    int32_t index;
+} PeriodicPoint;
+
+static int
+comparePeriodicPoints(const void* a, const void* b)
+{
+    const PeriodicPoint* p1 = (const PeriodicPoint*) a;
+    const PeriodicPoint* p2 = (const PeriodicPoint*) b;
+
+    if (p1->period != p2->period)
+        return (p1->period < p2->period) ? -1 : 1;
+
+    return (p1->index < p2->index) ? -1 : (p1->index > p2->index);
+}
+
+/* own period, else the shortest period of its groups, else the default for points flagged periodic */
+static uint32_t
+getPointPeriod(PointDB db, int index, uint32_t defaultPeriod, const uint32_t* groupPeriods)
+{
+    if (db->period[index] > 0)
+        return db->period[index];
+
+    uint32_t period = 0;
+
+    int group;
+    for (group = 0; group < POINT_DB_MAX_GROUPS; group++) {
+        if ((db->groups[index] & (1 << group)) && (groupPeriods[group] > 0)) {
+            if ((period == 0) || (groupPeriods[group] < period))
+                period = groupPeriods[group];
+        }
+    }
+
+    if ((period == 0) && (db->flags[index] & POINT_DB_FLAG_PERIODIC))
+        period = defaultPeriod;
+
+    return period;
+}
+
+PeriodicScan*
+PeriodicScan_createAll(PointDB db, uint32_t defaultPeriod, const uint32_t* groupPeriods,
+        CS101_AppLayerParameters alParams, int oa, int ca, SlaveQueue queue, int* count)
+{
+    PointDB_lock(db);
+
+    int pointCount = PointDB_getCount(db);
+
+    PeriodicPoint* points = (PeriodicPoint*) malloc((pointCount > 0 ? pointCount : 1) * sizeof(PeriodicPoint));
+    int32_t* indexes = (int32_t*) malloc((pointCount > 0 ? pointCount : 1) * sizeof(int32_t));
+
+    int periodicCount = 0;
+    int scanCount = 0;
+
+    int i;
+    for (i = 0; i < pointCount; i++) {
+        if (!PointDB_isInterrogatedType((TypeID) db->type[i]))
+            continue;
+
+        uint32_t period = getPointPeriod(db, i, defaultPeriod, groupPeriods);
+
+        if (period > 0) {
+            points[periodicCount].period = period;
+            points[periodicCount].index = i;
+            periodicCount++;
+        }
+    }
+
+    /* group by period, table order within a period */
+    qsort(points, periodicCount, sizeof(PeriodicPoint), comparePeriodicPoints);
+
+    for (i = 0; i < periodicCount; i++) {
+        if ((i == 0) || (points[i].period != points[i - 1].period))
+            scanCount++;
+    }
+
+    PeriodicScan* scans = (PeriodicScan*) calloc(scanCount > 0 ? scanCount : 1, sizeof(PeriodicScan));
+
+    int first = 0;
+    int scan = 0;
+
+    for (i = 1; i <= periodicCount; i++) {
+        if ((i == periodicCount) || (points[i].period != points[first].period)) {
+            int k;
+            for (k = first; k < i; k++)
+                indexes[k - first] = points[k].index;
+
+            scans[scan++] = PeriodicScan_create(db, indexes, i - first, points[first].period, alParams, oa, ca, queue);
+
+            first = i;
+        }
+    }
+
+    PointDB_unlock(db);
+
+    free(indexes);
+    free(points);
+
+    *count = scanCount;
+
+    return scans;
+}
+
+void
+PeriodicScan_destroy(PeriodicScan self)
+{
+    if (self) {
+        free(self->points);
+        free(self);
+    }
+}
+
+void
+PeriodicScan_destroyAll(PeriodicScan* scans, int count)
+{
+    if (scans) {
+        int i;
+        for (i = 0; i < count; i++)
+            PeriodicScan_destroy(scans[i]);
+
+        free(scans);
+    }
+}
+
+void
+PeriodicScan_send(PeriodicScan self)
+{
+    struct sASDUPacker packer;
+
+    double start = getMonotonicTimeInMs();
+
+    ASDUPacker_init(&packer, self->alParams, CS101_COT_PERIODIC, self->oa, self->ca, enqueueASDU, self->queue);
+
+    PointDB_lock(self->db);
+
+    /* cyclic data is sent without time tag */
+    ASDUPacker_addPoints(&packer, self->db, self->points, self->pointCount, true);
+    ASDUPacker_flush(&packer);
+
+    PointDB_unlock(self->db);
+
+    SlaveQueue_transmit(self->queue);
+
+    self->asduCount = packer.asduCount;
+    self->objectCount = packer.objectCount;
+    self->cycleTime = getMonotonicTimeInMs() - start;
+    self->cycles++;
+}
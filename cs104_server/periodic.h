@@ -0,0 +1,81 @@
+#ifndef PERIODIC_H_
+#define PERIODIC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+#include "slave_queue.h"
+
+/*
+ * Cyclic transmission (COT 1).
+ *
+ * A point is sent cyclically with its own period, with the period of an
+ * interrogation group it belongs to, or with the default period when it is
+ * flagged POINT_DB_FLAG_PERIODIC. Points with the same period form one
+ * PeriodicScan. The scans are built once after the table is loaded; every
+ * cycle of a scan packs its points into full ASDUs by type (see ASDUPacker)
+ * and enqueues the ASDUs into the slave's low priority queue (SlaveQueue).
+ */
+
+typedef struct sPeriodicScan* PeriodicScan;
+
+struct sPeriodicScan {
+    PointDB db;
+
+    CS101_AppLayerParameters alParams;
+    int oa;
+    int ca;
+
+    SlaveQueue queue;
+
+    uint32_t period;    /* cycle time in ms */
+
+    int32_t* points;    /* indexes of the periodic points, in table order */
+    int pointCount;
+
+    /* statistics of the last cycle */
+    int asduCount;
+    int objectCount;
+    double cycleTime;   /* encoding and enqueuing in ms */
+
+    uint64_t cycles;
+
+    int timer;          /* timer wheel entry, set by the owner */
+};
+
+/**
+ * Create a scan for the given point indexes. Points that are not reported
+ * cyclically (commands, integrated totals) are skipped.
+ */
+PeriodicScan
+PeriodicScan_create(PointDB db, const int32_t* indexes, int count, uint32_t period,
+        CS101_AppLayerParameters alParams, int oa, int ca, SlaveQueue queue);
+
+/**
+ * Create one scan per distinct period of the table (call after PointDB_sort).
+ *
+ * \param defaultPeriod period in ms of the points flagged periodic, 0 = disabled
+ * \param groupPeriods period in ms of interrogation group 1..16 at [group - 1], 0 = none
+ * \param count returns the number of scans
+ *
+ * \return the scans ordered by period (free with PeriodicScan_destroyAll)
+ */
+PeriodicScan*
+PeriodicScan_createAll(PointDB db, uint32_t defaultPeriod, const uint32_t* groupPeriods,
+        CS101_AppLayerParameters alParams, int oa, int ca, SlaveQueue queue, int* count);
+
+void
+PeriodicScan_destroy(PeriodicScan self);
+
+void
+PeriodicScan_destroyAll(PeriodicScan* scans, int count);
+
+/**
+ * Send one cycle of all periodic points.
+ */
+void
+PeriodicScan_send(PeriodicScan self);
+
+#endif /* PERIODIC_H_ */
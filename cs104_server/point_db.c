@@ -0,0 +1,683 @@
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#include "point_db.h"
+#include "ioa_hash.h"
+
+#define POINT_DB_INITIAL_CAPACITY 256
+
+static bool
+growColumns(PointDB self)
+{
+    int newCapacity = self->capacity * 2;
+
+    int32_t* ioa = (int32_t*) realloc(self->ioa, newCapacity * sizeof(int32_t));
+    if (ioa) self->ioa = ioa;
+    uint8_t* type = (uint8_t*) realloc(self->type, newCapacity * sizeof(uint8_t));
+    if (type) self->type = type;
+    PointValue* value = (PointValue*) realloc(self->value, newCapacity * sizeof(PointValue));
+    if (value) self->value = value;
+    uint8_t* quality = (uint8_t*) realloc(self->quality, newCapacity * sizeof(uint8_t));
+    if (quality) self->quality = quality;
+    uint64_t* timestamp = (uint64_t*) realloc(self->timestamp, newCapacity * sizeof(uint64_t));
+    if (timestamp) self->timestamp = timestamp;
+    uint16_t* groups = (uint16_t*) realloc(self->groups, newCapacity * sizeof(uint16_t));
+    if (groups) self->groups = groups;
+    int32_t* increment = (int32_t*) realloc(self->increment, newCapacity * sizeof(int32_t));
+    if (increment) self->increment = increment;
+    uint8_t* flags = (uint8_t*) realloc(self->flags, newCapacity * sizeof(uint8_t));
+    if (flags) self->flags = flags;
+    uint32_t* period = (uint32_t*) realloc(self->period, newCapacity * sizeof(uint32_t));
+    if (period) self->period = period;
+    int32_t* link = (int32_t*) realloc(self->link, newCapacity * sizeof(int32_t));
+    if (link) self->link = link;
+    uint32_t* delay = (uint32_t*) realloc(self->delay, newCapacity * sizeof(uint32_t));
+    if (delay) self->delay = delay;
+    uint64_t* blockVersion = (uint64_t*) realloc(self->blockVersion, (newCapacity / POINT_DB_BLOCK_SIZE) * sizeof(uint64_t));
+    if (blockVersion) self->blockVersion = blockVersion;
+
+    if (!ioa || !type || !value || !quality || !timestamp || !groups || !increment || !flags || !period || !link || !delay ||
+            !blockVersion)
+        return false;
+
+    memset(self->blockVersion + (self->capacity / POINT_DB_BLOCK_SIZE), 0,
+            ((newCapacity - self->capacity) / POINT_DB_BLOCK_SIZE) * sizeof(uint64_t));
+
+    self->capacity = newCapacity;
+
+    return true;
+}
+
+/* false when out of memory, the old index is kept then */
+static bool
+rebuildIndex(PointDB self, uint32_t size)
+{
+    /* same size (after sorting): rebuilt in place */
+    if ((self->index == NULL) || (size != self->indexMask + 1)) {
+        int32_t* index = (int32_t*) malloc(size * sizeof(int32_t));
+
+        if (index == NULL)
+            return false;
+
+        free(self->index);
+        self->index = index;
+    }
+
+    memset(self->index, 0xff, size * sizeof(int32_t));
+    self->indexMask = size - 1;
+
+    int i;
+    for (i = 0; i < self->count; i++) {
+        uint32_t slot = IOAHash_get(self->ioa[i]) & self->indexMask;
+
+        while (self->index[slot] != -1)
+            slot = (slot + 1) & self->indexMask;
+
+        self->index[slot] = i;
+    }
+
+    return true;
+}
+
+PointDB
+PointDB_create(void)
+{
+    PointDB self = (PointDB) calloc(1, sizeof(struct sPointDB));
+
+    if (self) {
+        self->capacity = POINT_DB_INITIAL_CAPACITY;
+        self->ioa = (int32_t*) malloc(self->capacity * sizeof(int32_t));
+        self->type = (uint8_t*) malloc(self->capacity * sizeof(uint8_t));
+        self->value = (PointValue*) malloc(self->capacity * sizeof(PointValue));
+        self->quality = (uint8_t*) malloc(self->capacity * sizeof(uint8_t));
+        self->timestamp = (uint64_t*) malloc(self->capacity * sizeof(uint64_t));
+        self->groups = (uint16_t*) malloc(self->capacity * sizeof(uint16_t));
+        self->increment = (int32_t*) malloc(self->capacity * sizeof(int32_t));
+        self->flags = (uint8_t*) malloc(self->capacity * sizeof(uint8_t));
+        self->period = (uint32_t*) malloc(self->capacity * sizeof(uint32_t));
+        self->link = (int32_t*) malloc(self->capacity * sizeof(int32_t));
+        self->delay = (uint32_t*) malloc(self->capacity * sizeof(uint32_t));
+        self->blockVersion = (uint64_t*) calloc(self->capacity / POINT_DB_BLOCK_SIZE, sizeof(uint64_t));
+
+        self->lock = Semaphore_create(1);
+        self->references = 1;
+
+        if (!self->ioa || !self->type || !self->value || !self->quality || !self->timestamp || !self->groups ||
+                !self->increment || !self->flags || !self->period || !self->link || !self->delay || !self->blockVersion ||
+                !self->lock) {
+            PointDB_destroy(self);
+            return NULL;
+        }
+
+        /* keep the index at most half full */
+        if (!rebuildIndex(self, POINT_DB_INITIAL_CAPACITY * 2)) {
+            PointDB_destroy(self);
+            return NULL;
+        }
+    }
+
+    return self;
+}
+
+void
+PointDB_destroy(PointDB self)
+{
+    if (self && self->mapping) {
+#ifdef _WIN32
+        /* no mmap, PointImage_open read the image into memory */
+        free(self->mapping);
+#else
+        munmap(self->mapping, self->mappingSize);
+#endif
+
+        Semaphore_destroy(self->lock);
+        free(self);
+    }
+    else if (self) {
+        free(self->ioa);
+        free(self->type);
+        free(self->value);
+        free(self->quality);
+        free(self->timestamp);
+        free(self->groups);
+        free(self->increment);
+        free(self->flags);
+        free(self->period);
+        free(self->link);
+        free(self->delay);
+        free(self->blockVersion);
+        free(self->index);
+        free(self->frozen);
+
+        int group;
+        for (group = 0; group < POINT_DB_MAX_GROUPS; group++)
+            free(self->groupPoints[group]);
+
+        for (group = 0; group <= POINT_DB_MAX_COUNTER_GROUPS; group++)
+            free(self->counterGroupPoints[group]);
+
+        if (self->lock)
+            Semaphore_destroy(self->lock);
+
+        free(self);
+    }
+}
+
+bool
+PointDB_isMonitoredType(TypeID type)
+{
+    switch (type) {
+    case M_SP_NA_1:
+    case M_DP_NA_1:
+    case M_ST_NA_1:
+    case M_BO_NA_1:
+    case M_ME_NA_1:
+    case M_ME_NB_1:
+    case M_ME_NC_1:
+    case M_SP_TB_1:
+    case M_DP_TB_1:
+    case M_ST_TB_1:
+    case M_BO_TB_1:
+    case M_ME_TD_1:
+    case M_ME_TE_1:
+    case M_ME_TF_1:
+    case M_IT_NA_1:
+    case M_IT_TB_1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool
+PointDB_isCounterType(TypeID type)
+{
+    return (type == M_IT_NA_1) || (type == M_IT_TB_1);
+}
+
+bool
+PointDB_isInterrogatedType(TypeID type)
+{
+    return PointDB_isMonitoredType(type) && !PointDB_isCounterType(type);
+}
+
+bool
+PointDB_isControlType(TypeID type)
+{
+    switch (type) {
+    case C_SC_NA_1:
+    case C_DC_NA_1:
+    case C_RC_NA_1:
+    case C_SE_NA_1:
+    case C_SE_NB_1:
+    case C_SE_NC_1:
+    case C_BO_NA_1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+TypeID
+PointDB_getUntimedType(TypeID type)
+{
+    switch (type) {
+    case M_SP_TB_1:
+        return M_SP_NA_1;
+    case M_DP_TB_1:
+        return M_DP_NA_1;
+    case M_ST_TB_1:
+        return M_ST_NA_1;
+    case M_BO_TB_1:
+        return M_BO_NA_1;
+    case M_ME_TD_1:
+        return M_ME_NA_1;
+    case M_ME_TE_1:
+        return M_ME_NB_1;
+    case M_ME_TF_1:
+        return M_ME_NC_1;
+    case M_IT_TB_1:
+        return M_IT_NA_1;
+    default:
+        return type;
+    }
+}
+
+PointValue
+PointDB_convertValue(TypeID type, double configValue)
+{
+    PointValue value;
+
+    switch (PointDB_getUntimedType(type)) {
+    case M_ME_NA_1:
+    case M_ME_NC_1:
+    case C_SE_NA_1:
+    case C_SE_NC_1:
+        value.f = (float) configValue;
+        break;
+    case M_BO_NA_1:
+    case C_BO_NA_1:
+        value.u = (uint32_t) configValue;
+        break;
+    case M_SP_NA_1:
+    case C_SC_NA_1:
+        value.i = (configValue != 0.0);
+        break;
+    default:
+        value.i = (int32_t) configValue;
+        break;
+    }
+
+    return value;
+}
+
+PointDB
+PointDB_retain(PointDB self)
+{
+    __atomic_add_fetch(&(self->references), 1, __ATOMIC_RELAXED);
+
+    return self;
+}
+
+void
+PointDB_release(PointDB self)
+{
+    if (self && (__atomic_sub_fetch(&(self->references), 1, __ATOMIC_ACQ_REL) == 0))
+        PointDB_destroy(self);
+}
+
+PointDB
+PointDB_clone(PointDB other)
+{
+    PointDB self = PointDB_create();
+
+    if (self) {
+        PointDB_lock(other);
+
+        int i;
+        for (i = 0; i < other->count; i++) {
+            int idx = PointDB_add(self, (TypeID) other->type[i], other->ioa[i], 0.f);
+
+            if (idx == -1)
+                continue;
+
+            self->value[idx] = other->value[i];
+            self->quality[idx] = other->quality[i];
+            self->timestamp[idx] = other->timestamp[i];
+            self->groups[idx] = other->groups[i];
+            self->increment[idx] = other->increment[i];
+            self->flags[idx] = other->flags[i];
+            self->period[idx] = other->period[i];
+            self->link[idx] = other->link[i];
+            self->delay[idx] = other->delay[i];
+        }
+
+        /* the order is kept, sorting builds the group and counter indexes */
+        if (!PointDB_sort(self)) {
+            PointDB_unlock(other);
+            PointDB_destroy(self);
+            return NULL;
+        }
+
+        if (self->counterCount == other->counterCount)
+            memcpy(self->frozen, other->frozen, self->counterCount * sizeof(PointValue));
+
+        memcpy(self->freezeGeneration, other->freezeGeneration, sizeof(self->freezeGeneration));
+        memcpy(self->freezeTime, other->freezeTime, sizeof(self->freezeTime));
+        self->freezeCount = other->freezeCount;
+
+        PointDB_unlock(other);
+    }
+
+    return self;
+}
+
+int
+PointDB_add(PointDB self, TypeID type, int ioa, float value)
+{
+    if (ioa < 1 || ioa > POINT_DB_MAX_IOA)
+        return -1;
+
+    if (self->mapping)
+        return -1;
+
+    if (!PointDB_isMonitoredType(type) && !PointDB_isControlType(type))
+        return -1;
+
+    if (PointDB_lookup(self, ioa) != -1)
+        return -1;
+
+    if (self->count == self->capacity) {
+        if (!growColumns(self))
+            return -1;
+    }
+
+    if (((uint32_t) self->count * 2 >= self->indexMask + 1) && !rebuildIndex(self, (self->indexMask + 1) * 2))
+        return -1;
+
+    int idx = self->count;
+
+    self->ioa[idx] = ioa;
+    self->type[idx] = (uint8_t) type;
+    self->value[idx] = PointDB_convertValue(type, value);
+    self->quality[idx] = IEC60870_QUALITY_GOOD;
+    self->timestamp[idx] = 0;
+    self->groups[idx] = 0;
+    self->increment[idx] = 1;
+    self->flags[idx] = 0;
+    self->period[idx] = 0;
+    self->link[idx] = 0;
+    self->delay[idx] = 0;
+
+    uint32_t slot = IOAHash_get(ioa) & self->indexMask;
+
+    while (self->index[slot] != -1)
+        slot = (slot + 1) & self->indexMask;
+
+    self->index[slot] = idx;
+
+    self->count++;
+
+    return idx;
+}
+
+void
+PointDB_setGroups(PointDB self, int index, uint16_t groups)
+{
+    self->groups[index] = groups;
+}
+
+const int32_t*
+PointDB_getGroupPoints(PointDB self, int group, int* count)
+{
+    if ((group < 1) || (group > POINT_DB_MAX_GROUPS)) {
+        *count = 0;
+        return NULL;
+    }
+
+    *count = self->groupCount[group - 1];
+
+    return self->groupPoints[group - 1];
+}
+
+int
+PointDB_lookup(PointDB self, int ioa)
+{
+    uint32_t slot = IOAHash_get(ioa) & self->indexMask;
+
+    while (self->index[slot] != -1) {
+        int idx = self->index[slot];
+
+        if (self->ioa[idx] == ioa)
+            return idx;
+
+        slot = (slot + 1) & self->indexMask;
+    }
+
+    return -1;
+}
+
+typedef struct {
+    uint64_t key;   /* untimed type | type | IOA */
+    int32_t index;
+} SortKey;
+
+static int
+compareSortKeys(const void* a, const void* b)
+{
+    uint64_t keyA = ((const SortKey*) a)->key;
+    uint64_t keyB = ((const SortKey*) b)->key;
+
+    return (keyA > keyB) - (keyA < keyB);
+}
+
+/* false when out of memory */
+static bool
+buildGroupIndex(PointDB self)
+{
+    int group;
+
+    for (group = 0; group < POINT_DB_MAX_GROUPS; group++) {
+        int count = 0;
+        int i;
+
+        for (i = 0; i < self->count; i++) {
+            if (self->groups[i] & (1 << group))
+                count++;
+        }
+
+        free(self->groupPoints[group]);
+        self->groupPoints[group] = (int32_t*) malloc((count > 0 ? count : 1) * sizeof(int32_t));
+        self->groupCount[group] = 0;
+
+        if (self->groupPoints[group] == NULL)
+            return false;
+
+        for (i = 0; i < self->count; i++) {
+            if (self->groups[i] & (1 << group))
+                self->groupPoints[group][self->groupCount[group]++] = i;
+        }
+    }
+
+    return true;
+}
+
+/* false when out of memory */
+static bool
+buildCounterIndex(PointDB self)
+{
+    int i;
+    int group;
+
+    self->counterFirst = 0;
+    self->counterCount = 0;
+
+    for (i = 0; i < self->count; i++) {
+        if (PointDB_isCounterType((TypeID) self->type[i])) {
+            if (self->counterCount == 0)
+                self->counterFirst = i;
+
+            self->counterCount++;
+        }
+    }
+
+    /* initial frozen readings are the configured values */
+    free(self->frozen);
+    self->frozen = (PointValue*) malloc((self->counterCount > 0 ? self->counterCount : 1) * sizeof(PointValue));
+
+    if (self->frozen == NULL)
+        return false;
+
+    memcpy(self->frozen, self->value + self->counterFirst, self->counterCount * sizeof(PointValue));
+
+    for (group = 0; group <= POINT_DB_MAX_COUNTER_GROUPS; group++) {
+        free(self->counterGroupPoints[group]);
+        self->counterGroupPoints[group] = (int32_t*) malloc((self->counterCount > 0 ? self->counterCount : 1) * sizeof(int32_t));
+        self->counterGroupCount[group] = 0;
+
+        if (self->counterGroupPoints[group] == NULL)
+            return false;
+
+        for (i = self->counterFirst; i < self->counterFirst + self->counterCount; i++) {
+            if ((group == 0) || (self->groups[i] & (1 << (group - 1))))
+                self->counterGroupPoints[group][self->counterGroupCount[group]++] = i;
+        }
+    }
+
+    return true;
+}
+
+/* reorders a column in place through the scratch buffer, nothing is allocated */
+#define PERMUTE_COLUMN(column, elementType) \
+    do { \
+        elementType* sorted = (elementType*) scratch; \
+        for (i = 0; i < self->count; i++) \
+            sorted[i] = self->column[keys[i].index]; \
+        memcpy(self->column, sorted, self->count * sizeof(elementType)); \
+    } while (0)
+
+bool
+PointDB_sort(PointDB self)
+{
+    int i;
+
+    /* images are written sorted */
+    if (self->mapping)
+        return true;
+
+    if (self->count > 0) {
+        /* both buffers are allocated before any column is touched, a failure leaves the table as it was */
+        SortKey* keys = (SortKey*) malloc(self->count * sizeof(SortKey));
+        uint64_t* scratch = (uint64_t*) malloc(self->count * sizeof(uint64_t));
+
+        if ((keys == NULL) || (scratch == NULL)) {
+            free(keys);
+            free(scratch);
+            return false;
+        }
+
+        for (i = 0; i < self->count; i++) {
+            keys[i].key = ((uint64_t) PointDB_getUntimedType((TypeID) self->type[i]) << 40) |
+                    ((uint64_t) self->type[i] << 32) | (uint32_t) self->ioa[i];
+            keys[i].index = i;
+        }
+
+        qsort(keys, self->count, sizeof(SortKey), compareSortKeys);
+
+        PERMUTE_COLUMN(ioa, int32_t);
+        PERMUTE_COLUMN(type, uint8_t);
+        PERMUTE_COLUMN(value, PointValue);
+        PERMUTE_COLUMN(quality, uint8_t);
+        PERMUTE_COLUMN(timestamp, uint64_t);
+        PERMUTE_COLUMN(groups, uint16_t);
+        PERMUTE_COLUMN(increment, int32_t);
+        PERMUTE_COLUMN(flags, uint8_t);
+        PERMUTE_COLUMN(period, uint32_t);
+        PERMUTE_COLUMN(link, int32_t);
+        PERMUTE_COLUMN(delay, uint32_t);
+
+        free(keys);
+        free(scratch);
+
+        /* same size: rebuilt in place, cannot fail */
+        rebuildIndex(self, self->indexMask + 1);
+    }
+
+    if (!buildGroupIndex(self) || !buildCounterIndex(self))
+        return false;
+
+    /* all points moved, data encoded before is invalid */
+    self->version++;
+
+    for (i = 0; i < self->capacity / POINT_DB_BLOCK_SIZE; i++)
+        self->blockVersion[i] = self->version;
+
+    return true;
+}
+
+void
+PointDB_lock(PointDB self)
+{
+    Semaphore_wait(self->lock);
+}
+
+void
+PointDB_unlock(PointDB self)
+{
+    Semaphore_post(self->lock);
+}
+
+void
+PointDB_setValue(PointDB self, int index, PointValue value, QualityDescriptor quality, uint64_t timestamp)
+{
+    self->value[index] = value;
+    self->quality[index] = quality;
+    self->timestamp[index] = timestamp;
+
+    self->blockVersion[index >> POINT_DB_BLOCK_SHIFT] = ++(self->version);
+}
+
+bool
+PointDB_isChangedSince(PointDB self, int first, int last, uint64_t version)
+{
+    int block;
+
+    for (block = first >> POINT_DB_BLOCK_SHIFT; block <= (last >> POINT_DB_BLOCK_SHIFT); block++) {
+        if (self->blockVersion[block] > version)
+            return true;
+    }
+
+    return false;
+}
+
+InformationObject
+PointDB_getInformationObject(PointDB self, int index, TypeID type, InformationObject io)
+{
+    int ioa = self->ioa[index];
+    PointValue value = self->value[index];
+    QualityDescriptor quality = self->quality[index];
+
+    struct sCP56Time2a timestamp;
+    CP56Time2a_createFromMsTimestamp(&timestamp, self->timestamp[index]);
+
+    switch (type) {
+    case M_SP_NA_1:
+        return (InformationObject) SinglePointInformation_create((SinglePointInformation) io, ioa, value.i != 0, quality);
+    case M_DP_NA_1:
+        return (InformationObject) DoublePointInformation_create((DoublePointInformation) io, ioa, (DoublePointValue) value.i, quality);
+    case M_ST_NA_1:
+        return (InformationObject) StepPositionInformation_create((StepPositionInformation) io, ioa, value.i, false, quality);
+    case M_BO_NA_1:
+        return (InformationObject) BitString32_createEx((BitString32) io, ioa, value.u, quality);
+    case M_ME_NA_1:
+        return (InformationObject) MeasuredValueNormalized_create((MeasuredValueNormalized) io, ioa, value.f, quality);
+    case M_ME_NB_1:
+        return (InformationObject) MeasuredValueScaled_create((MeasuredValueScaled) io, ioa, value.i, quality);
+    case M_ME_NC_1:
+        return (InformationObject) MeasuredValueShort_create((MeasuredValueShort) io, ioa, value.f, quality);
+    case M_SP_TB_1:
+        return (InformationObject) SinglePointWithCP56Time2a_create((SinglePointWithCP56Time2a) io, ioa, value.i != 0, quality, &timestamp);
+    case M_DP_TB_1:
+        return (InformationObject) DoublePointWithCP56Time2a_create((DoublePointWithCP56Time2a) io, ioa, (DoublePointValue) value.i, quality, &timestamp);
+    case M_ST_TB_1:
+        return (InformationObject) StepPositionWithCP56Time2a_create((StepPositionWithCP56Time2a) io, ioa, value.i, false, quality, &timestamp);
+    case M_BO_TB_1:
+        return (InformationObject) Bitstring32WithCP56Time2a_createEx((Bitstring32WithCP56Time2a) io, ioa, value.u, quality, &timestamp);
+    case M_ME_TD_1:
+        return (InformationObject) MeasuredValueNormalizedWithCP56Time2a_create((MeasuredValueNormalizedWithCP56Time2a) io, ioa, value.f, quality, &timestamp);
+    case M_ME_TE_1:
+        return (InformationObject) MeasuredValueScaledWithCP56Time2a_create((MeasuredValueScaledWithCP56Time2a) io, ioa, value.i, quality, &timestamp);
+    case M_ME_TF_1:
+        return (InformationObject) MeasuredValueShortWithCP56Time2a_create((MeasuredValueShortWithCP56Time2a) io, ioa, value.f, quality, &timestamp);
+    case M_IT_NA_1:
+    case M_IT_TB_1:
+        {
+            /* frozen reading with the sequence number of the last freeze that included the counter */
+            int group = 0;
+
+            while ((group < POINT_DB_MAX_COUNTER_GROUPS) && !(self->groups[index] & (1 << group)))
+                group++;
+
+            int freeze = 0;
+
+            if ((group < POINT_DB_MAX_COUNTER_GROUPS) && (self->freezeGeneration[group + 1] > self->freezeGeneration[0]))
+                freeze = group + 1;
+
+            struct sBinaryCounterReading bcr;
+            BinaryCounterReading_create(&bcr, self->frozen[index - self->counterFirst].i,
+                    self->freezeGeneration[freeze] & 0x1f, false, false, (quality & IEC60870_QUALITY_INVALID) != 0);
+
+            if (type == M_IT_NA_1)
+                return (InformationObject) IntegratedTotals_create((IntegratedTotals) io, ioa, &bcr);
+
+            CP56Time2a_setFromMsTimestamp(&timestamp, self->freezeTime[freeze]);
+
+            return (InformationObject) IntegratedTotalsWithCP56Time2a_create((IntegratedTotalsWithCP56Time2a) io, ioa, &bcr, &timestamp);
+        }
+    default:
+        return NULL;
+    }
+}
@@ -0,0 +1,270 @@
+#ifndef POINT_DB_H_
+#define POINT_DB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "cs104_slave.h"
+#include "hal_thread.h"
+
+/*
+ * In-memory point table keyed by IOA.
+ *
+ * Point data is kept in parallel arrays (struct of arrays) so that GI and
+ * cyclic scans only touch the columns they need. An open addressing hash
+ * index maps an IOA to the point index in O(1). The table grows on demand,
+ * there is no fixed limit on the number of points.
+ *
+ * Changes are tracked per block of POINT_DB_BLOCK_SIZE consecutive point
+ * indexes: every update stores a new table version in the block, so users
+ * of encoded data (GI cache) can find out cheaply whether a range of points
+ * changed since they encoded it.
+ *
+ * A point can be member of interrogation groups 1..16. The per-group point
+ * lists are built by PointDB_sort, so group interrogations never scan the
+ * whole table.
+ *
+ * Integrated totals (counters) are sorted into one contiguous index range,
+ * so freezing all counters is a single copy of the value column into the
+ * frozen readings. Counter interrogation reports the frozen readings.
+ */
+
+typedef union {
+    float f;      /* normalized and short floating point measurands */
+    int32_t i;    /* single/double point state, scaled values */
+    uint32_t u;   /* bitstrings */
+} PointValue;
+
+/* Storage for one information object built by PointDB_getInformationObject */
+typedef union {
+    uint64_t align;
+    uint8_t data[256];
+} PointIOBuffer;
+
+/* The largest IOA that fits into the 3 octet information object address */
+#define POINT_DB_MAX_IOA 16777215
+
+#define POINT_DB_MAX_GROUPS 16
+
+/* Counter interrogation groups 1..4, 0 = general counter interrogation */
+#define POINT_DB_MAX_COUNTER_GROUPS 4
+
+/* point flags */
+#define POINT_DB_FLAG_PERIODIC 0x01     /* point is sent by cyclic transmission */
+#define POINT_DB_FLAG_SELECT 0x02       /* control point executes only after a select */
+
+#define POINT_DB_BLOCK_SHIFT 6
+#define POINT_DB_BLOCK_SIZE (1 << POINT_DB_BLOCK_SHIFT)
+
+typedef struct sPointDB* PointDB;
+
+struct sPointDB {
+    int count;
+    int capacity;
+
+    /* columns, indexed by point index */
+    int32_t* ioa;
+    uint8_t* type;          /* TypeID of the point */
+    PointValue* value;
+    uint8_t* quality;       /* QualityDescriptor */
+    uint64_t* timestamp;    /* ms timestamp of the last change */
+    uint16_t* groups;       /* interrogation group membership, bit 0 = group 1 (counters: counter group) */
+    int32_t* increment;     /* counter increment per advance (integrated totals only) */
+    uint8_t* flags;         /* POINT_DB_FLAG_* */
+    uint32_t* period;       /* ms, own cycle time of a periodic point or select timeout of a control point, 0 = default */
+    int32_t* link;          /* control points: IOA of the status point the command acts on, 0 = none */
+    uint32_t* delay;        /* control points: operating time in ms until the status follows the command */
+
+    /* change tracking: table version of the last change of each block (64 bit, never wraps) */
+    uint64_t version;
+    uint64_t* blockVersion;
+
+    /* IOA -> point index, -1 marks an empty slot */
+    int32_t* index;
+    uint32_t indexMask;
+
+    /* point indexes of each interrogation group, ordered like the table */
+    int32_t* groupPoints[POINT_DB_MAX_GROUPS];
+    int groupCount[POINT_DB_MAX_GROUPS];
+
+    /* integrated totals, valid after PointDB_sort */
+    int counterFirst;
+    int counterCount;
+    PointValue* frozen;     /* frozen readings, indexed by point index - counterFirst */
+
+    /* [0] all counters, [1..4] members of counter group 1..4 */
+    int32_t* counterGroupPoints[POINT_DB_MAX_COUNTER_GROUPS + 1];
+    int counterGroupCount[POINT_DB_MAX_COUNTER_GROUPS + 1];
+
+    /* freeze generation and time of the last general [0] and group [1..4] freeze */
+    uint32_t freezeGeneration[POINT_DB_MAX_COUNTER_GROUPS + 1];
+    uint64_t freezeTime[POINT_DB_MAX_COUNTER_GROUPS + 1];
+    uint32_t freezeCount;
+
+    /* binary point image the columns and indexes are mapped from (see point_image.h),
+     * NULL when they are allocated. A mapped table cannot grow or be sorted. */
+    void* mapping;
+    size_t mappingSize;
+
+    Semaphore lock;
+
+    /* owners of the table (station, pending interrogation responses), see PointDB_release */
+    int references;
+};
+
+PointDB
+PointDB_create(void);
+
+void
+PointDB_destroy(PointDB self);
+
+/**
+ * Take another reference to the table (any thread).
+ *
+ * \return the table
+ */
+PointDB
+PointDB_retain(PointDB self);
+
+/**
+ * Drop a reference, the last one destroys the table. PointDB_create
+ * returns the table with one reference.
+ */
+void
+PointDB_release(PointDB self);
+
+/**
+ * Create a copy of a sorted table (values, attributes, frozen counters).
+ */
+PointDB
+PointDB_clone(PointDB other);
+
+/**
+ * Convert a value as written in the configuration (0/1 for single points,
+ * 1/2 for double points, the number for the others) to the storage
+ * representation of the type.
+ */
+PointValue
+PointDB_convertValue(TypeID type, double configValue);
+
+/**
+ * Add a point. The configured value is converted to the storage
+ * representation of the type.
+ *
+ * \return index of the new point, or -1 when the IOA is invalid, already in
+ *         use, the type is not supported or the table is mapped from an image
+ */
+int
+PointDB_add(PointDB self, TypeID type, int ioa, float value);
+
+/**
+ * Order the points by type and IOA and build the group index. Time tagged
+ * types are placed next to their untimed variant. Has to be called after
+ * loading and before the table is used. Point indexes change!
+ *
+ * \return false when out of memory; the table must not be used then
+ */
+bool
+PointDB_sort(PointDB self);
+
+/**
+ * Set the interrogation groups of a point (bit 0 = group 1).
+ */
+void
+PointDB_setGroups(PointDB self, int index, uint16_t groups);
+
+/**
+ * \param group interrogation group 1..16
+ * \param count returns the number of points in the group
+ *
+ * \return the indexes of the points in the group
+ */
+const int32_t*
+PointDB_getGroupPoints(PointDB self, int group, int* count);
+
+/**
+ * \return index of the point with the given IOA, or -1
+ */
+int
+PointDB_lookup(PointDB self, int ioa);
+
+static inline int
+PointDB_getCount(PointDB self)
+{
+    return self->count;
+}
+
+void
+PointDB_lock(PointDB self);
+
+void
+PointDB_unlock(PointDB self);
+
+/**
+ * Update value, quality and timestamp of a point (caller holds the lock).
+ */
+void
+PointDB_setValue(PointDB self, int index, PointValue value, QualityDescriptor quality, uint64_t timestamp);
+
+/**
+ * \return the current table version (incremented by every change)
+ */
+static inline uint64_t
+PointDB_getVersion(PointDB self)
+{
+    return self->version;
+}
+
+/**
+ * Check if a point in the index range [first, last] changed after the
+ * given table version. The check has block granularity.
+ */
+bool
+PointDB_isChangedSince(PointDB self, int first, int last, uint64_t version);
+
+/**
+ * \return true for monitoring direction types, including integrated totals
+ */
+bool
+PointDB_isMonitoredType(TypeID type);
+
+/**
+ * \return true for integrated totals (M_IT_NA_1, M_IT_TB_1)
+ */
+bool
+PointDB_isCounterType(TypeID type);
+
+/**
+ * \return true for types reported by GI and cyclic transmission
+ *         (monitored types except integrated totals)
+ */
+bool
+PointDB_isInterrogatedType(TypeID type);
+
+/**
+ * \return true for control direction types without time tag (targets of commands)
+ */
+bool
+PointDB_isControlType(TypeID type);
+
+/**
+ * Map a time tagged type to the type without time tag. GI and cyclic
+ * responses are sent without time tag.
+ */
+TypeID
+PointDB_getUntimedType(TypeID type);
+
+/**
+ * Build the information object of a point in caller provided memory.
+ * Integrated totals are built from the frozen reading.
+ *
+ * \param type the type to encode (the point type or its untimed variant)
+ * \param io caller provided storage (see PointIOBuffer)
+ *
+ * \return the information object (io), or NULL for unsupported types
+ */
+InformationObject
+PointDB_getInformationObject(PointDB self, int index, TypeID type, InformationObject io);
+
+#endif /* POINT_DB_H_ */
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal_time.h"
+#include "point_diff.h"
+
+static bool
+isSameAttributes(PointDB a, int indexA, PointDB b, int indexB)
+{
+    return (a->type[indexA] == b->type[indexB]) && (a->groups[indexA] == b->groups[indexB]) &&
+            (a->flags[indexA] == b->flags[indexB]) && (a->period[indexA] == b->period[indexB]) &&
+            (a->increment[indexA] == b->increment[indexB]) && (a->link[indexA] == b->link[indexB]) &&
+            (a->delay[indexA] == b->delay[indexB]);
+}
+
+void
+PointDiff_compute(PointDiff* self, PointDB oldConfig, PointDB newConfig)
+{
+    self->added = 0;
+    self->removed = 0;
+    self->modified = 0;
+    self->changed = 0;
+
+    int i;
+    for (i = 0; i < newConfig->count; i++) {
+        int old = PointDB_lookup(oldConfig, newConfig->ioa[i]);
+
+        if (old == -1)
+            self->added++;
+        else if (!isSameAttributes(oldConfig, old, newConfig, i))
+            self->modified++;
+        else if (oldConfig->value[old].u != newConfig->value[i].u)
+            self->changed++;
+    }
+
+    for (i = 0; i < oldConfig->count; i++) {
+        if (PointDB_lookup(newConfig, oldConfig->ioa[i]) == -1)
+            self->removed++;
+    }
+}
+
+PointDB
+PointDiff_mergeTable(PointDB live, PointDB newConfig)
+{
+    PointDB self = PointDB_clone(newConfig);
+
+    if (self == NULL)
+        return NULL;
+
+    PointDB_lock(live);
+
+    int i;
+    for (i = 0; i < self->count; i++) {
+        int old = PointDB_lookup(live, self->ioa[i]);
+
+        if ((old == -1) || (live->type[old] != self->type[i]))
+            continue;
+
+        self->value[i] = live->value[old];
+        self->quality[i] = live->quality[old];
+        self->timestamp[i] = live->timestamp[old];
+
+        if (PointDB_isCounterType((TypeID) self->type[i]))
+            self->frozen[i - self->counterFirst] = live->frozen[old - live->counterFirst];
+    }
+
+    memcpy(self->freezeGeneration, live->freezeGeneration, sizeof(self->freezeGeneration));
+    memcpy(self->freezeTime, live->freezeTime, sizeof(self->freezeTime));
+    self->freezeCount = live->freezeCount;
+
+    PointDB_unlock(live);
+
+    return self;
+}
+
+int
+PointDiff_applyValues(PointDB live, PointDB oldConfig, PointDB newConfig, EventGenerator events)
+{
+    int count = 0;
+    uint64_t now = events ? EventGenerator_getTime(events) : Hal_getTimeInMs();
+
+    PointDB_lock(live);
+
+    int i;
+    for (i = 0; i < newConfig->count; i++) {
+        int old = PointDB_lookup(oldConfig, newConfig->ioa[i]);
+
+        /* new points already have the configured value */
+        if ((old == -1) || (oldConfig->value[old].u == newConfig->value[i].u))
+            continue;
+
+        int index = PointDB_lookup(live, newConfig->ioa[i]);
+
+        if ((index == -1) || (live->type[index] != newConfig->type[i]))
+            continue;
+
+        if ((live->value[index].u == newConfig->value[i].u) && (live->quality[index] == newConfig->quality[i]))
+            continue;
+
+        PointDB_setValue(live, index, newConfig->value[i], (QualityDescriptor) newConfig->quality[i], now);
+
+        if (events)
+            EventGenerator_notify(events, index);
+
+        count++;
+    }
+
+    PointDB_unlock(live);
+
+    return count;
+}
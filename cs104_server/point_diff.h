@@ -0,0 +1,57 @@
+#ifndef POINT_DIFF_H_
+#define POINT_DIFF_H_
+
+#include <stdbool.h>
+
+#include "point_db.h"
+#include "event_generator.h"
+
+/*
+ * Comparison of two configured point lists (hot reload).
+ *
+ * The configured tables are compared by IOA. A point that was added,
+ * removed or whose type or attributes (groups, periodic, counter step)
+ * changed changes the structure of the table: the live table has to be
+ * replaced by a merged one. When only configured values changed, they are
+ * written into the live table in place.
+ *
+ * The live value of a point is only overwritten when its configured value
+ * changed, so values set by commands or value models survive a reload.
+ */
+
+typedef struct {
+    int added;
+    int removed;
+    int modified;       /* type or attributes changed */
+    int changed;        /* configured value changed */
+} PointDiff;
+
+void
+PointDiff_compute(PointDiff* self, PointDB oldConfig, PointDB newConfig);
+
+static inline bool
+PointDiff_isStructureChanged(const PointDiff* self)
+{
+    return (self->added + self->removed + self->modified) > 0;
+}
+
+/**
+ * Create the new live table: a copy of the new configuration where every
+ * point that also exists in the live table with the same type keeps its
+ * live value, quality, timestamp and frozen counter reading.
+ */
+PointDB
+PointDiff_mergeTable(PointDB live, PointDB newConfig);
+
+/**
+ * Write the changed configured values into the live table and report the
+ * points whose value or quality really changes as spontaneous events.
+ *
+ * \param events generator of the live table, NULL for no events
+ *
+ * \return number of updated points
+ */
+int
+PointDiff_applyValues(PointDB live, PointDB oldConfig, PointDB newConfig, EventGenerator events);
+
+#endif /* POINT_DIFF_H_ */
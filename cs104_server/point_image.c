@@ -0,0 +1,571 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "point_image.h"
+
+typedef struct {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+    bool failed;
+} ImageBuffer;
+
+static uint32_t crcTable[256];
+
+static uint32_t
+crc32Update(uint32_t crc, const uint8_t* data, size_t size)
+{
+    if (crcTable[1] == 0) {
+        uint32_t i;
+        for (i = 0; i < 256; i++) {
+            uint32_t crc = i;
+            int bit;
+
+            for (bit = 0; bit < 8; bit++)
+                crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320u) : (crc >> 1);
+
+            crcTable[i] = crc;
+        }
+    }
+
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        crc = crcTable[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+    return crc;
+}
+
+/* CRC-32 of the whole image, the checksum field counts as zero */
+static uint32_t
+imageChecksum(const uint8_t* data, size_t size)
+{
+    struct sPointImageHeader header;
+
+    memcpy(&header, data, sizeof(header));
+    header.checksum = 0;
+
+    uint32_t crc = crc32Update(0xffffffffu, (const uint8_t*) &header, sizeof(header));
+    crc = crc32Update(crc, data + sizeof(header), size - sizeof(header));
+
+    return crc ^ 0xffffffffu;
+}
+
+static void
+reserve(ImageBuffer* buffer, size_t size)
+{
+    if (buffer->size + size > buffer->capacity) {
+        size_t newCapacity = buffer->capacity ? buffer->capacity : 65536;
+
+        while (newCapacity < buffer->size + size)
+            newCapacity *= 2;
+
+        uint8_t* data = (uint8_t*) realloc(buffer->data, newCapacity);
+
+        if (data == NULL) {
+            buffer->failed = true;
+            return;
+        }
+
+        memset(data + buffer->capacity, 0, newCapacity - buffer->capacity);
+
+        buffer->data = data;
+        buffer->capacity = newCapacity;
+    }
+}
+
+/* append a section of size bytes, the first copySize bytes from data, the rest zero */
+static void
+addSection(ImageBuffer* buffer, int section, const void* data, size_t copySize, size_t size)
+{
+    size_t offset = (buffer->size + 7) & ~((size_t) 7);
+
+    reserve(buffer, (offset - buffer->size) + size);
+
+    if (buffer->failed)
+        return;
+
+    if (copySize > 0)
+        memcpy(buffer->data + offset, data, copySize);
+
+    buffer->size = offset + size;
+
+    PointImageHeader header = (PointImageHeader) buffer->data;
+    header->sections[section].offset = offset;
+    header->sections[section].size = size;
+}
+
+#define ADD_COLUMN(section, column, elementType) \
+    addSection(&buffer, section, db->column, db->count * sizeof(elementType), capacity * sizeof(elementType))
+
+bool
+PointImage_write(const char* path, PointDB db, EventGenerator generator, GICache* giCaches)
+{
+    ImageBuffer buffer = { NULL, 0, 0, false };
+
+    reserve(&buffer, sizeof(struct sPointImageHeader));
+
+    if (buffer.failed)
+        return false;
+
+    buffer.size = sizeof(struct sPointImageHeader);
+
+    /* whole blocks, the block versions cover the capacity */
+    int capacity = ((db->count + POINT_DB_BLOCK_SIZE - 1) / POINT_DB_BLOCK_SIZE) * POINT_DB_BLOCK_SIZE;
+    if (capacity == 0)
+        capacity = POINT_DB_BLOCK_SIZE;
+
+    ADD_COLUMN(POINT_IMAGE_IOA, ioa, int32_t);
+    ADD_COLUMN(POINT_IMAGE_TYPE, type, uint8_t);
+    ADD_COLUMN(POINT_IMAGE_VALUE, value, PointValue);
+    ADD_COLUMN(POINT_IMAGE_QUALITY, quality, uint8_t);
+    ADD_COLUMN(POINT_IMAGE_TIMESTAMP, timestamp, uint64_t);
+    ADD_COLUMN(POINT_IMAGE_GROUPS, groups, uint16_t);
+    ADD_COLUMN(POINT_IMAGE_INCREMENT, increment, int32_t);
+    ADD_COLUMN(POINT_IMAGE_FLAGS, flags, uint8_t);
+    ADD_COLUMN(POINT_IMAGE_PERIOD, period, uint32_t);
+    ADD_COLUMN(POINT_IMAGE_LINK, link, int32_t);
+    ADD_COLUMN(POINT_IMAGE_DELAY, delay, uint32_t);
+
+    size_t blockVersionSize = (capacity / POINT_DB_BLOCK_SIZE) * sizeof(uint64_t);
+    addSection(&buffer, POINT_IMAGE_BLOCK_VERSION, db->blockVersion, blockVersionSize, blockVersionSize);
+
+    size_t indexSize = (db->indexMask + 1) * sizeof(int32_t);
+    addSection(&buffer, POINT_IMAGE_INDEX, db->index, indexSize, indexSize);
+
+    size_t frozenSize = db->counterCount * sizeof(PointValue);
+    addSection(&buffer, POINT_IMAGE_FROZEN, db->frozen, frozenSize, frozenSize);
+
+    int group;
+    for (group = 1; group <= POINT_DB_MAX_GROUPS; group++) {
+        size_t size = db->groupCount[group - 1] * sizeof(int32_t);
+        addSection(&buffer, POINT_IMAGE_GROUP_POINTS + group - 1, db->groupPoints[group - 1], size, size);
+    }
+
+    for (group = 0; group <= POINT_DB_MAX_COUNTER_GROUPS; group++) {
+        size_t size = db->counterGroupCount[group] * sizeof(int32_t);
+        addSection(&buffer, POINT_IMAGE_COUNTER_GROUP_POINTS + group, db->counterGroupPoints[group], size, size);
+    }
+
+    int modelCount = generator ? generator->modelCount : 0;
+
+    addSection(&buffer, POINT_IMAGE_MODELS, NULL, 0, modelCount * sizeof(PointImageModel));
+
+    if (!buffer.failed) {
+        PointImageModel* models = (PointImageModel*) (buffer.data +
+                ((PointImageHeader) buffer.data)->sections[POINT_IMAGE_MODELS].offset);
+
+        int i;
+        for (i = 0; i < modelCount; i++) {
+            models[i].ioa = generator->models[i].ioa;
+            models[i].parameters = generator->models[i].parameters;
+        }
+    }
+
+    if (giCaches) {
+        for (group = 0; group <= POINT_DB_MAX_GROUPS; group++) {
+            GICache cache = giCaches[group];
+
+            addSection(&buffer, POINT_IMAGE_GI_POINTS + group, cache->points, cache->pointCount * sizeof(int32_t),
+                    cache->pointCount * sizeof(int32_t));
+
+            GICacheEncodedFrame* frames = (GICacheEncodedFrame*) malloc((cache->frameCount + 1) * sizeof(GICacheEncodedFrame));
+            size_t asduSize = 0;
+            int i;
+
+            for (i = 0; i < cache->frameCount; i++) {
+                GICache_getEncodedFrame(cache, i, &(frames[i]));
+                asduSize += frames[i].length;
+            }
+
+            addSection(&buffer, POINT_IMAGE_GI_FRAMES + group, frames, cache->frameCount * sizeof(GICacheEncodedFrame),
+                    cache->frameCount * sizeof(GICacheEncodedFrame));
+
+            addSection(&buffer, POINT_IMAGE_GI_ASDUS + group, NULL, 0, asduSize);
+
+            if (!buffer.failed) {
+                uint8_t* asdus = buffer.data + ((PointImageHeader) buffer.data)->sections[POINT_IMAGE_GI_ASDUS + group].offset;
+
+                for (i = 0; i < cache->frameCount; i++) {
+                    GICacheEncodedFrame layout;
+                    const uint8_t* asdu = GICache_getEncodedFrame(cache, i, &layout);
+
+                    memcpy(asdus, asdu, layout.length);
+                    asdus += layout.length;
+                }
+            }
+
+            free(frames);
+        }
+    }
+
+    if (buffer.failed) {
+        free(buffer.data);
+        return false;
+    }
+
+    PointImageHeader header = (PointImageHeader) buffer.data;
+
+    memcpy(header->magic, POINT_IMAGE_MAGIC, sizeof(header->magic));
+    header->version = POINT_IMAGE_VERSION;
+    header->size = buffer.size;
+
+    header->count = db->count;
+    header->capacity = capacity;
+    header->indexMask = db->indexMask;
+    header->tableVersion = db->version;
+
+    for (group = 0; group < POINT_DB_MAX_GROUPS; group++)
+        header->groupCount[group] = db->groupCount[group];
+
+    header->counterFirst = db->counterFirst;
+    header->counterCount = db->counterCount;
+
+    for (group = 0; group <= POINT_DB_MAX_COUNTER_GROUPS; group++)
+        header->counterGroupCount[group] = db->counterGroupCount[group];
+
+    header->modelCount = modelCount;
+
+    if (giCaches) {
+        header->giCount = POINT_DB_MAX_GROUPS + 1;
+        header->oa = giCaches[0]->oa;
+        header->ca = giCaches[0]->ca;
+        header->alParams = *(giCaches[0]->alParams);
+    }
+
+    header->checksum = imageChecksum(buffer.data, buffer.size);
+
+    bool success = false;
+
+    FILE* file = fopen(path, "wb");
+
+    if (file) {
+        success = (fwrite(buffer.data, 1, buffer.size, file) == buffer.size);
+
+        if (fclose(file) != 0)
+            success = false;
+    }
+
+    free(buffer.data);
+
+    return success;
+}
+
+static bool
+checkSection(PointImage self, int section, size_t expectedSize)
+{
+    PointImageSection* s = &(self->header->sections[section]);
+
+    if ((s->offset & 7) || (s->offset < sizeof(struct sPointImageHeader)) || (s->offset > self->size) ||
+            (s->size > self->size - s->offset))
+        return false;
+
+    return (s->size == expectedSize);
+}
+
+static bool
+checkImage(PointImage self, const char* path)
+{
+    PointImageHeader header = self->header;
+
+    if ((self->size < sizeof(struct sPointImageHeader)) || (memcmp(header->magic, POINT_IMAGE_MAGIC, 8) != 0)) {
+        printf("%s: not a point image\n", path);
+        return false;
+    }
+
+    if (header->version != POINT_IMAGE_VERSION) {
+        printf("%s: image version %u, expected %u\n", path, header->version, POINT_IMAGE_VERSION);
+        return false;
+    }
+
+    if (header->size != self->size) {
+        printf("%s: truncated image (%llu of %llu bytes)\n", path, (unsigned long long) self->size,
+                (unsigned long long) header->size);
+        return false;
+    }
+
+    if (imageChecksum(self->data, self->size) != header->checksum) {
+        printf("%s: checksum mismatch\n", path);
+        return false;
+    }
+
+    size_t capacity = header->capacity;
+
+    /* the counts index the sections and the point columns, the index needs a free slot to end a probe */
+    bool valid = (header->count >= 0) && (header->count <= header->capacity) &&
+            (header->capacity % POINT_DB_BLOCK_SIZE == 0) && ((header->indexMask & (header->indexMask + 1)) == 0) &&
+            ((uint64_t) header->count <= header->indexMask) &&
+            (header->counterFirst >= 0) && (header->counterCount >= 0) &&
+            ((int64_t) header->counterFirst + header->counterCount <= header->count) &&
+            (header->modelCount >= 0) && (header->giCount >= 0) && (header->giCount <= POINT_DB_MAX_GROUPS + 1) &&
+            checkSection(self, POINT_IMAGE_IOA, capacity * sizeof(int32_t)) &&
+            checkSection(self, POINT_IMAGE_TYPE, capacity * sizeof(uint8_t)) &&
+            checkSection(self, POINT_IMAGE_VALUE, capacity * sizeof(PointValue)) &&
+            checkSection(self, POINT_IMAGE_QUALITY, capacity * sizeof(uint8_t)) &&
+            checkSection(self, POINT_IMAGE_TIMESTAMP, capacity * sizeof(uint64_t)) &&
+            checkSection(self, POINT_IMAGE_GROUPS, capacity * sizeof(uint16_t)) &&
+            checkSection(self, POINT_IMAGE_INCREMENT, capacity * sizeof(int32_t)) &&
+            checkSection(self, POINT_IMAGE_FLAGS, capacity * sizeof(uint8_t)) &&
+            checkSection(self, POINT_IMAGE_PERIOD, capacity * sizeof(uint32_t)) &&
+            checkSection(self, POINT_IMAGE_LINK, capacity * sizeof(int32_t)) &&
+            checkSection(self, POINT_IMAGE_DELAY, capacity * sizeof(uint32_t)) &&
+            checkSection(self, POINT_IMAGE_BLOCK_VERSION, (capacity / POINT_DB_BLOCK_SIZE) * sizeof(uint64_t)) &&
+            checkSection(self, POINT_IMAGE_INDEX, (header->indexMask + (size_t) 1) * sizeof(int32_t)) &&
+            checkSection(self, POINT_IMAGE_FROZEN, header->counterCount * sizeof(PointValue)) &&
+            checkSection(self, POINT_IMAGE_MODELS, header->modelCount * sizeof(PointImageModel));
+
+    int group;
+    for (group = 0; valid && (group < POINT_DB_MAX_GROUPS); group++)
+        valid = (header->groupCount[group] >= 0) && (header->groupCount[group] <= header->count) &&
+                checkSection(self, POINT_IMAGE_GROUP_POINTS + group, header->groupCount[group] * sizeof(int32_t));
+
+    for (group = 0; valid && (group <= POINT_DB_MAX_COUNTER_GROUPS); group++)
+        valid = (header->counterGroupCount[group] >= 0) && (header->counterGroupCount[group] <= header->counterCount) &&
+                checkSection(self, POINT_IMAGE_COUNTER_GROUP_POINTS + group, header->counterGroupCount[group] * sizeof(int32_t));
+
+    for (group = 0; valid && (group < header->giCount); group++) {
+        PointImageSection* frames = &(header->sections[POINT_IMAGE_GI_FRAMES + group]);
+
+        valid = checkSection(self, POINT_IMAGE_GI_POINTS + group, header->sections[POINT_IMAGE_GI_POINTS + group].size) &&
+                checkSection(self, POINT_IMAGE_GI_FRAMES + group, frames->size) &&
+                checkSection(self, POINT_IMAGE_GI_ASDUS + group, header->sections[POINT_IMAGE_GI_ASDUS + group].size);
+    }
+
+    if (!valid)
+        printf("%s: invalid image layout\n", path);
+
+    return valid;
+}
+
+#ifdef _WIN32
+
+/* no mmap: the image is read into memory (released by unmapImage or PointDB_destroy) */
+static void*
+mapImage(const char* path, size_t* size)
+{
+    FILE* file = fopen(path, "rb");
+
+    if (file == NULL) {
+        perror("Failed to open point image");
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    rewind(file);
+
+    if (fileSize <= 0) {
+        printf("%s: empty point image\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    void* data = malloc(fileSize);
+
+    if ((data == NULL) || (fread(data, 1, fileSize, file) != (size_t) fileSize)) {
+        perror("Failed to read point image");
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+
+    *size = (size_t) fileSize;
+
+    return data;
+}
+
+static void
+unmapImage(void* data, size_t size)
+{
+    free(data);
+}
+
+#else
+
+static void*
+mapImage(const char* path, size_t* size)
+{
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1) {
+        perror("Failed to open point image");
+        return NULL;
+    }
+
+    struct stat fileStat;
+
+    if ((fstat(fd, &fileStat) == -1) || (fileStat.st_size == 0)) {
+        printf("%s: empty point image\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    /* private mapping: changed points get their own copy of the page, the file is not modified */
+    void* data = mmap(NULL, fileStat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        perror("Failed to map point image");
+        return NULL;
+    }
+
+    *size = fileStat.st_size;
+
+    return data;
+}
+
+static void
+unmapImage(void* data, size_t size)
+{
+    munmap(data, size);
+}
+
+#endif /* _WIN32 */
+
+PointImage
+PointImage_open(const char* path)
+{
+    size_t size;
+    void* data = mapImage(path, &size);
+
+    if (data == NULL)
+        return NULL;
+
+    PointImage self = (PointImage) calloc(1, sizeof(struct sPointImage));
+
+    self->data = (uint8_t*) data;
+    self->size = size;
+    self->header = (PointImageHeader) data;
+
+    if (!checkImage(self, path)) {
+        PointImage_destroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+static void*
+getSection(PointImage self, int section)
+{
+    return self->data + self->header->sections[section].offset;
+}
+
+PointDB
+PointImage_getPointDB(PointImage self)
+{
+    if (self->db)
+        return self->db;
+
+    PointDB db = (PointDB) calloc(1, sizeof(struct sPointDB));
+
+    if (db == NULL)
+        return NULL;
+
+    PointImageHeader header = self->header;
+
+    db->count = header->count;
+    db->capacity = header->capacity;
+    db->references = 1;
+
+    db->ioa = (int32_t*) getSection(self, POINT_IMAGE_IOA);
+    db->type = (uint8_t*) getSection(self, POINT_IMAGE_TYPE);
+    db->value = (PointValue*) getSection(self, POINT_IMAGE_VALUE);
+    db->quality = (uint8_t*) getSection(self, POINT_IMAGE_QUALITY);
+    db->timestamp = (uint64_t*) getSection(self, POINT_IMAGE_TIMESTAMP);
+    db->groups = (uint16_t*) getSection(self, POINT_IMAGE_GROUPS);
+    db->increment = (int32_t*) getSection(self, POINT_IMAGE_INCREMENT);
+    db->flags = (uint8_t*) getSection(self, POINT_IMAGE_FLAGS);
+    db->period = (uint32_t*) getSection(self, POINT_IMAGE_PERIOD);
+    db->link = (int32_t*) getSection(self, POINT_IMAGE_LINK);
+    db->delay = (uint32_t*) getSection(self, POINT_IMAGE_DELAY);
+
+    db->version = header->tableVersion;
+    db->blockVersion = (uint64_t*) getSection(self, POINT_IMAGE_BLOCK_VERSION);
+
+    db->index = (int32_t*) getSection(self, POINT_IMAGE_INDEX);
+    db->indexMask = header->indexMask;
+
+    int group;
+    for (group = 0; group < POINT_DB_MAX_GROUPS; group++) {
+        db->groupPoints[group] = (int32_t*) getSection(self, POINT_IMAGE_GROUP_POINTS + group);
+        db->groupCount[group] = header->groupCount[group];
+    }
+
+    db->counterFirst = header->counterFirst;
+    db->counterCount = header->counterCount;
+    db->frozen = (PointValue*) getSection(self, POINT_IMAGE_FROZEN);
+
+    for (group = 0; group <= POINT_DB_MAX_COUNTER_GROUPS; group++) {
+        db->counterGroupPoints[group] = (int32_t*) getSection(self, POINT_IMAGE_COUNTER_GROUP_POINTS + group);
+        db->counterGroupCount[group] = header->counterGroupCount[group];
+    }
+
+    db->mapping = self->data;
+    db->mappingSize = self->size;
+
+    db->lock = Semaphore_create(1);
+
+    self->db = db;
+
+    return db;
+}
+
+int
+PointImage_addModels(PointImage self, EventGenerator generator)
+{
+    PointImageModel* models = (PointImageModel*) getSection(self, POINT_IMAGE_MODELS);
+
+    int i;
+    for (i = 0; i < self->header->modelCount; i++)
+        EventGenerator_addModel(generator, models[i].ioa, &(models[i].parameters));
+
+    return self->header->modelCount;
+}
+
+static bool
+isSameParameters(CS101_AppLayerParameters a, CS101_AppLayerParameters b)
+{
+    return (a->sizeOfTypeId == b->sizeOfTypeId) && (a->sizeOfVSQ == b->sizeOfVSQ) &&
+            (a->sizeOfCOT == b->sizeOfCOT) && (a->originatorAddress == b->originatorAddress) &&
+            (a->sizeOfCA == b->sizeOfCA) && (a->sizeOfIOA == b->sizeOfIOA) &&
+            (a->maxSizeOfASDU == b->maxSizeOfASDU);
+}
+
+GICache
+PointImage_createGICache(PointImage self, int group, CS101_AppLayerParameters alParams, int oa, int ca)
+{
+    PointImageHeader header = self->header;
+
+    if ((self->db == NULL) || (group >= header->giCount) || (header->oa != oa) || (header->ca != ca) ||
+            !isSameParameters(&(header->alParams), alParams))
+        return NULL;
+
+    return GICache_createEncoded(self->db,
+            (const int32_t*) getSection(self, POINT_IMAGE_GI_POINTS + group),
+            (int) (header->sections[POINT_IMAGE_GI_POINTS + group].size / sizeof(int32_t)),
+            alParams, (CS101_CauseOfTransmission) (CS101_COT_INTERROGATED_BY_STATION + group), oa, ca,
+            (const GICacheEncodedFrame*) getSection(self, POINT_IMAGE_GI_FRAMES + group),
+            (int) (header->sections[POINT_IMAGE_GI_FRAMES + group].size / sizeof(GICacheEncodedFrame)),
+            (const uint8_t*) getSection(self, POINT_IMAGE_GI_ASDUS + group));
+}
+
+void
+PointImage_destroy(PointImage self)
+{
+    if (self) {
+        if (self->db == NULL)
+            unmapImage(self->data, self->size);
+
+        free(self);
+    }
+}
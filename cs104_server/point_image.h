@@ -0,0 +1,159 @@
+#ifndef POINT_IMAGE_H_
+#define POINT_IMAGE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+#include "gi_cache.h"
+#include "event_generator.h"
+
+/*
+ * Binary point image: the point table compiled from the text configuration
+ * (see the pointc tool), loaded by mapping the file.
+ *
+ * The image holds the table columns, the IOA hash index, the group and
+ * counter indexes, the value models and the pre-encoded GI responses
+ * (station and groups 1..16). Every part is a section at an 8 byte aligned
+ * offset. The table created from an image uses the sections in place: the
+ * file is mapped private, so pages are only copied when a point changes.
+ * Without mmap (WIN32) the file is read into memory instead.
+ *
+ * The image is checked for magic, version, size and a CRC-32 over the
+ * whole file (the header included, its checksum field counted as zero).
+ * The counts of the header are checked against the sections before a
+ * table is created on them. The image is written in the native byte order
+ * and structure layout, so it is only valid for the build that wrote it.
+ */
+
+#define POINT_IMAGE_MAGIC "PT104IMG"
+#define POINT_IMAGE_VERSION 5
+
+/* sections of the image */
+#define POINT_IMAGE_IOA 0
+#define POINT_IMAGE_TYPE 1
+#define POINT_IMAGE_VALUE 2
+#define POINT_IMAGE_QUALITY 3
+#define POINT_IMAGE_TIMESTAMP 4
+#define POINT_IMAGE_GROUPS 5
+#define POINT_IMAGE_INCREMENT 6
+#define POINT_IMAGE_FLAGS 7
+#define POINT_IMAGE_PERIOD 8
+#define POINT_IMAGE_BLOCK_VERSION 9
+#define POINT_IMAGE_INDEX 10
+#define POINT_IMAGE_FROZEN 11
+#define POINT_IMAGE_MODELS 12
+#define POINT_IMAGE_GROUP_POINTS 13             /* + group - 1, groups 1..16 */
+#define POINT_IMAGE_COUNTER_GROUP_POINTS 29     /* + counter group 0..4 */
+#define POINT_IMAGE_GI_POINTS 34                /* + 0 station, 1..16 group */
+#define POINT_IMAGE_GI_FRAMES 51                /* + 0 station, 1..16 group */
+#define POINT_IMAGE_GI_ASDUS 68                 /* + 0 station, 1..16 group */
+#define POINT_IMAGE_LINK 85
+#define POINT_IMAGE_DELAY 86
+#define POINT_IMAGE_SECTION_COUNT 87
+
+typedef struct {
+    uint64_t offset;    /* from the start of the image */
+    uint64_t size;
+} PointImageSection;
+
+/* value model of a point */
+typedef struct {
+    int32_t ioa;
+    ValueModelParameters parameters;
+} PointImageModel;
+
+typedef struct sPointImageHeader* PointImageHeader;
+
+struct sPointImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t checksum;      /* CRC-32 of the image with this field zero */
+    uint64_t size;          /* size of the whole image */
+
+    int32_t count;
+    int32_t capacity;
+    uint32_t indexMask;
+    uint64_t tableVersion;
+
+    int32_t groupCount[POINT_DB_MAX_GROUPS];
+    int32_t counterFirst;
+    int32_t counterCount;
+    int32_t counterGroupCount[POINT_DB_MAX_COUNTER_GROUPS + 1];
+
+    int32_t modelCount;
+
+    /* parameters the GI responses were encoded with, giCount 0 = no responses */
+    int32_t giCount;
+    int32_t oa;
+    int32_t ca;
+    struct sCS101_AppLayerParameters alParams;
+
+    PointImageSection sections[POINT_IMAGE_SECTION_COUNT];
+};
+
+typedef struct sPointImage* PointImage;
+
+struct sPointImage {
+    uint8_t* data;
+    size_t size;
+    PointImageHeader header;
+
+    PointDB db;             /* owns the mapping once created */
+};
+
+/**
+ * Write the sorted table, its value models and GI responses to a file.
+ *
+ * \param generator value models of the points, can be NULL
+ * \param giCaches station [0] and group [1..16] responses, NULL to write none
+ *
+ * \return false when the file cannot be written
+ */
+bool
+PointImage_write(const char* path, PointDB db, EventGenerator generator, GICache* giCaches);
+
+/**
+ * Map an image and check it.
+ *
+ * \return the image, NULL when it cannot be mapped or is invalid (the
+ *         reason is printed)
+ */
+PointImage
+PointImage_open(const char* path);
+
+/**
+ * Create the table on the mapped sections. The table takes over the
+ * mapping, the image is valid as long as the table exists.
+ */
+PointDB
+PointImage_getPointDB(PointImage self);
+
+/**
+ * Add the value models of the image to the generator.
+ *
+ * \return number of models
+ */
+int
+PointImage_addModels(PointImage self, EventGenerator generator);
+
+/**
+ * Create a GI cache from the pre-encoded response (after PointImage_getPointDB).
+ *
+ * \param group 0 = station interrogation, 1..16 = group
+ *
+ * \return the cache, NULL when the image has no responses or they were
+ *         encoded with other addresses or parameters
+ */
+GICache
+PointImage_createGICache(PointImage self, int group, CS101_AppLayerParameters alParams, int oa, int ca);
+
+/**
+ * Release the image handle, unmaps the file unless a table was created.
+ */
+void
+PointImage_destroy(PointImage self);
+
+#endif /* POINT_IMAGE_H_ */
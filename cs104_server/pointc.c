@@ -0,0 +1,102 @@
+/*
+ * Point image compiler
+ *
+ * Compiles the text configuration (settings and MESS= point list) into a
+ * binary point image the server maps at startup (IMAGE=path in the
+ * configuration). The image contains the sorted point table with its
+ * indexes, the value models and the pre-encoded GI responses for the
+ * configured originator address and first common address.
+ *
+ * usage: pointc <configuration file> <image file>
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+#include "gi_cache.h"
+#include "event_generator.h"
+#include "config.h"
+#include "point_image.h"
+#include "metrics.h"
+
+static double
+getMonotonicTimeInMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int
+main(int argc, char** argv)
+{
+    if (argc != 3) {
+        printf("usage: pointc <configuration file> <image file>\n");
+        return 2;
+    }
+
+    double start = getMonotonicTimeInMs();
+
+    Metrics_init();
+
+    PointDB db = PointDB_create();
+    EventGenerator generator = EventGenerator_create(db, NULL);
+
+    Config config = Config_load(argv[1], db, Config_parsePointAttributes, generator);
+
+    if (config == NULL)
+        return 1;
+
+    if (config->errorCount > 0) {
+        printf("%s: %d errors, no image written\n", argv[1], config->errorCount);
+        return 1;
+    }
+
+    const char* oaStr = Config_get(config, "Originator Address");
+    const char* caStr = Config_get(config, "Common Address");
+
+    int oa = oaStr ? atoi(oaStr) : 0;
+    int ca = caStr ? atoi(caStr) : 1;
+
+    /* GI responses are encoded with the default parameters of the server */
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    GICache giCaches[POINT_DB_MAX_GROUPS + 1];
+    int frameCount = 0;
+
+    giCaches[0] = GICache_create(db, NULL, PointDB_getCount(db), alParams, CS101_COT_INTERROGATED_BY_STATION, oa, ca);
+    frameCount += giCaches[0]->frameCount;
+
+    int group;
+    for (group = 1; group <= POINT_DB_MAX_GROUPS; group++) {
+        int groupSize;
+        const int32_t* groupPoints = PointDB_getGroupPoints(db, group, &groupSize);
+
+        giCaches[group] = GICache_create(db, groupPoints, groupSize, alParams,
+                (CS101_CauseOfTransmission) (CS101_COT_INTERROGATED_BY_STATION + group), oa, ca);
+        frameCount += giCaches[group]->frameCount;
+    }
+
+    bool success = PointImage_write(argv[2], db, generator, giCaches);
+
+    if (success)
+        printf("%s: %d points, %d value models, %d GI frames (OA %d, CA %d) in %.1f ms\n", argv[2],
+                PointDB_getCount(db), generator->modelCount, frameCount, oa, ca, getMonotonicTimeInMs() - start);
+    else
+        perror("Failed to write point image");
+
+    for (group = 0; group <= POINT_DB_MAX_GROUPS; group++)
+        GICache_destroy(giCaches[group]);
+
+    CS104_Slave_destroy(slave);
+    Config_destroy(config);
+    EventGenerator_destroy(generator);
+    PointDB_destroy(db);
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,377 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+
+#include "replay.h"
+
+#define REPLAY_MAX_LINE 256
+#define REPLAY_FIELD_COUNT 6
+
+Replay
+Replay_create(const char* path, double speed, int ringSize, Replay_EventHandler eventHandler,
+        Replay_FlushHandler flushHandler, void* parameter)
+{
+    Replay self = (Replay) calloc(1, sizeof(struct sReplay));
+
+    if (self) {
+        int size = 1;
+        while (size < ringSize)
+            size *= 2;
+
+        self->path = strdup(path);
+        self->speed = (speed > 0.0) ? speed : 1.0;
+        self->events = (ReplayEvent*) malloc(size * sizeof(ReplayEvent));
+        self->mask = (uint32_t) (size - 1);
+
+        self->eventHandler = eventHandler;
+        self->flushHandler = flushHandler;
+        self->handlerParameter = parameter;
+    }
+
+    return self;
+}
+
+static uint64_t
+getUInt64(const uint8_t* buffer)
+{
+    uint64_t value = 0;
+
+    for (int i = 7; i >= 0; i--)
+        value = (value << 8) | buffer[i];
+
+    return value;
+}
+
+static uint32_t
+getUInt32(const uint8_t* buffer)
+{
+    return (uint32_t) buffer[0] | ((uint32_t) buffer[1] << 8) | ((uint32_t) buffer[2] << 16) |
+            ((uint32_t) buffer[3] << 24);
+}
+
+static uint16_t
+getUInt16(const uint8_t* buffer)
+{
+    return (uint16_t) (buffer[0] | (buffer[1] << 8));
+}
+
+/* false at the end of the trace */
+static bool
+readBinaryEvent(Replay self, ReplayEvent* event)
+{
+    uint8_t record[REPLAY_RECORD_SIZE];
+
+    size_t length = fread(record, 1, sizeof(record), self->file);
+
+    if (length < sizeof(record)) {
+        /* truncated last record */
+        if (length > 0)
+            self->errorCount++;
+
+        return false;
+    }
+
+    self->lineCount++;
+
+    uint64_t value = getUInt64(record + 16);
+
+    event->timestamp = getUInt64(record);
+    event->ioa = (int32_t) getUInt32(record + 8);
+    event->ca = getUInt16(record + 12);
+    event->type = record[14];
+    event->quality = record[15];
+    memcpy(&(event->value), &value, sizeof(double));
+
+    return true;
+}
+
+/* ms since 1970 or "YYYY-MM-DD hh:mm:ss[.mmm]" in UTC */
+static bool
+parseTimestamp(const char* text, uint64_t* timestamp)
+{
+    char* end;
+
+    if (strchr(text, '-') == NULL) {
+        *timestamp = strtoull(text, &end, 10);
+
+        return (end != text);
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    if (sscanf(text, "%d-%d-%d%*[ T]%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min,
+            &tm.tm_sec) != 6)
+        return false;
+
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+
+    /* fraction of the second, ".1" = 100 ms */
+    int ms = 0;
+    const char* fraction = strchr(text, '.');
+
+    if (fraction) {
+        int scale = 100;
+
+        for (fraction++; (*fraction >= '0') && (*fraction <= '9') && (scale > 0); fraction++, scale /= 10)
+            ms += (*fraction - '0') * scale;
+    }
+
+#ifdef _WIN32
+    time_t seconds = _mkgmtime(&tm);
+#else
+    time_t seconds = timegm(&tm);
+#endif
+
+    if (seconds == (time_t) -1)
+        return false;
+
+    *timestamp = (uint64_t) seconds * 1000 + (uint64_t) ms;
+
+    return true;
+}
+
+static bool
+parseInteger(const char* text, long min, long max, long* value)
+{
+    char* end;
+
+    *value = strtol(text, &end, 10);
+
+    return (end != text) && (*value >= min) && (*value <= max);
+}
+
+/* timestamp;CA;IOA;type;value[;quality], the line is modified */
+static bool
+parseLine(char* line, ReplayEvent* event)
+{
+    char* fields[REPLAY_FIELD_COUNT];
+    int count = 0;
+    char* position = line;
+
+    while (count < REPLAY_FIELD_COUNT) {
+        fields[count++] = position;
+
+        position = strpbrk(position, ";,");
+
+        if (position == NULL)
+            break;
+
+        *(position++) = 0;
+    }
+
+    if (count < 5)
+        return false;
+
+    long ca, ioa, type, quality = 0;
+    char* end;
+
+    if (!parseTimestamp(fields[0], &(event->timestamp)) || !parseInteger(fields[1], 0, 65535, &ca) ||
+            !parseInteger(fields[2], 0, 16777215, &ioa) || !parseInteger(fields[3], 1, 127, &type))
+        return false;
+
+    event->value = strtod(fields[4], &end);
+
+    if (end == fields[4])
+        return false;
+
+    if ((count > 5) && !parseInteger(fields[5], 0, 255, &quality))
+        return false;
+
+    event->ca = (uint16_t) ca;
+    event->ioa = (int32_t) ioa;
+    event->type = (uint8_t) type;
+    event->quality = (uint8_t) quality;
+
+    return true;
+}
+
+/* false at the end of the trace */
+static bool
+readTextEvent(Replay self, ReplayEvent* event)
+{
+    char line[REPLAY_MAX_LINE];
+
+    while (fgets(line, sizeof(line), self->file)) {
+        self->lineCount++;
+
+        size_t length = strlen(line);
+
+        if ((length == sizeof(line) - 1) && (line[length - 1] != '\n')) {
+            /* too long: skip the rest of the line */
+            int c;
+            while (((c = fgetc(self->file)) != EOF) && (c != '\n'))
+                ;
+
+            self->errorCount++;
+            continue;
+        }
+
+        char* start = line;
+        while ((*start == ' ') || (*start == '\t'))
+            start++;
+
+        /* header, comments and empty lines */
+        if ((*start < '0') || (*start > '9'))
+            continue;
+
+        if (parseLine(start, event))
+            return true;
+
+        self->errorCount++;
+    }
+
+    return false;
+}
+
+static void*
+readerThread(void* parameter)
+{
+    Replay self = (Replay) parameter;
+    ReplayEvent event;
+
+    while (self->binary ? readBinaryEvent(self, &event) : readTextEvent(self, &event)) {
+        uint64_t head = self->head;
+
+        /* wait for the playback to free a slot */
+        while (head - __atomic_load_n(&(self->tail), __ATOMIC_ACQUIRE) > self->mask) {
+            if (!__atomic_load_n(&(self->running), __ATOMIC_ACQUIRE))
+                goto exit_thread;
+
+            Thread_sleep(REPLAY_POLL_INTERVAL);
+        }
+
+        self->events[head & self->mask] = event;
+
+        __atomic_store_n(&(self->head), head + 1, __ATOMIC_RELEASE);
+    }
+
+exit_thread:
+    __atomic_store_n(&(self->finished), true, __ATOMIC_RELEASE);
+
+    return NULL;
+}
+
+bool
+Replay_start(Replay self)
+{
+    if (self->events == NULL)
+        return false;
+
+    self->file = fopen(self->path, "rb");
+
+    if (self->file == NULL)
+        return false;
+
+    /* large sequential reads, the kernel may read ahead as well */
+    setvbuf(self->file, NULL, _IOFBF, REPLAY_READ_BUFFER_SIZE);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fileno(self->file), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    uint8_t header[16];
+
+    if ((fread(header, 1, sizeof(header), self->file) == sizeof(header)) &&
+            (memcmp(header, REPLAY_MAGIC, 8) == 0)) {
+        if ((getUInt32(header + 8) != REPLAY_VERSION) || (getUInt32(header + 12) != REPLAY_RECORD_SIZE))
+            return false;
+
+        self->binary = true;
+    }
+    else
+        rewind(self->file);
+
+    self->running = true;
+    self->thread = Thread_create(readerThread, self, false);
+    Thread_start(self->thread);
+
+    return true;
+}
+
+/* monotonic time an event of the trace is due at */
+static uint64_t
+getPlayTime(Replay self, uint64_t timestamp)
+{
+    /* out of order events are due at once */
+    if (timestamp <= self->traceStart)
+        return self->startTime;
+
+    return self->startTime + (uint64_t) ((double) (timestamp - self->traceStart) / self->speed);
+}
+
+static void
+closeBatch(Replay self)
+{
+    if (self->batchOpen) {
+        self->flushHandler(self->handlerParameter);
+
+        self->batchOpen = false;
+        self->batchCount++;
+    }
+}
+
+uint64_t
+Replay_tick(Replay self, uint64_t now)
+{
+    /* at most a ring per tick, so a high speed does not block the caller */
+    for (uint32_t count = 0; count <= self->mask; count++) {
+        /* read before the head: no event can follow the last one once finished is set */
+        bool finished = __atomic_load_n(&(self->finished), __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&(self->head), __ATOMIC_ACQUIRE);
+
+        if (self->tail == head) {
+            if (!finished)
+                return now + REPLAY_POLL_INTERVAL;  /* the reader is behind, the batch may continue */
+
+            closeBatch(self);
+            return 0;
+        }
+
+        ReplayEvent* event = &(self->events[self->tail & self->mask]);
+
+        if (!self->started) {
+            self->started = true;
+            self->startTime = now;
+            self->traceStart = event->timestamp;
+        }
+
+        if (self->batchOpen && (event->timestamp != self->batchTime))
+            closeBatch(self);
+
+        uint64_t playTime = getPlayTime(self, event->timestamp);
+
+        if (playTime > now)
+            return playTime;
+
+        self->eventHandler(self->handlerParameter, event, playTime);
+
+        self->eventCount++;
+        self->batchOpen = true;
+        self->batchTime = event->timestamp;
+
+        __atomic_store_n(&(self->tail), self->tail + 1, __ATOMIC_RELEASE);
+    }
+
+    return now;
+}
+
+void
+Replay_destroy(Replay self)
+{
+    if (self) {
+        if (self->running) {
+            __atomic_store_n(&(self->running), false, __ATOMIC_RELEASE);
+            Thread_destroy(self->thread);
+        }
+
+        if (self->file)
+            fclose(self->file);
+
+        free(self->events);
+        free(self->path);
+        free(self);
+    }
+}
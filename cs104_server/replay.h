@@ -0,0 +1,148 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "hal_thread.h"
+
+/*
+ * Replay of a recorded event trace.
+ *
+ * The trace is streamed from the file by a reader thread into a ring of
+ * parsed events (one producer, the reader, and one consumer, the main
+ * thread ticking the replay). The reader stays up to a ring ahead of the
+ * playback and waits while the ring is full, so the memory does not depend
+ * on the size of the trace.
+ *
+ * Replay_tick hands over every event whose time has come: the playback
+ * starts with the first event of the trace and runs speed times faster
+ * than the recording. Events with the same timestamp form a batch; the
+ * flush handler is called once after the last event of a batch, so they
+ * are sent together as spontaneous ASDUs. A batch is closed when the next
+ * event is read (or the trace ends), never in the middle.
+ *
+ * Text traces have one event per line, fields separated by ';' or ',':
+ *
+ *   timestamp;CA;IOA;type;value[;quality]
+ *   2024-03-01 06:00:00.125;1;2001;31;2;0
+ *   1709272800125;1;1001;36;231.5
+ *
+ * The timestamp is in ms since 1970 or "YYYY-MM-DD hh:mm:ss[.mmm]" (UTC),
+ * the type a type identification (with or without time tag), the value is
+ * written like in a point line of the configuration and the quality is the
+ * quality descriptor (default 0 = good). Lines that don't start with a
+ * digit (header, comments) are skipped.
+ *
+ * Binary traces start with the 8 byte magic "IEC104TR", a 32 bit version
+ * (1) and a 32 bit record size (24), followed by records of
+ *
+ *   uint64 timestamp (ms since 1970), uint32 IOA, uint16 CA,
+ *   uint8 type, uint8 quality, float64 value
+ *
+ * all little endian.
+ */
+
+#define REPLAY_DEFAULT_RING_SIZE 65536      /* events read ahead */
+#define REPLAY_READ_BUFFER_SIZE (1 << 20)   /* bytes, stdio buffer of the trace file */
+#define REPLAY_POLL_INTERVAL 5              /* ms the reader (playback) waits when the ring is full (empty) */
+
+#define REPLAY_MAGIC "IEC104TR"
+#define REPLAY_VERSION 1
+#define REPLAY_RECORD_SIZE 24
+
+typedef struct {
+    uint64_t timestamp;     /* ms since 1970, as recorded */
+    int32_t ioa;
+    uint16_t ca;
+    uint8_t type;           /* TypeID */
+    uint8_t quality;        /* QualityDescriptor */
+    double value;           /* like the value of a point line */
+} ReplayEvent;
+
+/**
+ * Called for every event of a batch.
+ *
+ * \param playTime monotonic time (ms) the event was scheduled at, the same
+ *        for all events of the batch
+ */
+typedef void (*Replay_EventHandler)(void* parameter, const ReplayEvent* event, uint64_t playTime);
+
+/**
+ * Called after the last event of a batch.
+ */
+typedef void (*Replay_FlushHandler)(void* parameter);
+
+typedef struct sReplay* Replay;
+
+struct sReplay {
+    char* path;
+    double speed;
+    bool binary;
+
+    FILE* file;
+
+    /* read ahead ring */
+    ReplayEvent* events;
+    uint32_t mask;
+    uint64_t head;              /* reader */
+    uint64_t tail;              /* playback */
+    bool finished;              /* the reader reached the end of the trace */
+
+    Replay_EventHandler eventHandler;
+    Replay_FlushHandler flushHandler;
+    void* handlerParameter;
+
+    /* playback, main thread */
+    bool started;
+    uint64_t startTime;         /* ms, monotonic time of the first event */
+    uint64_t traceStart;        /* ms, timestamp of the first event */
+    bool batchOpen;
+    uint64_t batchTime;         /* timestamp of the current batch */
+
+    /* statistics */
+    uint64_t eventCount;        /* handed over */
+    uint64_t batchCount;
+    uint64_t lineCount;         /* read, including skipped lines */
+    uint64_t errorCount;        /* malformed lines or records */
+
+    bool running;
+    Thread thread;
+};
+
+/**
+ * \param speed playback speed, 1 = original timing, 10 = ten times faster
+ * \param ringSize events read ahead, rounded up to a power of two
+ */
+Replay
+Replay_create(const char* path, double speed, int ringSize, Replay_EventHandler eventHandler,
+        Replay_FlushHandler flushHandler, void* parameter);
+
+/**
+ * \brief Open the trace, detect its format and start the reader thread
+ *
+ * \return false when the file cannot be opened or has an unknown binary header
+ */
+bool
+Replay_start(Replay self);
+
+/**
+ * \brief Hand over the events due at the given time
+ *
+ * \param now monotonic time in ms
+ *
+ * \return monotonic time (ms) to tick again: the time the next event is due,
+ *         a few ms later when the reader is behind, now when more events are
+ *         due than one tick hands over; 0 when the whole trace was replayed
+ */
+uint64_t
+Replay_tick(Replay self, uint64_t now);
+
+/**
+ * \brief Stop the reader thread, close the file
+ */
+void
+Replay_destroy(Replay self);
+
+#endif /* REPLAY_H_ */
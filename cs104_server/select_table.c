@@ -0,0 +1,233 @@
+#include <stdlib.h>
+
+#include "select_table.h"
+#include "ioa_hash.h"
+
+#define SELECT_TABLE_INITIAL_SIZE 16
+
+/* slot of the IOA, or the empty slot where it belongs */
+static uint32_t
+findSlot(SelectTable self, int ioa)
+{
+    uint32_t slot = IOAHash_get(ioa) & self->mask;
+
+    while (self->slots[slot] && (self->slots[slot]->ioa != ioa))
+        slot = (slot + 1) & self->mask;
+
+    return slot;
+}
+
+static bool
+grow(SelectTable self)
+{
+    uint32_t size = (self->mask + 1) * 2;
+
+    Selection* slots = (Selection*) calloc(size, sizeof(Selection));
+
+    if (slots == NULL)
+        return false;
+
+    Selection* oldSlots = self->slots;
+    uint32_t oldSize = self->mask + 1;
+
+    self->slots = slots;
+    self->mask = size - 1;
+
+    uint32_t i;
+    for (i = 0; i < oldSize; i++) {
+        if (oldSlots[i])
+            self->slots[findSlot(self, oldSlots[i]->ioa)] = oldSlots[i];
+    }
+
+    free(oldSlots);
+
+    return true;
+}
+
+/* remove the selection in the slot and close the gap (backward shift), no tombstones */
+static void
+removeSlot(SelectTable self, uint32_t slot, bool cancelTimer)
+{
+    Selection selection = self->slots[slot];
+
+    if (cancelTimer)
+        TimerWheel_cancel(self->timers, selection->timer);
+
+    free(selection);
+
+    self->slots[slot] = NULL;
+    self->count--;
+
+    uint32_t next = (slot + 1) & self->mask;
+
+    while (self->slots[next]) {
+        uint32_t home = IOAHash_get(self->slots[next]->ioa) & self->mask;
+
+        /* the entry can move back when the gap lies between its home slot and its slot */
+        if (((next - home) & self->mask) >= ((next - slot) & self->mask)) {
+            self->slots[slot] = self->slots[next];
+            self->slots[next] = NULL;
+            slot = next;
+        }
+
+        next = (next + 1) & self->mask;
+    }
+}
+
+static void
+selectTimeout(void* parameter, uint64_t expiry)
+{
+    Selection selection = (Selection) parameter;
+    SelectTable self = selection->table;
+
+    self->timeouts++;
+
+    removeSlot(self, findSlot(self, selection->ioa), false);
+}
+
+SelectTable
+SelectTable_create(TimerWheel timers)
+{
+    SelectTable self = (SelectTable) calloc(1, sizeof(struct sSelectTable));
+
+    if (self) {
+        self->slots = (Selection*) calloc(SELECT_TABLE_INITIAL_SIZE, sizeof(Selection));
+
+        if (self->slots == NULL) {
+            free(self);
+            return NULL;
+        }
+
+        self->mask = SELECT_TABLE_INITIAL_SIZE - 1;
+        self->timers = timers;
+    }
+
+    return self;
+}
+
+void
+SelectTable_destroy(SelectTable self)
+{
+    if (self) {
+        uint32_t i;
+        for (i = 0; i <= self->mask; i++) {
+            if (self->slots[i]) {
+                TimerWheel_cancel(self->timers, self->slots[i]->timer);
+                free(self->slots[i]);
+            }
+        }
+
+        free(self->slots);
+        free(self);
+    }
+}
+
+bool
+SelectTable_select(SelectTable self, int ioa, TypeID type, PointValue value, IMasterConnection connection,
+        uint32_t timeout)
+{
+    uint32_t slot = findSlot(self, ioa);
+    Selection selection = self->slots[slot];
+
+    if (selection) {
+        if (selection->connection != connection)
+            return false;
+
+        TimerWheel_cancel(self->timers, selection->timer);
+    }
+    else {
+        /* keep the load at 50 % at most */
+        if ((uint32_t) (self->count + 1) * 2 > self->mask + 1) {
+            if (!grow(self))
+                return false;
+
+            slot = findSlot(self, ioa);
+        }
+
+        selection = (Selection) calloc(1, sizeof(struct sSelection));
+
+        if (selection == NULL)
+            return false;
+
+        selection->ioa = ioa;
+        selection->table = self;
+
+        self->slots[slot] = selection;
+        self->count++;
+    }
+
+    selection->type = (uint8_t) type;
+    selection->value = value;
+    selection->connection = connection;
+    selection->timer = TimerWheel_add(self->timers, TimerWheel_getMonotonicTime() + timeout, 0, selectTimeout,
+            selection);
+
+    if (selection->timer == -1) {
+        removeSlot(self, slot, false);
+        return false;
+    }
+
+    return true;
+}
+
+bool
+SelectTable_execute(SelectTable self, int ioa, TypeID type, PointValue value, IMasterConnection connection)
+{
+    uint32_t slot = findSlot(self, ioa);
+    Selection selection = self->slots[slot];
+
+    if ((selection == NULL) || (selection->connection != connection) || (selection->type != type) ||
+            (selection->value.u != value.u))
+        return false;
+
+    removeSlot(self, slot, true);
+
+    return true;
+}
+
+bool
+SelectTable_cancel(SelectTable self, int ioa, TypeID type, IMasterConnection connection)
+{
+    uint32_t slot = findSlot(self, ioa);
+    Selection selection = self->slots[slot];
+
+    if ((selection == NULL) || (selection->connection != connection) || (selection->type != type))
+        return false;
+
+    removeSlot(self, slot, true);
+
+    return true;
+}
+
+bool
+SelectTable_isSelected(SelectTable self, int ioa)
+{
+    return self->slots[findSlot(self, ioa)] != NULL;
+}
+
+void
+SelectTable_removeConnection(SelectTable self, IMasterConnection connection)
+{
+    if (self->count == 0)
+        return;
+
+    /* collect first, removing shifts entries to slots already visited */
+    int32_t* ioas = (int32_t*) malloc(self->count * sizeof(int32_t));
+
+    if (ioas == NULL)
+        return;
+
+    int removeCount = 0;
+
+    uint32_t i;
+    for (i = 0; i <= self->mask; i++) {
+        if (self->slots[i] && (self->slots[i]->connection == connection))
+            ioas[removeCount++] = self->slots[i]->ioa;
+    }
+
+    int j;
+    for (j = 0; j < removeCount; j++)
+        removeSlot(self, findSlot(self, ioas[j]), true);
+
+    free(ioas);
+}
@@ -0,0 +1,105 @@
+#ifndef SELECT_TABLE_H_
+#define SELECT_TABLE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "point_db.h"
+#include "timer_wheel.h"
+
+/*
+ * Select-before-operate state of the control points of a station.
+ *
+ * A select reserves the point for the selecting connection until the
+ * matching execute (same connection, type identification and value), a
+ * deactivation or the timeout. Another connection, also from another
+ * redundancy group, can neither select nor execute a reserved point.
+ *
+ * Selections are kept in an open addressing hash table keyed by IOA, only
+ * selected points take memory. Every selection has a one shot timer in the
+ * timer wheel of the endpoint, nothing is polled. The table and the wheel
+ * are used by the worker thread of the endpoint only.
+ */
+
+typedef struct sSelection* Selection;
+typedef struct sSelectTable* SelectTable;
+
+struct sSelection {
+    int32_t ioa;
+    uint8_t type;                   /* type identification of the select */
+    PointValue value;
+    IMasterConnection connection;
+    int timer;
+    SelectTable table;
+};
+
+struct sSelectTable {
+    Selection* slots;               /* NULL marks an empty slot */
+    uint32_t mask;
+    int count;
+
+    TimerWheel timers;              /* of the endpoint, not owned */
+
+    uint64_t timeouts;              /* selections dropped by their timeout */
+};
+
+/**
+ * \param timers wheel the select timeouts are scheduled in
+ */
+SelectTable
+SelectTable_create(TimerWheel timers);
+
+/**
+ * Destroy the table and cancel the timers of its selections.
+ */
+void
+SelectTable_destroy(SelectTable self);
+
+/**
+ * \brief Select a point, a repeated select of the owner restarts the timeout
+ *
+ * \param timeout ms until the selection is dropped
+ *
+ * \return false when the point is selected by another connection
+ */
+bool
+SelectTable_select(SelectTable self, int ioa, TypeID type, PointValue value, IMasterConnection connection,
+        uint32_t timeout);
+
+/**
+ * \brief Check and remove the selection matching an execute
+ *
+ * \return false when the connection has no selection of the point with the
+ *         same type identification and value
+ */
+bool
+SelectTable_execute(SelectTable self, int ioa, TypeID type, PointValue value, IMasterConnection connection);
+
+/**
+ * \brief Cancel a selection (deactivation)
+ *
+ * \return false when the connection has no selection of the point
+ */
+bool
+SelectTable_cancel(SelectTable self, int ioa, TypeID type, IMasterConnection connection);
+
+/**
+ * \return true when the point is selected by any connection
+ */
+bool
+SelectTable_isSelected(SelectTable self, int ioa);
+
+/**
+ * \brief Drop all selections of a connection (closed or stopped)
+ */
+void
+SelectTable_removeConnection(SelectTable self, IMasterConnection connection);
+
+static inline int
+SelectTable_getCount(SelectTable self)
+{
+    return self->count;
+}
+
+#endif /* SELECT_TABLE_H_ */
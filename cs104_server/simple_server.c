@@ -8,393 +8,1568 @@
 #include "hal_thread.h"
 #include "hal_time.h"
 #include <time.h>
-
-#define MAX_MESSAGES 100
-
-typedef struct {
-    int messageType;
-    int ioa;
-    float value; // Používáme float pro všechny typy hodnot
-} MessageConfig;
-
-static MessageConfig messageConfigs[MAX_MESSAGES];
-static int numMessageConfigs = 0;
+#include <sys/stat.h>
+
+#include "point_db.h"
+#include "asdu_packer.h"
+#include "gi_cache.h"
+#include "counters.h"
+#include "periodic.h"
+#include "timer_wheel.h"
+#include "event_generator.h"
+#include "load_generator.h"
+#include "slave_queue.h"
+#include "station.h"
+#include "config.h"
+#include "point_image.h"
+#include "point_diff.h"
+#include "logger.h"
+#include "capture.h"
+#include "replay.h"
+#include "metrics.h"
+#include "command.h"
+
+static const char* configPath = "/home/klient/Desktop/KONFIGSERVER104.txt";
+
+/* hodnoty bodů podle poslední načtené konfigurace, za běhu se nemění (porovnání při reloadu) */
+static PointDB configDB = NULL;
+static struct sConfigVersion {
+    time_t modified;
+    long modifiedNs;        /* st_mtime má rozlišení jen 1 s, dvě změny v jedné sekundě by se přehlédly */
+    off_t size;
+} configVersion;
+static volatile sig_atomic_t reloadRequested = 0;
+
+/* tabulka bodů a modely hodnot načtené z konfigurace, patří první stanici, ostatní dostanou kopie */
+static PointDB pointDB = NULL;
+static EventGenerator eventGenerator = NULL;
+
+/* binární obraz bodů (IMAGE=...), platí jen při vytváření stanic, jinak NULL */
+static PointImage pointImage = NULL;
+
+/* TCP koncové body (STATIONS=N), každý obsluhuje jednu nebo více společných adres */
+static StationEndpoint* endpoints = NULL;
+static int endpointCount = 1;
+
+/* všechny emulované stanice (společné adresy) přes všechny koncové body */
+static Station* stations = NULL;
+static int stationCount = 0;
+
+static StationPool stationPool = NULL;
+
+/* výpisy na konzoli a do LOGS.txt, zapisuje je vlastní vlákno */
+static Logger logger = NULL;
+
+/* záznam všech APDU do pcap souboru (CAPTURE=...), jinak NULL */
+static Capture capture = NULL;
+
+/* metriky pro Prometheus (METRICS=...), jinak NULL */
+static MetricsServer metricsServer = NULL;
+
+/* plánovač všech cyklických a spontánních událostí (ms), společný pro všechny stanice */
+static TimerWheel timerWheel = NULL;
+
+static uint32_t periodicInterval = 20000;  // Defaultní perioda je 20 sekund (ms)
+static uint32_t groupPeriods[POINT_DB_MAX_GROUPS];
+static uint32_t counterInterval = 60000;
+static uint32_t selectTimeout = 10000;     // výběr (select) povelu platí 10 s, pokud bod nemá vlastní
+
+static int lowPrioQueueSize = 10;
+static int highPrioQueueSize = 10;
+static QueuePolicy queuePolicy = QUEUE_POLICY_DROP_OLDEST;
+static uint32_t queueBlockTimeout = 0;
+
+/* režim generátoru zátěže (LOAD=...), jinak NULL */
+static char* loadConfig = NULL;
+
+/* přehrávání záznamu událostí (REPLAY=...), jinak NULL */
+static char* replayConfig = NULL;
+static Replay replay = NULL;
+
+/* stanice se změnami z rozpracované dávky záznamu */
+static Station* replayStations = NULL;
+static bool* replayPending = NULL;    // podle čísla stanice
+static int replayStationCount = 0;
+static uint64_t replaySkipped = 0;
 
 static bool running = true;
-static time_t lastSentTime = 0;
 static bool spontaneousEnabled = false;
-static int minSpontaneousInterval = 2; // defaultní minimální interval (sekundy)
-static int maxSpontaneousInterval = 10; // defaultní maximální interval (sekundy)
-static time_t nextSpontaneousTime = 0;
-static int multiplier = 1;  // Defaultní hodnota
+static uint32_t minSpontaneousInterval = 2000; // defaultní minimální interval (ms)
+static uint32_t maxSpontaneousInterval = 10000; // defaultní maximální interval (ms)
+static int multiplier = 1;  // Defaultní hodnota, násobí četnost spontánních událostí
+static double clockSpeed = 1.0;  // rychlost hodin stanic vůči reálnému času (CLOCKSPEED=60: den za 24 minut)
 
 void sigint_handler(int signalId)
 {
     running = false;
 }
 
-char* readConfigValue(const char* filePath, const char* key) {
-    FILE* file = fopen(filePath, "r");
-    if (file == NULL) {
-        perror("Failed to open file");
+/* kill -HUP načte znovu seznam bodů */
+void sighup_handler(int signalId)
+{
+    reloadRequested = 1;
+}
+
+/* Kopie hodnoty z načtené konfigurace (volající ji uvolní), NULL když klíč chybí */
+static char* readConfigValue(Config config, const char* key) {
+    const char* value = Config_get(config, key);
+
+    return value ? strdup(value) : NULL;
+}
+
+
+void configureSpontaneousMessages(const char* config) {
+    char* configCopy = strdup(config);
+    char* token = strtok(configCopy, ";");
+    if (token && atoi(token) == 1) {
+        spontaneousEnabled = true;
+        // Intervaly v sekundách, lze i desetinné (0.01 = 10 ms)
+        token = strtok(NULL, ";");
+        if (token) minSpontaneousInterval = Config_parseSeconds(token);
+        token = strtok(NULL, ";");
+        if (token) maxSpontaneousInterval = Config_parseSeconds(token);
+        if (maxSpontaneousInterval < minSpontaneousInterval)
+            maxSpontaneousInterval = minSpontaneousInterval;
+    }
+    free(configCopy);
+}
+
+static void
+statisticsTimerHandler(void* parameter, uint64_t expiry)
+{
+    static uint64_t lastEventCount = 0;
+    static uint64_t lastASDUCount = 0;
+    static uint64_t lastEnqueued = 0;
+    static uint64_t lastBackoffCount = 0;
+    static uint64_t lastCaptureDropped = 0;
+
+    /* součty přes všechny stanice */
+    uint64_t eventCount = 0, asduCount = 0, enqueued = 0, dropped = 0, blockedTime = 0, backoffCount = 0;
+    int highWaterMark = 0;
+    double targetRate = 0;
+
+    for (int i = 0; i < endpointCount; i++) {
+        SlaveQueue queue = endpoints[i]->queue;
+
+        enqueued += queue->enqueued;
+        dropped += queue->dropped;
+        blockedTime += queue->blockedTime;
+
+        if (queue->highWaterMark > highWaterMark)
+            highWaterMark = queue->highWaterMark;
+    }
+
+    for (int i = 0; i < stationCount; i++) {
+        Station station = stations[i];
+
+        eventCount += station->events->eventCount;
+        asduCount += station->events->asduCount;
+
+        if (station->load) {
+            backoffCount += station->load->backoffCount;
+            targetRate += station->load->rate;
+        }
+    }
+
+    if (enqueued != lastEnqueued) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_STATISTICS, "Queue: %llu enqueued, %llu dropped, high-water mark %d/%d, held back %llu ms",
+                (unsigned long long) enqueued, (unsigned long long) dropped,
+                highWaterMark, lowPrioQueueSize, (unsigned long long) blockedTime);
+
+        lastEnqueued = enqueued;
+    }
+
+    if (capture && (Capture_getDroppedFrames(capture) != lastCaptureDropped)) {
+        uint64_t captureDropped = Capture_getDroppedFrames(capture);
+
+        Logger_log(logger, LOG_WARNING, LOG_CATEGORY_STATISTICS, "Capture: %llu frames dropped (ring full or connection not captured), %llu written",
+                (unsigned long long) (captureDropped - lastCaptureDropped), (unsigned long long) capture->frames);
+
+        lastCaptureDropped = captureDropped;
+    }
+
+    if (stations[0]->load) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_STATISTICS, "Load: %llu events/s in %llu ASDUs/s, target %.0f %s/s, queue full %llu ms",
+                (unsigned long long) (eventCount - lastEventCount),
+                (unsigned long long) (asduCount - lastASDUCount),
+                targetRate, (stations[0]->load->unit == LOAD_UNIT_ASDUS) ? "ASDUs" : "events",
+                (unsigned long long) (backoffCount - lastBackoffCount));
+    }
+    else if (eventCount != lastEventCount) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_STATISTICS, "Spontaneous events: %llu in %llu ASDUs in the last second",
+                (unsigned long long) (eventCount - lastEventCount),
+                (unsigned long long) (asduCount - lastASDUCount));
+    }
+
+    lastBackoffCount = backoffCount;
+    lastEventCount = eventCount;
+    lastASDUCount = asduCount;
+}
+
+static void
+loadTimerHandler(void* parameter, uint64_t expiry)
+{
+    LoadGenerator_tick((LoadGenerator) parameter, expiry);
+}
+
+/* událost záznamu: bod každé stanice s adresou CA, časová značka z hodin stanice v plánovaném čase události */
+static void
+replayEventHandler(void* parameter, const ReplayEvent* event, uint64_t playTime)
+{
+    bool applied = false;
+
+    for (int i = 0; i < endpointCount; i++) {
+        Station station = StationEndpoint_getStation(endpoints[i], event->ca);
+
+        if (station == NULL)
+            continue;
+
+        PointDB db = station->db;
+        int index = PointDB_lookup(db, event->ioa);
+
+        /* jen monitorované body stejného typu (s časovou značkou i bez ní) */
+        if ((index == -1) || !PointDB_isMonitoredType((TypeID) db->type[index]) ||
+                (PointDB_getUntimedType((TypeID) db->type[index]) != PointDB_getUntimedType((TypeID) event->type)))
+            continue;
+
+        PointDB_lock(db);
+        PointDB_setValue(db, index, PointDB_convertValue((TypeID) db->type[index], event->value),
+                (QualityDescriptor) event->quality, StationClock_getTime(&(station->clock), playTime));
+        EventGenerator_notify(station->events, index);
+        PointDB_unlock(db);
+
+        if (!replayPending[station->number - 1]) {
+            replayPending[station->number - 1] = true;
+            replayStations[replayStationCount++] = station;
+        }
+
+        applied = true;
+    }
+
+    if (!applied)
+        replaySkipped++;
+}
+
+/* konec dávky se stejnou časovou značkou: změny jako spontánní ASDU, seskupené podle typu */
+static void
+replayFlushHandler(void* parameter)
+{
+    for (int i = 0; i < replayStationCount; i++) {
+        EventGenerator_flush(replayStations[i]->events, replayStations[i]->endpoint->queue);
+        replayPending[replayStations[i]->number - 1] = false;
+    }
+
+    replayStationCount = 0;
+}
+
+static void
+replayTimerHandler(void* parameter, uint64_t expiry)
+{
+    uint64_t next = Replay_tick(replay, expiry);
+
+    /* další událost záznamu (nebo nové čtení, když čtecí vlákno nestíhá) */
+    if (next != 0) {
+        TimerWheel_add(timerWheel, next, 0, replayTimerHandler, NULL);
+        return;
+    }
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Replay finished: %llu events in %llu batches in %.1f s (%llu skipped, %llu invalid lines)",
+            (unsigned long long) replay->eventCount, (unsigned long long) replay->batchCount,
+            (double) (expiry - replay->startTime) / 1000.0, (unsigned long long) replaySkipped,
+            (unsigned long long) replay->errorCount);
+}
+
+/* Přehrávání záznamu: REPLAY=soubor[;rychlost[;zpoždění startu v sekundách]]
+ * např. REPLAY=/home/klient/Desktop/trace.csv;10;30 (desetkrát rychleji, start 30 s po spuštění serveru) */
+static Replay
+startReplay(char* config, uint64_t startTime)
+{
+    char* path = strtok(config, ";");
+    char* token = strtok(NULL, ";");
+    double speed = token ? atof(token) : 1.0;
+    token = strtok(NULL, ";");
+    uint32_t delay = token ? Config_parseSeconds(token) : 0;
+
+    if (path == NULL)
+        return NULL;
+
+    Replay self = Replay_create(path, speed, REPLAY_DEFAULT_RING_SIZE, replayEventHandler, replayFlushHandler, NULL);
+
+    if (!Replay_start(self)) {
+        Logger_log(logger, LOG_ERROR, LOG_CATEGORY_SERVER, "Cannot replay %s", path);
+        Replay_destroy(self);
+        return NULL;
+    }
+
+    replayStations = (Station*) calloc(stationCount, sizeof(Station));
+    replayPending = (bool*) calloc(stationCount, sizeof(bool));
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Replaying %s trace %s at %gx speed, starting in %.1f s", self->binary ? "binary" : "text",
+            path, self->speed, delay / 1000.0);
+
+    TimerWheel_add(timerWheel, startTime + delay, 0, replayTimerHandler, NULL);
+
+    return self;
+}
+
+/* Režim zátěže: LOAD=rychlost;events|asdus[;burst[;zapnuto;vypnuto]]
+ * např. LOAD=5000;events nebo LOAD=200;asdus;50;2;8 (dávky 2 s zátěže, 8 s klidu) */
+static LoadGenerator configureLoadGenerator(const char* config, Station station) {
+    char* configCopy = strdup(config);
+    char* token = strtok(configCopy, ";");
+    double rate = token ? atof(token) : 0;
+    LoadUnit unit = LOAD_UNIT_EVENTS;
+    double burst = 0;
+    uint32_t onTime = 0, offTime = 0;
+
+    token = strtok(NULL, ";");
+    if (token && strcmp(token, "asdus") == 0)
+        unit = LOAD_UNIT_ASDUS;
+    token = strtok(NULL, ";");
+    if (token) burst = atof(token);
+    token = strtok(NULL, ";");
+    if (token) onTime = Config_parseSeconds(token);
+    token = strtok(NULL, ";");
+    if (token) offTime = Config_parseSeconds(token);
+
+    free(configCopy);
+
+    if (rate <= 0) {
+        Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONFIG, "Invalid LOAD rate, load generator disabled");
         return NULL;
     }
 
-    char* value = NULL;
-    char line[256];
-    size_t keyLen = strlen(key);
+    LoadGenerator generator = LoadGenerator_create(station->events, station->endpoint->queue, rate, unit, burst);
+
+    if (onTime > 0 && offTime > 0)
+        LoadGenerator_setDutyCycle(generator, onTime, offTime);
+
+    return generator;
+}
+
+static void
+periodicTimerHandler(void* parameter, uint64_t expiry)
+{
+    PeriodicScan scan = (PeriodicScan) parameter;
+
+    /* plná fronta (politika block): cyklus se odloží, dokud master frontu neodebere */
+    if (SlaveQueue_isBlocked(scan->queue) && !SlaveQueue_transmit(scan->queue)) {
+        scan->timer = TimerWheel_add(timerWheel, expiry + SLAVE_QUEUE_RETRY_INTERVAL, 0, periodicTimerHandler, scan);
+        return;
+    }
+
+    PeriodicScan_send(scan);
+
+    scan->timer = TimerWheel_add(timerWheel, expiry + scan->period, 0, periodicTimerHandler, scan);
+
+    if (stationCount == 1)
+        Logger_log(logger, LOG_DEBUG, LOG_CATEGORY_STATISTICS, "Periodic cycle %llu (%u ms): %d objects in %d ASDUs, encoded in %.3f ms",
+                (unsigned long long) scan->cycles, scan->period, scan->objectCount, scan->asduCount, scan->cycleTime);
+}
+
+static void
+counterTimerHandler(void* parameter, uint64_t expiry)
+{
+    Counters_advance(((Station) parameter)->db);
+}
+
+/* Periody skupin: GROUPPERIOD=skupina:sekundy,... (např. 1:0.5,3:10) */
+static void configureGroupPeriods(const char* config, uint32_t* groupPeriods) {
+    const char* pos = config;
+
+    while (*pos) {
+        char* end;
+        int group = (int) strtol(pos, &end, 10);
+
+        if (*end != ':')
+            break;
+
+        if (group >= 1 && group <= POINT_DB_MAX_GROUPS)
+            groupPeriods[group - 1] = Config_parseSeconds(end + 1);
+        else
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONFIG, "Invalid group %d in GROUPPERIOD", group);
+
+        pos = strchr(end, ',');
+        if (pos == NULL)
+            break;
+        pos++;
+    }
+}
+
+void
+formatCP56Time2a(CP56Time2a time, char* buffer, int size)
+{
+    snprintf(buffer, size, "%02i:%02i:%02i %02i/%02i/%04i", CP56Time2a_getHour(time),
+           CP56Time2a_getMinute(time),
+           CP56Time2a_getSecond(time),
+           CP56Time2a_getDayOfMonth(time),
+           CP56Time2a_getMonth(time),
+           CP56Time2a_getYear(time) + 2000);
+}
+
+
+
+/* Callback handler to capture and log sent or received messages (optional) */
+static void
+rawMessageHandler(void* parameter, IMasterConnection conneciton, uint8_t* msg, int msgSize, bool sent)
+{
+    if (capture)
+        Capture_addFrame(capture, conneciton, msg, msgSize, sent);
+
+    if (logger->level > LOG_DEBUG)
+        return;
+
+    /* do záznamu logu se vejde jen začátek zprávy */
+    char hex[LOGGER_TEXT_SIZE];
+    int length = 0;
+
+    int i;
+    for (i = 0; (i < msgSize) && (length + 4 < (int) sizeof(hex)); i++)
+        length += snprintf(hex + length, sizeof(hex) - length, "%02x ", msg[i]);
+
+    Logger_log(logger, LOG_DEBUG, LOG_CATEGORY_MESSAGE, "%s %d bytes: %s%s", sent ? "SEND" : "RCVD", msgSize, hex,
+            (i < msgSize) ? "..." : "");
+}
+
+static uint64_t
+getMonotonicTimeInNs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000000000 + (uint64_t) ts.tv_nsec;
+}
+
+/* příjem právě obsluhované aktivace (ns), 0 mimo obsluhu povelů */
+static __thread uint64_t activationReceived = 0;
+
+/* latence od příjmu aktivace do odeslání potvrzení nebo ukončení */
+static void
+recordLatency(CS101_ASDU asdu, MetricsPhase phase)
+{
+    if (activationReceived != 0)
+        Metrics_recordLatency(CS101_ASDU_getTypeID(asdu), phase, getMonotonicTimeInNs() - activationReceived);
+}
+
+/* odpovědi posílané přímo spojení (mimo frontu) se počítají do metrik zde */
+static bool
+sendASDU(IMasterConnection connection, CS101_ASDU asdu)
+{
+    if (!IMasterConnection_sendASDU(connection, asdu))
+        return false;
+
+    CS101_CauseOfTransmission cot = CS101_ASDU_getCOT(asdu);
+
+    Metrics_countASDU(CS101_ASDU_getTypeID(asdu), cot, CS101_ASDU_getNumberOfElements(asdu));
+
+    /* kladné i záporné potvrzení (neznámý typ, COT, CA, IOA) */
+    if ((cot == CS101_COT_ACTIVATION_CON) || (cot >= CS101_COT_UNKNOWN_TYPE_ID))
+        recordLatency(asdu, METRICS_PHASE_CON);
+
+    return true;
+}
+
+static bool
+sendActivationCon(IMasterConnection connection, CS101_ASDU asdu, bool negative)
+{
+    if (!IMasterConnection_sendACT_CON(connection, asdu, negative))
+        return false;
+
+    Metrics_countASDU(CS101_ASDU_getTypeID(asdu), CS101_COT_ACTIVATION_CON, CS101_ASDU_getNumberOfElements(asdu));
+    recordLatency(asdu, METRICS_PHASE_CON);
+
+    return true;
+}
+
+static bool
+sendActivationTerm(IMasterConnection connection, CS101_ASDU asdu)
+{
+    if (!IMasterConnection_sendACT_TERM(connection, asdu))
+        return false;
+
+    Metrics_countASDU(CS101_ASDU_getTypeID(asdu), CS101_COT_ACTIVATION_TERMINATION, CS101_ASDU_getNumberOfElements(asdu));
+    recordLatency(asdu, METRICS_PHASE_TERM);
+
+    return true;
+}
+
+static bool
+sendGIResponse(void* parameter, CS101_ASDU asdu)
+{
+    return sendASDU((IMasterConnection) parameter, asdu);
+}
+
+/* 0xFF při jednooktetové, 0xFFFF při dvouoktetové společné adrese */
+static bool
+isBroadcastAddress(IMasterConnection connection, int ca)
+{
+    CS101_AppLayerParameters alParams = IMasterConnection_getApplicationLayerParameters(connection);
+
+    return ca == ((alParams->sizeOfCA == 1) ? 0xff : 0xffff);
+}
+
+static void
+sendUnknownCA(IMasterConnection connection, CS101_ASDU asdu)
+{
+    Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Unknown common address %i", CS101_ASDU_getCA(asdu));
+
+    CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_CA);
+    CS101_ASDU_setNegative(asdu, true);
+    sendASDU(connection, asdu);
+}
+
+/* synchronizace nastaví hodiny stanice (ne systémový čas), broadcast hodiny všech stanic koncového bodu */
+static bool
+clockSyncHandler (void* parameter, IMasterConnection connection, CS101_ASDU asdu, CP56Time2a newTime)
+{
+    StationEndpoint endpoint = (StationEndpoint) parameter;
+    int ca = CS101_ASDU_getCA(asdu);
+
+    char timeText[32];
+    formatCP56Time2a(newTime, timeText, sizeof(timeText));
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_COMMAND, "Process time sync command with time %s (CA %i)", timeText, ca);
+
+    uint64_t newTimeInMs = CP56Time2a_toMsTimestamp(newTime);
+    Station station;
+
+    if (isBroadcastAddress(connection, ca)) {
+        if (endpoint->stationCount == 0)
+            return false;
+
+        for (int i = 0; i < endpoint->stationCount; i++)
+            StationClock_setTime(&(endpoint->stations[i]->clock), newTimeInMs);
+
+        station = endpoint->stations[0];
+    }
+    else {
+        station = StationEndpoint_getStation(endpoint, ca);
+
+        /* neznámá adresa -> negativní ACT_CON */
+        if (station == NULL) {
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Unknown common address %i", ca);
+            return false;
+        }
+
+        StationClock_setTime(&(station->clock), newTimeInMs);
+    }
+
+    /* Set time for ACT_CON message */
+    CP56Time2a_setFromMsTimestamp(newTime, StationClock_now(&(station->clock)));
+
+    return true;
+}
+
+/* odešle zbytek odpovědi na (skupinový) generální dotaz; false = okno k je plné */
+static bool
+sendInterrogationFrames(IMasterConnection connection, PendingResponse response)
+{
+    Station station = response->station;
+    GICache cache = response->cache;
+
+    /* The CS101 specification only allows information objects without timestamp in GI responses */
+
+    /* send the pre-encoded response, only frames with changed points are encoded again */
+    if (!GICache_send(cache, &(response->frame), sendGIResponse, connection))
+        return false;
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_INTERROGATION, "GI response CA %i: %d ASDUs (cache hits: %llu misses: %llu)", station->ca, cache->frameCount,
+            (unsigned long long) cache->hits, (unsigned long long) cache->misses);
+
+    return true;
+}
+
+/* zmrazení/nulování se provede po ACT_CON, čtení pošle kopii zmrazených stavů pořízenou s ACT_CON zabalenou jako odpověď na GI */
+static bool
+sendCounterFrames(IMasterConnection connection, PendingResponse response, bool confirmed)
+{
+    Station station = response->station;
+
+    int rqt = response->qualifier & 0x3f;      /* 1..4 = group 1..4, 5 = general counter interrogation */
+    int frz = (response->qualifier >> 6) & 3;  /* 0 = read, 1 = freeze, 2 = freeze and reset, 3 = reset */
+    int group = (rqt == 5) ? 0 : rqt;
+
+    if (confirmed) {
+        PointDB db = __atomic_load_n(&(station->db), __ATOMIC_ACQUIRE);
+
+        if (frz == 3)
+            Counters_reset(db, group);
+        else if (frz != 0)
+            Counters_freeze(db, group, (frz == 2), StationClock_now(&(station->clock)));
+        else {
+            /* zmrazení jiným masterem ani reload už rozpracovanou odpověď nezmění */
+            response->db = Counters_createSnapshot(db, group);
+
+            if (response->db == NULL)
+                Logger_log(logger, LOG_ERROR, LOG_CATEGORY_INTERROGATION, "Cannot copy the frozen counters of CA %i", station->ca);
+        }
+    }
+
+    if ((frz != 0) || (response->db == NULL))
+        return true;
+
+    /* send the frozen readings packed like the GI response, from the first point not sent yet */
+    PointDB snapshot = response->db;
+    CS101_AppLayerParameters alParams = IMasterConnection_getApplicationLayerParameters(connection);
+
+    struct sASDUPacker packer;
+    ASDUPacker_init(&packer, alParams, (CS101_CauseOfTransmission) (CS101_COT_REQUESTED_BY_GENERAL_COUNTER + group),
+            station->oa, station->ca, sendGIResponse, connection);
+
+    bool sent = ASDUPacker_addPointRange(&packer, snapshot, NULL, response->point, PointDB_getCount(snapshot), false) &&
+            ASDUPacker_flush(&packer);
+
+    response->point += packer.objectCount;
+    response->frame += packer.asduCount;
+
+    if (!sent)
+        return false;
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_INTERROGATION, "Counter interrogation response CA %i: %d objects in %d ASDUs", station->ca,
+            response->point, response->frame);
+
+    return true;
+}
+
+/* ACT_CON, data a ACT_TERM odpovědi, pokud je spojení přijme; true = odpověď je celá odeslaná */
+static bool
+continueResponse(IMasterConnection connection, PendingResponse response)
+{
+    CS101_ASDU asdu = (CS101_ASDU) &(response->asdu);
+    Station station = response->station;
+    bool completed = false;
+    bool confirmed = false;
+
+    activationReceived = response->received;
+
+    if (!response->confirmed) {
+        if (!sendActivationCon(connection, asdu, false))
+            goto exit_function;
+
+        response->confirmed = true;
+        confirmed = true;
+
+        /* odpověď dojede z cache a tabulky platných při ACT_CON, i když je reload mezitím vymění */
+        if (!response->isCounter) {
+            GICache cache = __atomic_load_n(&(station->giCaches[response->qualifier - IEC60870_QOI_STATION]), __ATOMIC_ACQUIRE);
+
+            response->cache = GICache_retain(cache);
+            response->db = PointDB_retain(cache->db);
+        }
+    }
+
+    if (response->isCounter) {
+        if (!sendCounterFrames(connection, response, confirmed))
+            goto exit_function;
+    }
+    else {
+        if (!sendInterrogationFrames(connection, response))
+            goto exit_function;
+    }
+
+    if (!sendActivationTerm(connection, asdu))
+        goto exit_function;
+
+    /* doba od příjmu aktivace do odeslání ACT_TERM */
+    if (!response->isCounter) {
+        MetricsCounters* counters = Metrics_getCounters();
+        METRICS_ADD(counters->interrogations, 1);
+        METRICS_ADD(counters->interrogationTime, (getMonotonicTimeInNs() - response->received) / 1000);
+    }
+
+    completed = true;
+
+exit_function:
+    activationReceived = 0;
+
+    return completed;
+}
+
+/* odpovědi spojení v pořadí příjmu aktivací, dokud je spojení přijímá */
+static void
+continueResponses(StationConnection* connection)
+{
+    while (connection->responses) {
+        if (!continueResponse(connection->connection, connection->responses)) {
+            Logger_log(logger, LOG_DEBUG, LOG_CATEGORY_INTERROGATION, "Response CA %i waits for the send window (%d ASDUs sent)",
+                    connection->responses->station->ca, connection->responses->frame);
+            return;
+        }
+
+        StationConnection_removeResponse(connection);
+    }
+}
+
+/* odpověď se zařadí za nedokončené odpovědi spojení a hned se začne posílat */
+static void
+addResponse(StationEndpoint endpoint, Station station, IMasterConnection connection, CS101_ASDU asdu, bool isCounter,
+        uint8_t qualifier)
+{
+    StationConnection* stationConnection = StationEndpoint_getConnection(endpoint, connection);
+    PendingResponse response = NULL;
+
+    if (stationConnection)
+        response = (PendingResponse) calloc(1, sizeof(struct sPendingResponse));
+
+    if (response == NULL) {
+        Logger_log(logger, LOG_ERROR, LOG_CATEGORY_INTERROGATION, "Cannot queue the response for CA %i", station->ca);
+        sendActivationCon(connection, asdu, true);
+        return;
+    }
+
+    response->station = station;
+    response->isCounter = isCounter;
+    response->qualifier = qualifier;
+    response->received = activationReceived;
+    CS101_ASDU_clone(asdu, &(response->asdu));
+
+    StationConnection_addResponse(stationConnection, response);
+
+    continueResponses(stationConnection);
+}
+
+static void
+sendInterrogationResponse(StationEndpoint endpoint, Station station, IMasterConnection connection, CS101_ASDU asdu,
+        uint8_t qoi)
+{
+    /* station interrogation (QOI 20) and group 1..16 interrogation (QOI 21..36) */
+    if ((qoi >= IEC60870_QOI_STATION) && (qoi <= IEC60870_QOI_GROUP_16))
+        addResponse(endpoint, station, connection, asdu, false, qoi);
+    else
+        sendActivationCon(connection, asdu, true);
+}
+
+static bool
+interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
+{
+    StationEndpoint endpoint = (StationEndpoint) parameter;
+    int ca = CS101_ASDU_getCA(asdu);
+
+    activationReceived = getMonotonicTimeInNs();
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_INTERROGATION, "Received interrogation for group %i (CA %i)", qoi, ca);
+
+    if (isBroadcastAddress(connection, ca)) {
+        /* broadcast: every station answers with its own common address */
+        for (int i = 0; i < endpoint->stationCount; i++) {
+            CS101_ASDU_setCA(asdu, endpoint->stations[i]->ca);
+            sendInterrogationResponse(endpoint, endpoint->stations[i], connection, asdu, qoi);
+        }
+    }
+    else {
+        Station station = StationEndpoint_getStation(endpoint, ca);
+
+        if (station)
+            sendInterrogationResponse(endpoint, station, connection, asdu, qoi);
+        else
+            sendUnknownCA(connection, asdu);
+    }
+
+    activationReceived = 0;
+
+    return true;
+}
+
+static void
+sendCounterInterrogationResponse(StationEndpoint endpoint, Station station, IMasterConnection connection,
+        CS101_ASDU asdu, uint8_t qcc)
+{
+    int rqt = qcc & 0x3f;
+
+    if ((rqt >= 1) && (rqt <= 5))
+        addResponse(endpoint, station, connection, asdu, true, qcc);
+    else
+        sendActivationCon(connection, asdu, true);
+}
+
+static bool
+counterInterrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qcc)
+{
+    StationEndpoint endpoint = (StationEndpoint) parameter;
+    int ca = CS101_ASDU_getCA(asdu);
+
+    activationReceived = getMonotonicTimeInNs();
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_INTERROGATION, "Received counter interrogation RQT %i FRZ %i (CA %i)", qcc & 0x3f, (qcc >> 6) & 3, ca);
+
+    if (isBroadcastAddress(connection, ca)) {
+        /* broadcast freeze/read: every station answers with its own common address */
+        for (int i = 0; i < endpoint->stationCount; i++) {
+            CS101_ASDU_setCA(asdu, endpoint->stations[i]->ca);
+            sendCounterInterrogationResponse(endpoint, endpoint->stations[i], connection, asdu, qcc);
+        }
+    }
+    else {
+        Station station = StationEndpoint_getStation(endpoint, ca);
+
+        if (station)
+            sendCounterInterrogationResponse(endpoint, station, connection, asdu, qcc);
+        else
+            sendUnknownCA(connection, asdu);
+    }
+
+    activationReceived = 0;
+
+    return true;
+}
+
+/* návratová informace (COT 11) jde všem aktivním spojením koncového bodu, jako spontánní data */
+static bool
+sendToConnections(void* parameter, CS101_ASDU asdu)
+{
+    StationEndpoint endpoint = (StationEndpoint) parameter;
+
+    for (int i = 0; i < endpoint->connectionCount; i++)
+        sendASDU(endpoint->connections[i].connection, asdu);
+
+    return true;
+}
+
+/* ASDU zabalené pod zámkem tabulky, odeslané až po odemčení */
+typedef struct {
+    bool packed;
+    struct sCS101_StaticASDU asdu;
+} ASDUCopy;
+
+static bool
+copyASDU(void* parameter, CS101_ASDU asdu)
+{
+    ASDUCopy* copy = (ASDUCopy*) parameter;
+
+    CS101_ASDU_clone(asdu, &(copy->asdu));
+    copy->packed = true;
+
+    return true;
+}
+
+/* dokončení povelu: stavový bod převezme povel, odešle se návratová informace a ACT_TERM */
+static void
+completeCommand(Station station, int ioa, TypeID type, PointValue value, IMasterConnection connection, CS101_ASDU asdu)
+{
+    const CommandType* commandType = Command_getType(type);
+    PointDB db = __atomic_load_n(&(station->db), __ATOMIC_ACQUIRE);
+
+    /* bod mohl zmizet při reloadu */
+    int index = PointDB_lookup(db, ioa);
+
+    if ((index != -1) && (db->link[index] != 0)) {
+        int status = PointDB_lookup(db, db->link[index]);
+
+        ASDUCopy returnInfo = { false };
+
+        PointDB_lock(db);
+
+        PointValue statusValue;
+        bool linked = (status != -1) && PointDB_isMonitoredType((TypeID) db->type[status]);
+
+        if (linked) {
+            statusValue = db->value[status];
+            linked = Command_getStatusValue(commandType, value, (TypeID) db->type[status], &statusValue);
+        }
+
+        if (linked) {
+            PointDB_setValue(db, status, statusValue, IEC60870_QUALITY_GOOD, StationClock_now(&(station->clock)));
+
+            struct sASDUPacker packer;
+            ASDUPacker_init(&packer, CS104_Slave_getAppLayerParameters(station->endpoint->slave),
+                    CS101_COT_RETURN_INFO_REMOTE, station->oa, station->ca, copyASDU, &returnInfo);
+
+            ASDUPacker_addPoint(&packer, db, status, (TypeID) db->type[status]);
+            ASDUPacker_flush(&packer);
+        }
+
+        PointDB_unlock(db);
+
+        if (returnInfo.packed)
+            sendToConnections(station->endpoint, (CS101_ASDU) &(returnInfo.asdu));
+
+        if (!linked)
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: status IOA %i missing or of another kind",
+                    type, ioa, db->link[index]);
+    }
+
+    if (commandType->terminate && connection)
+        sendActivationTerm(connection, asdu);
+}
+
+/* uplynula doba přestavení (ve vlákně koncového bodu) */
+static void
+operationCompleted(void* parameter, Operation operation)
+{
+    activationReceived = operation->received;
+
+    completeCommand((Station) parameter, operation->ioa, operation->type, operation->value, operation->connection,
+            (CS101_ASDU) &(operation->asdu));
+
+    activationReceived = 0;
+}
+
+/* povel: ACT_CON (+ ACT_TERM po provedení), jinak záporná odpověď */
+static void
+handleCommand(Station station, PointDB db, const CommandType* commandType, IMasterConnection connection,
+        CS101_ASDU asdu)
+{
+    CS101_CauseOfTransmission cot = CS101_ASDU_getCOT(asdu);
+
+    if ((cot != CS101_COT_ACTIVATION) && (cot != CS101_COT_DEACTIVATION)) {
+        CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
+        CS101_ASDU_setNegative(asdu, true);
+        sendASDU(connection, asdu);
+        return;
+    }
+
+    InformationObject io = CS101_ASDU_getElement(asdu, 0);
+
+    if (io == NULL) {
+        Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Message has no valid information object");
+        return;
+    }
+
+    TypeID type = CS101_ASDU_getTypeID(asdu);
+    int ioa = InformationObject_getObjectAddress(io);
+
+    Command command;
+    CommandResult result = Command_decode(commandType, db, io, &command);
+
+    InformationObject_destroy(io);
+
+    if ((result == COMMAND_UNKNOWN_IOA) || (result == COMMAND_UNKNOWN_TYPE)) {
+        Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: %s", type, ioa,
+                (result == COMMAND_UNKNOWN_IOA) ? "unknown IOA" : "point has another type");
+
+        CS101_ASDU_setCOT(asdu, (result == COMMAND_UNKNOWN_IOA) ? CS101_COT_UNKNOWN_IOA : CS101_COT_UNKNOWN_TYPE_ID);
+        CS101_ASDU_setNegative(asdu, true);
+        sendASDU(connection, asdu);
+        return;
+    }
+
+    /* deaktivace ruší výběr tohoto spojení */
+    if (cot == CS101_COT_DEACTIVATION) {
+        bool cancelled = SelectTable_cancel(station->selections, ioa, type, connection);
+
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: %s", type, ioa,
+                cancelled ? "selection cancelled" : "deactivation without selection");
+
+        CS101_ASDU_setCOT(asdu, CS101_COT_DEACTIVATION_CON);
+        CS101_ASDU_setNegative(asdu, !cancelled);
+        sendASDU(connection, asdu);
+        return;
+    }
+
+    switch (result) {
+    case COMMAND_EXECUTE:
+        /* provedení musí odpovídat výběru; bez výběru jen u bodů bez sbo, které nikdo nevybral */
+        if (!SelectTable_execute(station->selections, ioa, type, command.value, connection) &&
+                ((db->flags[command.index] & POINT_DB_FLAG_SELECT) || SelectTable_isSelected(station->selections, ioa))) {
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: execute without matching select",
+                    type, ioa);
+
+            sendActivationCon(connection, asdu, true);
+            break;
+        }
+
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_COMMAND, "Command type %i IOA %i executed", type, ioa);
+
+        PointDB_lock(db);
+        PointDB_setValue(db, command.index, command.value, IEC60870_QUALITY_GOOD, StationClock_now(&(station->clock)));
+        PointDB_unlock(db);
+
+        sendActivationCon(connection, asdu, false);
+
+        if (db->delay[command.index] > 0) {
+            if (!OperationList_add(station->operations, ioa, command.value, connection, asdu, activationReceived,
+                    db->delay[command.index]))
+                Logger_log(logger, LOG_ERROR, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: cannot schedule the operation",
+                        type, ioa);
+        }
+        else
+            completeCommand(station, ioa, type, command.value, connection, asdu);
+        break;
+
+    case COMMAND_SELECT:
+    {
+        uint32_t timeout = (db->period[command.index] > 0) ? db->period[command.index] : selectTimeout;
+
+        if (SelectTable_select(station->selections, ioa, type, command.value, connection, timeout)) {
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_COMMAND, "Command type %i IOA %i selected", type, ioa);
+            sendActivationCon(connection, asdu, false);
+        }
+        else {
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: selected by another connection",
+                    type, ioa);
+            sendActivationCon(connection, asdu, true);
+        }
+        break;
+    }
+
+    default:
+        Logger_log(logger, LOG_WARNING, LOG_CATEGORY_COMMAND, "Command type %i IOA %i: value not permitted", type, ioa);
+
+        sendActivationCon(connection, asdu, true);
+        break;
+    }
+}
+
+static bool
+handleASDU(void* parameter, IMasterConnection connection, CS101_ASDU asdu)
+{
+    /* povely se broadcastem neposílají, broadcast adresa tu je neznámá */
+    Station station = StationEndpoint_getStation((StationEndpoint) parameter, CS101_ASDU_getCA(asdu));
+
+    if (station == NULL) {
+        sendUnknownCA(connection, asdu);
+        return true;
+    }
+
+    const CommandType* commandType = Command_getType(CS101_ASDU_getTypeID(asdu));
+
+    /* ostatní typy odmítne knihovna (UNKNOWN_TYPE_ID) */
+    if (commandType == NULL)
+        return false;
+
+    PointDB db = __atomic_load_n(&(station->db), __ATOMIC_ACQUIRE);
+
+    handleCommand(station, db, commandType, connection, asdu);
+
+    return true;
+}
+
+/* Povely, s měřením latence od příjmu do potvrzení */
+static bool
+asduHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu)
+{
+    activationReceived = getMonotonicTimeInNs();
+
+    bool handled = handleASDU(parameter, connection, asdu);
+
+    activationReceived = 0;
+
+    return handled;
+}
+
+static bool
+connectionRequestHandler(void* parameter, const char* ipAddress)
+{
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "New connection request from %s", ipAddress);
+
+#if 0
+    if (strcmp(ipAddress, "127.0.0.1") == 0) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "Accept connection");
+        return true;
+    }
+    else {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "Deny connection");
+        return false;
+    }
+#else
+    return true;
+#endif
+}
+
+/* výběry a nedokončené povely patří jen spojení, které je poslalo */
+static void
+forgetConnection(StationEndpoint endpoint, IMasterConnection con)
+{
+    for (int i = 0; i < endpoint->stationCount; i++) {
+        SelectTable_removeConnection(endpoint->stations[i]->selections, con);
+        OperationList_removeConnection(endpoint->stations[i]->operations, con);
+    }
+}
+
+static void
+connectionEventHandler(void* parameter, IMasterConnection con, CS104_PeerConnectionEvent event)
+{
+    StationEndpoint endpoint = (StationEndpoint) parameter;
+    MetricsCounters* counters = Metrics_getCounters();
+
+    if (event == CS104_CON_EVENT_CONNECTION_OPENED) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "Connection opened (%p)", con);
+        METRICS_ADD(counters->connectionsOpened, 1);
+
+        if (capture) {
+            char peerAddress[64];
+            IMasterConnection_getPeerAddress(con, peerAddress, sizeof(peerAddress));
+
+            if (!Capture_openConnection(capture, con, peerAddress, endpoint->address, endpoint->port))
+                Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONNECTION, "Connection %p not captured, all %d capture streams in use",
+                        con, capture->streamCount);
+        }
+    }
+    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "Connection closed (%p)", con);
+        METRICS_ADD(counters->connectionsClosed, 1);
+
+        /* zavřené bez STOPDT */
+        if (StationEndpoint_removeConnection(endpoint, con))
+            METRICS_ADD(counters->connectionsDeactivated, 1);
+
+        forgetConnection(endpoint, con);
+
+        if (capture)
+            Capture_closeConnection(capture, con);
+    }
+    else if (event == CS104_CON_EVENT_ACTIVATED) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "Connection activated (%p)", con);
+        METRICS_ADD(counters->connectionsActivated, 1);
+        StationEndpoint_addConnection(endpoint, con);
+    }
+    else if (event == CS104_CON_EVENT_DEACTIVATED) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONNECTION, "Connection deactivated (%p)", con);
+
+        if (StationEndpoint_removeConnection(endpoint, con))
+            METRICS_ADD(counters->connectionsDeactivated, 1);
+
+        forgetConnection(endpoint, con);
+    }
+}
+
+/* Po každém ticku koncového bodu (ve vlákně stanice): doba, kdy aktivní spojení mělo plné okno k, a pokračování odpovědí */
+static void
+endpointTickHandler(void* parameter, StationEndpoint endpoint)
+{
+    uint64_t now = getMonotonicTimeInNs() / 1000;
+
+    if ((endpoint->connectionCount > 0) && (endpoint->lastTick != 0)) {
+        MetricsCounters* counters = Metrics_getCounters();
+
+        for (int i = 0; i < endpoint->connectionCount; i++) {
+            StationConnection* connection = &(endpoint->connections[i]);
+            bool stalled = !IMasterConnection_isReady(connection->connection);
+
+            if (stalled) {
+                if (!connection->stalled)
+                    METRICS_ADD(counters->kWindowStalls, 1);
+
+                METRICS_ADD(counters->kWindowStallTime, now - endpoint->lastTick);
+            }
+
+            connection->stalled = stalled;
+        }
+    }
+
+    /* odpovědi na dotazy přerušené plným oknem k */
+    for (int i = 0; i < endpoint->connectionCount; i++) {
+        StationConnection* connection = &(endpoint->connections[i]);
+
+        if (connection->responses && IMasterConnection_isReady(connection->connection))
+            continueResponses(connection);
+    }
+
+    endpoint->lastTick = now;
+}
+
+/* Latence potvrzení povelů za celý běh (při ukončení) */
+static void
+logLatencySummary(void)
+{
+    static const char* phaseNames[METRICS_PHASES] = { "ACT_CON", "ACT_TERM" };
+
+    Histogram* latency = (Histogram*) malloc(sizeof(Histogram));
+
+    for (int type = 0; type < METRICS_MAX_TYPE; type++) {
+        for (int phase = 0; phase < METRICS_PHASES; phase++) {
+            Histogram_init(latency);
+
+            if (!Metrics_getLatency(type, (MetricsPhase) phase, latency))
+                continue;
+
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_STATISTICS,
+                    "Latency type %d to %s: %llu, p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms",
+                    type, phaseNames[phase], (unsigned long long) latency->count,
+                    Histogram_getPercentile(latency, 0.5) / 1e6, Histogram_getPercentile(latency, 0.99) / 1e6,
+                    Histogram_getPercentile(latency, 0.999) / 1e6, latency->max / 1e6);
+        }
+    }
+
+    free(latency);
+}
+
+/* Metriky front a logu, přidané za čítače vláken */
+static void
+collectServerMetrics(void* parameter, MetricsBuffer* out)
+{
+    static const char* queueMetrics[][3] = {
+        { "iec104_queue_enqueued_total", "counter", "ASDUs put into the low priority queue" },
+        { "iec104_queue_dropped_total", "counter", "ASDUs dropped on a full low priority queue" },
+        { "iec104_queue_blocked_seconds_total", "counter", "Time ASDUs were held back by a full queue" },
+        { "iec104_queue_depth", "gauge", "Entries in the low priority queue" },
+        { "iec104_queue_high_water_mark", "gauge", "Highest fill of the low priority queue" },
+        { "iec104_queue_capacity", "gauge", "Size of the low priority queue" }
+    };
+
+    for (int metric = 0; metric < 6; metric++) {
+        MetricsBuffer_append(out, "# HELP %s %s\n# TYPE %s %s\n", queueMetrics[metric][0], queueMetrics[metric][2],
+                queueMetrics[metric][0], queueMetrics[metric][1]);
+
+        for (int i = 0; i < endpointCount; i++) {
+            SlaveQueue queue = endpoints[i]->queue;
+            double value;
+
+            switch (metric) {
+            case 0: value = (double) __atomic_load_n(&(queue->enqueued), __ATOMIC_RELAXED); break;
+            case 1: value = (double) __atomic_load_n(&(queue->dropped), __ATOMIC_RELAXED); break;
+            case 2: value = __atomic_load_n(&(queue->blockedTime), __ATOMIC_RELAXED) / 1000.0; break;
+            case 3: value = SlaveQueue_getFill(queue); break;
+            case 4: value = __atomic_load_n(&(queue->highWaterMark), __ATOMIC_RELAXED); break;
+            default: value = queue->size; break;
+            }
 
-    while (fgets(line, sizeof(line), file)) {
-        char* pos = strstr(line, key);
-        if (pos != NULL && line[keyLen] == '=') {
-            char* startOfValue = pos + keyLen + 1;
-            char* endOfValue = startOfValue + strcspn(startOfValue, "\r\n");
-            *endOfValue = '\0';
-            value = strdup(startOfValue);
-            break;
+            MetricsBuffer_append(out, "%s{port=\"%d\"} %.15g\n", queueMetrics[metric][0], endpoints[i]->port, value);
         }
     }
 
-    fclose(file);
-    return value;
+    MetricsBuffer_append(out, "# HELP iec104_log_records_dropped_total Log records lost on a full log ring\n"
+            "# TYPE iec104_log_records_dropped_total counter\n"
+            "iec104_log_records_dropped_total %llu\n",
+            (unsigned long long) __atomic_load_n(&(logger->dropped), __ATOMIC_RELAXED));
+
+    if (capture)
+        MetricsBuffer_append(out, "# HELP iec104_capture_frames_dropped_total APDUs lost on a full capture ring or of connections not captured\n"
+                "# TYPE iec104_capture_frames_dropped_total counter\n"
+                "iec104_capture_frames_dropped_total %llu\n", (unsigned long long) Capture_getDroppedFrames(capture));
 }
 
-#define MAX_ASDU 30
-static CS101_ASDU asdu_buffer[MAX_ASDU];
-static int num_asdu = 0;
-#define MAX_IO 100
-static InformationObject io_buffer[MAX_IO];
-static int num_io = 0;
+/* Seznam společných adres: "1", "1,2,5" nebo rozsah "1-8" (lze kombinovat) */
+static int*
+parseCommonAddresses(const char* config, int* count)
+{
+    char* configCopy = strdup(config);
+    int capacity = 8;
+    int* addresses = (int*) malloc(capacity * sizeof(int));
 
-// Funkce pro vytvoření IO (Information Object) podle typu zprávy
-InformationObject createIO(int messageType, int ioa, float value) {
-    InformationObject io;
-    switch (messageType) {
-        case 1:
-            io = (InformationObject)SinglePointInformation_create(NULL, ioa, true, IEC60870_QUALITY_GOOD);
-            break;
-        case 3:
-            io = (InformationObject)DoublePointInformation_create(NULL, ioa, true, IEC60870_QUALITY_GOOD);
-            break;
-        case 11:
-            io = (InformationObject)MeasuredValueScaled_create(NULL, ioa, 0.5, IEC60870_QUALITY_GOOD);
-            break;
-        case 30:
-            io = (InformationObject)SinglePointWithCP56Time2a_create(NULL, ioa, 2, IEC60870_QUALITY_GOOD, CP56Time2a_createFromMsTimestamp(NULL, Hal_getTimeInMs()));
-            break;
-        case 31:
-            io = (InformationObject)DoublePointWithCP56Time2a_create(NULL, ioa, 2, IEC60870_QUALITY_GOOD, CP56Time2a_createFromMsTimestamp(NULL, Hal_getTimeInMs()));
-            break;
-        case 36:
-            io = (InformationObject)MeasuredValueShortWithCP56Time2a_create(NULL, ioa, 250.12, IEC60870_QUALITY_GOOD, CP56Time2a_createFromMsTimestamp(NULL, Hal_getTimeInMs()));
-            break;
-    }
-    return io;
-}
+    *count = 0;
 
-void readMessageConfig(const char* filename) {
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        perror("Failed to open configuration file");
-        return;
-    }
+    for (char* token = strtok(configCopy, ","); token; token = strtok(NULL, ",")) {
+        int first = atoi(token);
+        char* dash = strchr(token, '-');
+        int last = dash ? atoi(dash + 1) : first;
 
-    char line[256];
-    int messageType;
-    int ioa;
-    float value;
-    bool startReading = false;  // Kontrola, zda máme začít číst konfigurační řádky
-    while (fgets(line, sizeof(line), file)) {
-        if (!startReading) {
-            // Hledáme klíč "MESS="
-            if (strncmp(line, "MESS=", 5) == 0) {
-                startReading = true;  // Nalezen klíč, začneme číst data
-            }
-        } else {
-            // Čtení dat po nalezení klíče
-            if (line[0] == '\0') {
-                // Přeskočí prázdné řádky nebo řádky s komentáři
-                break;
-            }
-            MessageConfig config;
-            if (sscanf(line, "%d;%d;%f", &messageType, &ioa, &value) == 3) {
-                if (ioa > 655535) {
-                    printf("%d is not a valid ioa value", ioa);
-                    continue;
-                }
-                io_buffer[num_io] = createIO(messageType, ioa, value);
-                ++num_io;
+        for (int ca = first; ca <= last; ca++) {
+            if (*count == capacity) {
+                capacity *= 2;
+                addresses = (int*) realloc(addresses, capacity * sizeof(int));
             }
+
+            addresses[(*count)++] = ca;
         }
     }
-    fclose(file);
-}
 
-// Funkce vracející ukazatel na pole struktur
-MessageConfig* getMessageConfigs(int* count) {
-    *count = numMessageConfigs;
-    return messageConfigs;
+    free(configCopy);
+
+    if (*count == 0)
+        addresses[(*count)++] = 1;
+
+    return addresses;
 }
 
+/* Vytvoří slave koncového bodu, jeho frontu a obsluhy povelů (směrované podle společné adresy) */
+static void
+setupEndpoint(StationEndpoint endpoint, const char* ip)
+{
+    CS104_Slave slave = CS104_Slave_create(lowPrioQueueSize, highPrioQueueSize);
+    endpoint->slave = slave;
 
+    endpoint->queue = SlaveQueue_create(slave, lowPrioQueueSize, queuePolicy);
+    if (queueBlockTimeout > 0)
+        endpoint->queue->blockTimeout = (int) queueBlockTimeout;
 
-void sendSpontaneousMessage(CS104_Slave slave, CS101_AppLayerParameters alParams, int multiplier) {
-    for (int i = 0; i < multiplier; i++) {
-        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_SPONTANEOUS, 0, 1, false, false);
-        InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 1001, rand() % 2, IEC60870_QUALITY_GOOD);
-        CS101_ASDU_addInformationObject(asdu, io);
-        InformationObject_destroy(io);
-        CS104_Slave_enqueueASDU(slave, asdu);
-        CS101_ASDU_destroy(asdu);
-    }
+    endpoint->address = ip ? strdup(ip) : NULL;
 
-    printf("Spontaneous messages sent count: %d at %s\n", multiplier, ctime(&nextSpontaneousTime));
-}
+    CS104_Slave_setLocalAddress(slave, ip);
+    CS104_Slave_setLocalPort(slave, endpoint->port);
 
-void configureSpontaneousMessages(const char* config) {
-    char* configCopy = strdup(config);
-    char* token = strtok(configCopy, ";");
-    if (token && atoi(token) == 1) {
-        spontaneousEnabled = true;
-        token = strtok(NULL, ";");
-        minSpontaneousInterval = atoi(token);
-        token = strtok(NULL, ";");
-        maxSpontaneousInterval = atoi(token);
+    /* Set mode to a single redundancy group
+     * NOTE: library has to be compiled with CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP enabled (=1)
+     */
+    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+
+    if (endpoint->number == 1) {
+        /* when you have to tweak the APCI parameters (t0-t3, k, w) you can access them here */
+        CS104_APCIParameters apciParams = CS104_Slave_getConnectionParameters(slave);
+
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "APCI parameters:");
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "  t0: %i", apciParams->t0);
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "  t1: %i", apciParams->t1);
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "  t2: %i", apciParams->t2);
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "  t3: %i", apciParams->t3);
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "  k: %i", apciParams->k);
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "  w: %i", apciParams->w);
     }
-    free(configCopy);
-}
 
-void scheduleNextSpontaneousMessage() {
-    if (!spontaneousEnabled) return;
-    int interval = minSpontaneousInterval + rand() % (maxSpontaneousInterval - minSpontaneousInterval + 1);
-    nextSpontaneousTime = time(NULL) + interval;
+    /* set the callback handler for the clock synchronization command */
+    CS104_Slave_setClockSyncHandler(slave, clockSyncHandler, endpoint);
+
+    /* set the callback handler for the interrogation command */
+    CS104_Slave_setInterrogationHandler(slave, interrogationHandler, endpoint);
+
+    /* set the callback handler for the counter interrogation command */
+    CS104_Slave_setCounterInterrogationHandler(slave, counterInterrogationHandler, endpoint);
+
+    /* set handler for other message types */
+    CS104_Slave_setASDUHandler(slave, asduHandler, endpoint);
+
+    /* set handler to handle connection requests (optional) */
+    CS104_Slave_setConnectionRequestHandler(slave, connectionRequestHandler, NULL);
+
+    /* set handler to track connection events (optional) */
+    CS104_Slave_setConnectionEventHandler(slave, connectionEventHandler, endpoint);
+
+    /* raw messages only for the capture or the debug log */
+    if (capture || (logger->level == LOG_DEBUG))
+        CS104_Slave_setRawMessageHandler(slave, rawMessageHandler, endpoint);
 }
 
-void sendPeriodicMessages(CS104_Slave slave, CS101_AppLayerParameters alParams, int multiplier)
+/* GI odpovědi stanice (celková a skupiny 1-16) pro tabulku db, již vytvořené cache zůstanou */
+static void
+createGICaches(Station station, PointDB db, CS101_AppLayerParameters alParams, GICache* caches)
 {
-    for (int i = 0; i < multiplier; i++) {
-        CS101_ASDU asdu = CS101_ASDU_create(alParams, false, CS101_COT_PERIODIC, 0, 1, false, false);
-        InformationObject io = (InformationObject) SinglePointInformation_create(NULL, 1001, true, IEC60870_QUALITY_GOOD);
-        CS101_ASDU_addInformationObject(asdu, io);
-        InformationObject_destroy(io);
-        CS104_Slave_enqueueASDU(slave, asdu);
-        CS101_ASDU_destroy(asdu);
-    }
+    if (caches[0] == NULL)
+        caches[0] = GICache_create(db, NULL, PointDB_getCount(db), alParams,
+                CS101_COT_INTERROGATED_BY_STATION, station->oa, station->ca);
 
-    printf("Periodic messages sent count: %d\n", multiplier);
-}
+    for (int group = 1; group <= POINT_DB_MAX_GROUPS; group++) {
+        int groupSize;
+        const int32_t* groupPoints = PointDB_getGroupPoints(db, group, &groupSize);
 
-void logMessage(FILE* logFile, const char* message) {
-    if (logFile) {
-        time_t now = time(NULL);  // Nyní korektně deklarováno
-        char* timeStr = ctime(&now);
-        timeStr[strcspn(timeStr, "\n")] = 0; // Odstranění nového řádku z časového řetězce
-        fprintf(logFile, "%s: %s\n", timeStr, message);
-        fflush(logFile); // Zajistí okamžitý zápis do souboru
+        if (caches[group] == NULL)
+            caches[group] = GICache_create(db, groupPoints, groupSize, alParams,
+                    (CS101_CauseOfTransmission) (CS101_COT_INTERROGATED_BY_STATION + group), station->oa, station->ca);
     }
 }
 
-void
-printCP56Time2a(CP56Time2a time)
+/* jeden časovač pro každou periodu, body se stejnou periodou se posílají společně */
+static void
+startPeriodicScans(Station station, CS101_AppLayerParameters alParams, uint64_t startTime)
 {
-    printf("%02i:%02i:%02i %02i/%02i/%04i", CP56Time2a_getHour(time),
-           CP56Time2a_getMinute(time),
-           CP56Time2a_getSecond(time),
-           CP56Time2a_getDayOfMonth(time),
-           CP56Time2a_getMonth(time),
-           CP56Time2a_getYear(time) + 2000);
-}
+    station->periodicScans = PeriodicScan_createAll(station->db, periodicInterval, groupPeriods, alParams,
+            station->oa, station->ca, station->endpoint->queue, &station->periodicScanCount);
 
+    for (int i = 0; i < station->periodicScanCount; i++) {
+        PeriodicScan scan = station->periodicScans[i];
 
+        if ((station->number == 1) && (configDB == NULL))
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Periodic points: %d every %u ms", scan->pointCount, scan->period);
+
+        /* jednorázový časovač, handler ho naplánuje znovu (při plné frontě dřív) */
+        scan->timer = TimerWheel_add(timerWheel, startTime + scan->period, 0, periodicTimerHandler, scan);
+    }
+}
 
-/* Callback handler to log sent or received messages (optional) */
 static void
-rawMessageHandler(void* parameter, IMasterConnection conneciton, uint8_t* msg, int msgSize, bool sent)
+stopPeriodicScans(Station station)
 {
-    if (sent)
-        printf("SEND: ");
-    else
-        printf("RCVD: ");
+    for (int i = 0; i < station->periodicScanCount; i++)
+        TimerWheel_cancel(timerWheel, station->periodicScans[i]->timer);
 
-    int i;
-    for (i = 0; i < msgSize; i++) {
-        printf("%02x ", msg[i]);
-    }
+    PeriodicScan_destroyAll(station->periodicScans, station->periodicScanCount);
 
-    printf("\n");
+    station->periodicScans = NULL;
+    station->periodicScanCount = 0;
 }
 
-static bool
-clockSyncHandler (void* parameter, IMasterConnection connection, CS101_ASDU asdu, CP56Time2a newTime)
+/* Vytvoří GI cache, cyklické skeny, modely a časovače stanice */
+static void
+setupStation(Station station, uint64_t startTime)
 {
-    printf("Process time sync command with time "); printCP56Time2a(newTime); printf("\n");
+    /* get the connection parameters - we need them to create correct ASDUs -
+     * you can also modify the parameters here when default parameters are not to be used */
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(station->endpoint->slave);
 
-    uint64_t newSystemTimeInMs = CP56Time2a_toMsTimestamp(newTime);
+    /* tabulka z obrazu má GI odpovědi už zakódované (pokud sedí adresy a parametry) */
+    for (int group = 0; group <= POINT_DB_MAX_GROUPS; group++) {
+        if (pointImage && (station->db == pointDB))
+            station->giCaches[group] = PointImage_createGICache(pointImage, group, alParams, station->oa, station->ca);
+    }
 
-    /* Set time for ACT_CON message */
-    CP56Time2a_setFromMsTimestamp(newTime, Hal_getTimeInMs());
+    createGICaches(station, station->db, alParams, station->giCaches);
 
-    /* update system time here */
+    startPeriodicScans(station, alParams, startTime);
 
-    return true;
+    if (counterInterval > 0)
+        TimerWheel_add(timerWheel, startTime + counterInterval, counterInterval, counterTimerHandler, station);
+
+    if (loadConfig)
+        station->load = configureLoadGenerator(loadConfig, station);
+
+    /* SPONTANEOUS=1;min;max dá bodům bez modelu výchozí model (toggle / náhodná procházka).
+     * V režimu zátěže dostanou model všechny body a události určuje generátor zátěže. */
+    station->events->rateMultiplier = multiplier;
+    station->events->clock = &(station->clock);
+    int modelCount = EventGenerator_start(station->events, alParams, station->oa, station->ca, (station->load == NULL),
+            (spontaneousEnabled || station->load) ? minSpontaneousInterval : 0, maxSpontaneousInterval);
+
+    if (station->number == 1)
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Points with value model: %d", modelCount);
+
+    if (station->load) {
+        if (station->number == 1)
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Load generator: %.0f %s/s per station, burst %.0f", station->load->rate,
+                    (station->load->unit == LOAD_UNIT_ASDUS) ? "ASDUs" : "events", station->load->bucketSize);
+
+        TimerWheel_add(timerWheel, startTime + 1, 1, loadTimerHandler, station->load);
+    }
 }
 
-static bool
-interrogationHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu, uint8_t qoi)
+/* Nový seznam bodů z IMAGE, nebo z konfigurace, když obraz není; NULL při chybě */
+static PointDB
+loadConfiguredPoints(void)
 {
-    printf("Received interrogation for group %i\n", qoi);
-
-    if (qoi == 22) { /* only handle station interrogation */
+    PointDB db = NULL;
+    Config config = Config_load(configPath, NULL, NULL, NULL);
 
-        CS101_AppLayerParameters alParams = IMasterConnection_getApplicationLayerParameters(connection);
+    if (config == NULL)
+        return NULL;
 
-        IMasterConnection_sendACT_CON(connection, asdu, false);
+    if (Config_get(config, "IMAGE")) {
+        PointImage image = PointImage_open(Config_get(config, "IMAGE"));
 
-        /* The CS101 specification only allows information objects without timestamp in GI responses */
+        if (image) {
+            db = PointImage_getPointDB(image);
+            PointImage_destroy(image);
+        }
+    }
 
-        CS101_ASDU newAsdu1, newAsdu3, newAsdu7, newAsdu11, newAsdu30, newAsdu31, newAsdu36;
+    /* modely hodnot se při reloadu nemění */
+    if ((db == NULL) && (config->errorCount == 0)) {
+        db = PointDB_create();
 
-        /*vytvorit asdu, pro kazdej typ novou asdu (muzes pretypovavat ale nedoporucuju)*/
-        newAsdu1 = CS101_ASDU_create(alParams, true, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
-        newAsdu3 = CS101_ASDU_create(alParams, true, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
-        newAsdu7 = CS101_ASDU_create(alParams, false, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
-        newAsdu11 = CS101_ASDU_create(alParams, true, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
-        newAsdu30 = CS101_ASDU_create(alParams, true, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
-        newAsdu31 = CS101_ASDU_create(alParams, true, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
-        newAsdu36 = CS101_ASDU_create(alParams, true, CS101_COT_INTERROGATED_BY_STATION, 0, 1, false, false);
+        if (db && !Config_loadPoints(config, db, Config_parsePointAttributes, NULL)) {
+            PointDB_destroy(db);
+            db = NULL;
+        }
+    }
 
+    if (config->errorCount > 0) {
+        Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONFIG, "Reload: %d errors in the configuration, keeping the current points", config->errorCount);
+        PointDB_release(db);
+        db = NULL;
+    }
 
-        /*vytvorit ioa*/
-        InformationObject io1 = (InformationObject) SinglePointInformation_create(NULL, 1000, true, IEC60870_QUALITY_GOOD);
-        InformationObject io3 = (InformationObject) DoublePointInformation_create(NULL, 1500, true, IEC60870_QUALITY_GOOD);
-        InformationObject io7 = (InformationObject) BitString32_create(NULL, 659, 0xaaaa);
-        InformationObject io11 = (InformationObject) MeasuredValueScaled_create(NULL, 112, 0.5, IEC60870_QUALITY_GOOD);
-        InformationObject io30 = (InformationObject) SinglePointWithCP56Time2a_create(NULL, 3500, 2, IEC60870_QUALITY_GOOD,CP56Time2a_createFromMsTimestamp(NULL, Hal_getTimeInMs()));
-        InformationObject io31 = (InformationObject) DoublePointWithCP56Time2a_create(NULL, 4000, 2, IEC60870_QUALITY_GOOD,CP56Time2a_createFromMsTimestamp(NULL, Hal_getTimeInMs()));
-        InformationObject io36 = (InformationObject) MeasuredValueShortWithCP56Time2a_create(NULL, 3002, 250.12, IEC60870_QUALITY_GOOD, CP56Time2a_createFromMsTimestamp(NULL, Hal_getTimeInMs()));
+    Config_destroy(config);
 
+    return db;
+}
 
-        /*priradis io do asdu*/
-        CS101_ASDU_addInformationObject(newAsdu1, io1);
-        CS101_ASDU_addInformationObject(newAsdu3, io3);
-        CS101_ASDU_addInformationObject(newAsdu7, io7);
-        CS101_ASDU_addInformationObject(newAsdu11, io11);
-        CS101_ASDU_addInformationObject(newAsdu30, io30);
-        CS101_ASDU_addInformationObject(newAsdu31, io31);
-        CS101_ASDU_addInformationObject(newAsdu36, io36);
+/* Čas změny a velikost konfiguračního souboru, false když soubor nejde přečíst */
+static bool
+readConfigVersion(struct sConfigVersion* version)
+{
+    struct stat fileStat;
 
+    if (stat(configPath, &fileStat) != 0)
+        return false;
 
+    version->modified = fileStat.st_mtime;
+#ifdef _WIN32
+    version->modifiedNs = 0;
+#else
+    version->modifiedNs = fileStat.st_mtim.tv_nsec;
+#endif
+    version->size = fileStat.st_size;
 
+    return true;
+}
 
+/*
+ * Načte znovu seznam bodů a porovná ho s předchozí konfigurací. Změněné hodnoty se zapíšou
+ * do tabulek stanic a pošlou jako spontánní události. Přidané, odebrané nebo jinak změněné
+ * body vyžadují novou tabulku: ta se připraví vedle staré (živé hodnoty zůstanou), ukazatele
+ * se atomicky přepnou a stará tabulka se uvolní, až všechna vlákna dokončí rozpracovaný tick
+ * (RCU). Rozpracovaná GI tak dojede nad starým snímkem a spojení s mastery zůstanou.
+ */
+static void
+reloadConfig(void)
+{
+    uint64_t start = TimerWheel_getMonotonicTime();
 
-        /*odesles*/
-        IMasterConnection_sendASDU(connection, newAsdu1);
-        IMasterConnection_sendASDU(connection, newAsdu3);
-        IMasterConnection_sendASDU(connection, newAsdu7);
-        IMasterConnection_sendASDU(connection, newAsdu11);
-        IMasterConnection_sendASDU(connection, newAsdu30);
-        IMasterConnection_sendASDU(connection, newAsdu31);
-        IMasterConnection_sendASDU(connection, newAsdu36);
+    /* po kill -HUP už změnu souboru znovu nenačítat */
+    readConfigVersion(&configVersion);
 
+    PointDB newConfig = loadConfiguredPoints();
 
-        /*uvolnis misto v pameti*/
-        InformationObject_destroy(io1);
-        InformationObject_destroy(io3);
-        InformationObject_destroy(io7);
-        InformationObject_destroy(io11);
-        InformationObject_destroy(io30);
-        InformationObject_destroy(io31);
-        InformationObject_destroy(io36);
-        CS101_ASDU_destroy(newAsdu1);
-        CS101_ASDU_destroy(newAsdu3);
-        CS101_ASDU_destroy(newAsdu7);
-        CS101_ASDU_destroy(newAsdu11);
-        CS101_ASDU_destroy(newAsdu30);
-        CS101_ASDU_destroy(newAsdu31);
-        CS101_ASDU_destroy(newAsdu36);
+    if (newConfig == NULL)
+        return;
 
-        /*sem jsem něco dopsal*/
+    PointDiff diff;
+    PointDiff_compute(&diff, configDB, newConfig);
 
-    }
-    else {
-        IMasterConnection_sendACT_CON(connection, asdu, true);
+    if (!PointDiff_isStructureChanged(&diff) && (diff.changed == 0)) {
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Reload: no point changes");
+        PointDB_destroy(newConfig);
+        return;
     }
 
-    return true;
-}
+    if (PointDiff_isStructureChanged(&diff)) {
+        PointDB* oldTables = (PointDB*) calloc(stationCount, sizeof(PointDB));
+        GICache* oldCaches = (GICache*) calloc(stationCount * (POINT_DB_MAX_GROUPS + 1), sizeof(GICache));
+        uint64_t now = TimerWheel_getMonotonicTime();
 
-static bool
-asduHandler(void* parameter, IMasterConnection connection, CS101_ASDU asdu)
-{
-    if (CS101_ASDU_getTypeID(asdu) == C_SC_NA_1) {
-        printf("received single command\n");
+        for (int i = 0; i < stationCount; i++) {
+            Station station = stations[i];
+            CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(station->endpoint->slave);
 
-        if  (CS101_ASDU_getCOT(asdu) == CS101_COT_ACTIVATION) {
-            InformationObject io = CS101_ASDU_getElement(asdu, 0);
+            /* čekající události mají indexy staré tabulky */
+            EventGenerator_flush(station->events, station->endpoint->queue);
 
-            if (io) {
-                if (InformationObject_getObjectAddress(io) == 5000) {
-                    SingleCommand sc = (SingleCommand) io;
+            PointDB table = PointDiff_mergeTable(station->db, newConfig);
 
-                    printf("IOA: %i switch to %i\n", InformationObject_getObjectAddress(io),
-                           SingleCommand_getState(sc));
+            GICache caches[POINT_DB_MAX_GROUPS + 1] = { NULL };
+            createGICaches(station, table, alParams, caches);
 
-                    CS101_ASDU_setCOT(asdu, CS101_COT_ACTIVATION_CON);
-                }
-                else
-                    CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_IOA);
+            oldTables[i] = station->db;
 
-                InformationObject_destroy(io);
-            }
-            else {
-                printf("ERROR: message has no valid information object\n");
-                return true;
+            for (int group = 0; group <= POINT_DB_MAX_GROUPS; group++) {
+                oldCaches[i * (POINT_DB_MAX_GROUPS + 1) + group] = station->giCaches[group];
+                __atomic_store_n(&(station->giCaches[group]), caches[group], __ATOMIC_RELEASE);
             }
+
+            __atomic_store_n(&(station->db), table, __ATOMIC_RELEASE);
+
+            /* časovače a modely běží v tomto vlákně, přepnou se hned */
+            EventGenerator_setPointDB(station->events, table);
+            stopPeriodicScans(station);
+            startPeriodicScans(station, alParams, now);
         }
-        else
-            CS101_ASDU_setCOT(asdu, CS101_COT_UNKNOWN_COT);
 
-        IMasterConnection_sendASDU(connection, asdu);
+        /* obsluhy ve vláknech stanic mohou ještě pracovat se starou tabulkou; nedokončené
+         * GI odpovědi drží vlastní reference, staré cache a tabulky uvolní poslední z nich */
+        StationPool_synchronize(stationPool);
 
-        return true;
-    }
+        for (int i = 0; i < stationCount; i++) {
+            for (int group = 0; group <= POINT_DB_MAX_GROUPS; group++)
+                GICache_release(oldCaches[i * (POINT_DB_MAX_GROUPS + 1) + group]);
 
-    return false;
-}
+            PointDB_release(oldTables[i]);
+        }
 
-static bool
-connectionRequestHandler(void* parameter, const char* ipAddress)
-{
-    printf("New connection request from %s\n", ipAddress);
+        free(oldCaches);
+        free(oldTables);
 
-#if 0
-    if (strcmp(ipAddress, "127.0.0.1") == 0) {
-        printf("Accept connection\n");
-        return true;
+        pointDB = stations[0]->db;
     }
-    else {
-        printf("Deny connection\n");
-        return false;
-    }
-#else
-    return true;
-#endif
+
+    int updated = 0;
+
+    for (int i = 0; i < stationCount; i++)
+        updated += PointDiff_applyValues(stations[i]->db, configDB, newConfig, stations[i]->events);
+
+    PointDB_destroy(configDB);
+    configDB = newConfig;
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Reload: %d added, %d removed, %d modified, %d values changed (%d spontaneous events) in %llu ms",
+            diff.added, diff.removed, diff.modified, diff.changed, updated,
+            (unsigned long long) (TimerWheel_getMonotonicTime() - start));
 }
 
+/* Sleduje čas změny (s nanosekundami) a velikost konfiguračního souboru */
 static void
-connectionEventHandler(void* parameter, IMasterConnection con, CS104_PeerConnectionEvent event)
+configWatchTimerHandler(void* parameter, uint64_t expiry)
 {
-    if (event == CS104_CON_EVENT_CONNECTION_OPENED) {
-        printf("Connection opened (%p)\n", con);
-    }
-    else if (event == CS104_CON_EVENT_CONNECTION_CLOSED) {
-        printf("Connection closed (%p)\n", con);
-    }
-    else if (event == CS104_CON_EVENT_ACTIVATED) {
-        printf("Connection activated (%p)\n", con);
-    }
-    else if (event == CS104_CON_EVENT_DEACTIVATED) {
-        printf("Connection deactivated (%p)\n", con);
+    struct sConfigVersion version;
+
+    if (readConfigVersion(&version) && ((version.modified != configVersion.modified) ||
+            (version.modifiedNs != configVersion.modifiedNs) || (version.size != configVersion.size))) {
+        configVersion = version;
+        reloadRequested = 1;
     }
 }
 
@@ -403,21 +1578,69 @@ main(int argc, char** argv)
 {
     /* Add Ctrl-C handler */
     signal(SIGINT, sigint_handler);
+#ifdef SIGHUP
+    signal(SIGHUP, sighup_handler);
+#endif
+
+    logger = Logger_create(LOGGER_DEFAULT_CAPACITY, stdout);
+
+    Metrics_init();
+
+    timerWheel = TimerWheel_create(TimerWheel_getMonotonicTime());
+
+    pointDB = PointDB_create();
+
+    if (pointDB == NULL)
+        return -1;
+
+    eventGenerator = EventGenerator_create(pointDB, timerWheel);
+
+    /* nejdřív jen nastavení, seznam MESS= se čte, až když není obraz bodů */
+    Config config = Config_load(configPath, NULL, NULL, NULL);
+
+    if (config == NULL)
+        return -1;
+
+    // Binární obraz bodů vytvořený nástrojem pointc: IMAGE=cesta, nahrazuje seznam MESS=
+    char* imagePath = readConfigValue(config, "IMAGE");
+    if (imagePath) {
+        uint64_t imageStart = TimerWheel_getMonotonicTime();
+
+        pointImage = PointImage_open(imagePath);
 
-    lastSentTime = time(NULL);
-    char* ip = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "IP config");
-    char* interface = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "Interface");
-    char* portStr = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "Port");
-    char* originatorAddressStr = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "Originator Address");
-    char* commonAddressStr = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "Common Address");
-    char* logs = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "LOGS");
-    char* spontaneousConfig = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "SPONTANEOUS");
-    char* multiplierStr = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "MULTI");
-    readMessageConfig("/home/klient/Desktop/KONFIGSERVER104.txt");
-    for (int i = 0; i < numMessageConfigs; i++) {
-        printf("Message Type: %d, IOA: %d, Value: %.2f\n",
-               messageConfigs[i].messageType, messageConfigs[i].ioa, messageConfigs[i].value);
+        if (pointImage) {
+            EventGenerator_destroy(eventGenerator);
+            PointDB_destroy(pointDB);
+
+            pointDB = PointImage_getPointDB(pointImage);
+            eventGenerator = EventGenerator_create(pointDB, timerWheel);
+            int imageModelCount = PointImage_addModels(pointImage, eventGenerator);
+
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Loaded %d points and %d value models from %s in %llu ms", PointDB_getCount(pointDB),
+                    imageModelCount, imagePath, (unsigned long long) (TimerWheel_getMonotonicTime() - imageStart));
+        }
+        else
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Using the MESS= list of the configuration");
+
+        free(imagePath);
+    }
+
+    if (pointImage == NULL) {
+        if (!Config_loadPoints(config, pointDB, Config_parsePointAttributes, eventGenerator))
+            return -1;
+
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Loaded %d points from %d lines in %.1f ms (%d errors)", config->pointCount, config->lineCount,
+                config->loadTime, config->errorCount);
     }
+
+    char* ip = readConfigValue(config, "IP config");
+    char* interface = readConfigValue(config, "Interface");
+    char* portStr = readConfigValue(config, "Port");
+    char* originatorAddressStr = readConfigValue(config, "Originator Address");
+    char* commonAddressStr = readConfigValue(config, "Common Address");
+    char* logs = readConfigValue(config, "LOGS");
+    char* spontaneousConfig = readConfigValue(config, "SPONTANEOUS");
+    char* multiplierStr = readConfigValue(config, "MULTI");
     FILE* logFile = NULL;
 
     if (!ip || !interface || !portStr || !originatorAddressStr || !commonAddressStr) {
@@ -432,130 +1655,317 @@ main(int argc, char** argv)
             perror("Failed to open log file");
             return -1;
         }
+        Logger_setFile(logger, logFile);
+    }
+    free(logs);
+
+    // Úroveň výpisů: LOGLEVEL=debug|info|warning|error (debug vypisuje i cykly a surové zprávy)
+    char* logLevelStr = readConfigValue(config, "LOGLEVEL");
+    if (logLevelStr) {
+        LogLevel level;
+        if (Logger_parseLevel(logLevelStr, &level))
+            Logger_setLevel(logger, level);
+        else
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONFIG, "Unknown log level \"%s\", using info", logLevelStr);
+        free(logLevelStr);
+    }
+
+    // Nejvýše LOGRATE záznamů za sekundu v každé kategorii, další se jen počítají (0 = bez omezení)
+    char* logRateStr = readConfigValue(config, "LOGRATE");
+    if (logRateStr) {
+        Logger_setRateLimit(logger, (uint32_t) atoi(logRateStr));
+        free(logRateStr);
+    }
+
+    Logger_start(logger);
+
+    // Záznam provozu pro Wireshark: CAPTURE=soubor[;velikost souboru v MB[;počet souborů[;počet současně zaznamenaných spojení]]]
+    // např. CAPTURE=/home/klient/Desktop/capture.pcap;100;5 (capture.pcap, capture.pcap.1 ... capture.pcap.4)
+    char* captureStr = readConfigValue(config, "CAPTURE");
+    if (captureStr) {
+        char* path = strtok(captureStr, ";");
+        char* token = strtok(NULL, ";");
+        uint64_t maxFileSize = (uint64_t) ((token ? atof(token) : 100) * 1024 * 1024);
+        token = strtok(NULL, ";");
+        int maxFiles = token ? atoi(token) : 5;
+        token = strtok(NULL, ";");
+        int maxConnections = token ? atoi(token) : CAPTURE_DEFAULT_CONNECTIONS;
+
+        capture = Capture_create(path, maxFileSize, maxFiles, maxConnections, CAPTURE_DEFAULT_RING_SIZE);
+
+        if (Capture_start(capture))
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Capturing APDUs to %s", path);
+        else {
+            Logger_log(logger, LOG_ERROR, LOG_CATEGORY_SERVER, "Cannot create capture file %s", path);
+            Capture_destroy(capture);
+            capture = NULL;
+        }
+
+        free(captureStr);
     }
 
+    // Metriky ve formátu Prometheus přes HTTP: METRICS=port (127.0.0.1), METRICS=ip:port nebo METRICS=unix:cesta
+    char* metricsAddress = readConfigValue(config, "METRICS");
+
     if (spontaneousConfig) {
         configureSpontaneousMessages(spontaneousConfig);
         free(spontaneousConfig);
-        scheduleNextSpontaneousMessage();
     }
 
     if (multiplierStr) {
         multiplier = atoi(multiplierStr);
         free(multiplierStr);
+        if (multiplier < 1) multiplier = 1;
     }
 
     // Načtení konfiguračních hodnot
-    char* periodStr = readConfigValue("/home/klient/Desktop/KONFIGSERVER104.txt", "PERIOD");
-    int periodicInterval = periodStr ? atoi(periodStr) : 20;  // Defaultní perioda je 20 sekund, pokud není specifikováno jinak
+    // Časy v sekundách, lze i desetinné (0.1 = 100 ms)
+    char* periodStr = readConfigValue(config, "PERIOD");
+    if (periodStr) periodicInterval = Config_parseSeconds(periodStr);
     free(periodStr);
 
+    char* groupPeriodStr = readConfigValue(config, "GROUPPERIOD");
+    if (groupPeriodStr) {
+        configureGroupPeriods(groupPeriodStr, groupPeriods);
+        free(groupPeriodStr);
+    }
+
+    // Perioda přičítání čítačů (0 = čítače stojí)
+    char* counterPeriodStr = readConfigValue(config, "COUNTERS");
+    if (counterPeriodStr) counterInterval = Config_parseSeconds(counterPeriodStr);
+    free(counterPeriodStr);
+
+    // Doba platnosti výběru u povelů select/execute (bod může mít vlastní: sbo=s)
+    char* selectTimeoutStr = readConfigValue(config, "SELECTTIMEOUT");
+    if (selectTimeoutStr) selectTimeout = Config_parseSeconds(selectTimeoutStr);
+    free(selectTimeoutStr);
+
+    // Rychlost hodin stanic: CLOCKSPEED=60 -> minuta času stanice za sekundu (i modely událostí běží 60x rychleji)
+    char* clockSpeedStr = readConfigValue(config, "CLOCKSPEED");
+    if (clockSpeedStr && atof(clockSpeedStr) > 0) clockSpeed = atof(clockSpeedStr);
+    free(clockSpeedStr);
+
+    if (clockSpeed != 1.0)
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_CONFIG, "Station clocks run %g times faster than real time", clockSpeed);
+
+    loadConfig = readConfigValue(config, "LOAD");
+    replayConfig = readConfigValue(config, "REPLAY");
+
     int port = atoi(portStr);
     int originatorAddress = atoi(originatorAddressStr);
-    int commonAddress = atoi(commonAddressStr);
+    int commonAddressCount;
+    int* commonAddresses = parseCommonAddresses(commonAddressStr, &commonAddressCount);
 
     //vytvorit asdu a naplnit se io
 
-    printf("IP Address: %s\n", ip);
-    printf("Interface: %s\n", interface);
-    printf("Port: %d\n", port);
-    printf("Originator Address: %d\n", originatorAddress);
-    printf("Common Address: %d\n", commonAddress);
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "IP Address: %s", ip);
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Interface: %s", interface);
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Port: %d", port);
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Originator Address: %d", originatorAddress);
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Common Address: %s", commonAddressStr);
+
+    // Velikosti front: QUEUE=nízká priorita;vysoká priorita;oldest|newest|block[;timeout v sekundách]
+    char* queueStr = readConfigValue(config, "QUEUE");
+    if (queueStr) {
+        char* token = strtok(queueStr, ";");
+        if (token && atoi(token) > 0) lowPrioQueueSize = atoi(token);
+        token = strtok(NULL, ";");
+        if (token && atoi(token) > 0) highPrioQueueSize = atoi(token);
+        token = strtok(NULL, ";");
+        if (token && !SlaveQueue_parsePolicy(token, &queuePolicy))
+            Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONFIG, "Unknown queue policy \"%s\", using oldest", token);
+        token = strtok(NULL, ";");
+        if (token) queueBlockTimeout = Config_parseSeconds(token);
+        free(queueStr);
+    }
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Queue sizes: low priority %d, high priority %d", lowPrioQueueSize, highPrioQueueSize);
 
-    CS104_Slave slave = CS104_Slave_create(10, 10);
-    CS104_Slave_setLocalAddress(slave, ip);
-    CS104_Slave_setLocalPort(slave, port);
+    // Více koncových bodů v jednom procesu: STATIONS=počet[;krok portu[;krok společné adresy]]
+    // Koncový bod i má port Port + i * krok portu a obsluhuje všechny adresy z Common Address + i * krok adresy.
+    int portStep = 1;
+    int caStep = 1;
 
-    /* Set mode to a single redundancy group
-     * NOTE: library has to be compiled with CONFIG_CS104_SUPPORT_SERVER_MODE_SINGLE_REDUNDANCY_GROUP enabled (=1)
-     */
-    CS104_Slave_setServerMode(slave, CS104_MODE_SINGLE_REDUNDANCY_GROUP);
+    char* stationsStr = readConfigValue(config, "STATIONS");
+    if (stationsStr) {
+        char* token = strtok(stationsStr, ";");
+        if (token && atoi(token) > 0) endpointCount = atoi(token);
+        token = strtok(NULL, ";");
+        if (token) portStep = atoi(token);
+        token = strtok(NULL, ";");
+        if (token) caStep = atoi(token);
+        free(stationsStr);
+    }
 
-    /* get the connection parameters - we need them to create correct ASDUs -
-     * you can also modify the parameters here when default parameters are not to be used */
-    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+    // Počet pracovních vláken obsluhujících spojení všech stanic
+    char* threadsStr = readConfigValue(config, "THREADS");
+    int threadCount = threadsStr ? atoi(threadsStr) : 1;
+    free(threadsStr);
 
-    /* when you have to tweak the APCI parameters (t0-t3, k, w) you can access them here */
-    CS104_APCIParameters apciParams = CS104_Slave_getConnectionParameters(slave);
+    Config_destroy(config);
 
-    printf("APCI parameters:\n");
-    printf("  t0: %i\n", apciParams->t0);
-    printf("  t1: %i\n", apciParams->t1);
-    printf("  t2: %i\n", apciParams->t2);
-    printf("  t3: %i\n", apciParams->t3);
-    printf("  k: %i\n", apciParams->k);
-    printf("  w: %i\n", apciParams->w);
+    endpoints = (StationEndpoint*) calloc(endpointCount, sizeof(StationEndpoint));
+    stations = (Station*) calloc(endpointCount * commonAddressCount, sizeof(Station));
 
-    /* set the callback handler for the clock synchronization command */
-    CS104_Slave_setClockSyncHandler(slave, clockSyncHandler, NULL);
+    /* nejprve tabulky a modely všech stanic (kopie), teprve potom spuštění modelů */
+    for (int i = 0; i < endpointCount; i++) {
+        StationEndpoint endpoint = StationEndpoint_create(i + 1, port + i * portStep);
 
-    /* set the callback handler for the interrogation command */
-    CS104_Slave_setInterrogationHandler(slave, interrogationHandler, NULL);
+        setupEndpoint(endpoint, ip);
 
-    /* set handler for other message types */
-    CS104_Slave_setASDUHandler(slave, asduHandler, NULL);
+        for (int k = 0; k < commonAddressCount; k++) {
+            Station station = Station_create(stationCount + 1, originatorAddress, commonAddresses[k] + i * caStep);
 
-    /* set handler to handle connection requests (optional) */
-    CS104_Slave_setConnectionRequestHandler(slave, connectionRequestHandler, NULL);
+            if (!StationEndpoint_addStation(endpoint, station)) {
+                Logger_log(logger, LOG_WARNING, LOG_CATEGORY_CONFIG, "Common address %d is used twice on port %d, ignored", station->ca, endpoint->port);
+                Station_destroy(station);
+                continue;
+            }
 
-    /* set handler to track connection events (optional) */
-    CS104_Slave_setConnectionEventHandler(slave, connectionEventHandler, NULL);
+            if (stationCount == 0) {
+                station->db = pointDB;
+                station->events = eventGenerator;
+            }
+            else {
+                station->db = PointDB_clone(pointDB);
+                station->events = EventGenerator_create(station->db, timerWheel);
+                EventGenerator_copyModels(station->events, eventGenerator);
+            }
+
+            station->operations = OperationList_create(endpoint->timers, operationCompleted, station);
+
+            StationClock_init(&(station->clock), clockSpeed);
+
+            stations[stationCount++] = station;
+        }
+
+        endpoints[i] = endpoint;
+    }
+
+    free(commonAddresses);
+
+    uint64_t startTime = TimerWheel_getMonotonicTime();
 
-    /* uncomment to log messages */
-    //CS104_Slave_setRawMessageHandler(slave, rawMessageHandler, NULL);
+    for (int i = 0; i < stationCount; i++)
+        setupStation(stations[i], startTime);
 
-    CS104_Slave_start(slave);
+    if (replayConfig)
+        replay = startReplay(replayConfig, startTime);
 
-    logMessage(logFile, "Server start attempted");
+    /* mapování teď patří tabulce bodů */
+    PointImage_destroy(pointImage);
+    pointImage = NULL;
+
+    if (stationCount > 1)
+        Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Stations: %d on %d endpoints (ports %d..%d, common addresses %d..%d), worker threads: %d",
+                stationCount, endpointCount, endpoints[0]->port, endpoints[endpointCount - 1]->port,
+                stations[0]->ca, stations[stationCount - 1]->ca, threadCount);
+
+    TimerWheel_add(timerWheel, startTime + 1000, 1000, statisticsTimerHandler, NULL);
+
+    /* změna konfiguračního souboru nebo kill -HUP načte znovu seznam bodů */
+    readConfigVersion(&configVersion);
+
+    configDB = PointDB_clone(pointDB);
+
+    TimerWheel_add(timerWheel, startTime + 1000, 1000, configWatchTimerHandler, NULL);
+
+    stationPool = StationPool_create(endpoints, endpointCount, threadCount);
+
+    /* pokračování odpovědí na dotazy (a metriky okna k) */
+    StationPool_setTickHandler(stationPool, endpointTickHandler, NULL);
+
+    if (metricsAddress) {
+        metricsServer = MetricsServer_create(metricsAddress, collectServerMetrics, NULL);
+
+        if (metricsServer) {
+            MetricsServer_start(metricsServer);
+            Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Metrics on %s", metricsAddress);
+        }
+        else
+            Logger_log(logger, LOG_ERROR, LOG_CATEGORY_SERVER, "Cannot listen for metrics on %s", metricsAddress);
+
+        free(metricsAddress);
+    }
+
+    if (StationPool_start(stationPool) > 0) {
+        for (int i = 0; i < endpointCount; i++) {
+            if (!CS104_Slave_isRunning(endpoints[i]->slave))
+                Logger_log(logger, LOG_ERROR, LOG_CATEGORY_SERVER, "Endpoint %d: failed to start the server on port %d",
+                        endpoints[i]->number, endpoints[i]->port);
+        }
+    }
+
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Server start attempted");
 
     int16_t scaledValue = 0;
 
-    printf("Server will send messages every %d seconds with multiplier: %d.\n", periodicInterval, multiplier);
-    lastSentTime = time(NULL);  // Nastavit čas při startu
+    Logger_log(logger, LOG_INFO, LOG_CATEGORY_SERVER, "Server is running with multiplier: %d.", multiplier);
 
     while (running) {
-        time_t currentTime = time(NULL);
-
-        // Odesílání periodických zpráv
-        if (difftime(currentTime, lastSentTime) >= periodicInterval) {
-            printf("Sending periodic messages...\n");
-            for (int i = 0; i < numMessageConfigs; ++i) {
-//                MessageConfig msg = messageConfigs[i];
-////                CS101_ASDU newAsdu = createAsdu(msg.messageType, msg.COT, msg.value, originatorAddress, commonAddress, ioa, alParams);
-//                for (int j = 0; j < multiplier; j++) {
-//                    CS104_Slave_enqueueASDU(slave, newAsdu);
-//                }
-            }
-//                InformationObject_destroy(io1);
-//                InformationObject_destroy(io2);
-//                InformationObject_destroy(io3);
-//
-//                CS101_ASDU_destroy(newAsdu1);
-//                CS101_ASDU_destroy(newAsdu3);
-//                CS101_ASDU_destroy(newAsdu7);
-//            }
-            lastSentTime = currentTime;  // Update the last sent time
+        uint64_t now = TimerWheel_getMonotonicTime();
+
+        // Periodické, spontánní zprávy a čítače podle časovačů
+        TimerWheel_advance(timerWheel, now);
+
+        if (reloadRequested) {
+            reloadRequested = 0;
+            reloadConfig();
         }
 
-        // Odesílání spontánních zpráv
-        if (spontaneousEnabled && currentTime >= nextSpontaneousTime) {
-            for (int i = 0; i < multiplier; i++) {
-                sendSpontaneousMessage(slave, alParams, multiplier);  // Now correctly passing all required parameters
-            }
-            scheduleNextSpontaneousMessage();  // Schedule the next spontaneous message
+        // Změny z modelů hodnot jako spontánní ASDU, seskupené podle typu;
+        // při plné frontě (politika block) zůstanou čekat a slučují se s dalšími změnami
+        bool blocked = false;
+
+        for (int i = 0; i < stationCount; i++) {
+            SlaveQueue queue = stations[i]->endpoint->queue;
+
+            if (SlaveQueue_isBlocked(queue) && !SlaveQueue_transmit(queue))
+                blocked = true;
+            else
+                EventGenerator_flush(stations[i]->events, queue);
         }
 
-        Thread_sleep (4000);
+        // Spánek do další události, nejvýše 100 ms kvůli Ctrl-C
+        uint64_t nextExpiry = TimerWheel_getNextExpiry(timerWheel);
+        uint64_t sleepTime = (nextExpiry - now < 100) ? (nextExpiry - now) : 100;
+
+        if (blocked && (sleepTime > SLAVE_QUEUE_RETRY_INTERVAL))
+            sleepTime = SLAVE_QUEUE_RETRY_INTERVAL;
+
+        Thread_sleep((int) sleepTime);
     }
 
+    MetricsServer_destroy(metricsServer);
+
+    StationPool_destroy(stationPool);
+
+    logLatencySummary();
+
+    Capture_destroy(capture);
+    Replay_destroy(replay);
+
+    for (int i = 0; i < endpointCount; i++)
+        StationEndpoint_destroy(endpoints[i]);
+
+    free(endpoints);
+    free(stations);
+    PointDB_destroy(configDB);
+    free(loadConfig);
+    free(replayConfig);
+    free(replayStations);
+    free(replayPending);
+    TimerWheel_destroy(timerWheel);
+
     /*CS104_Slave_stop(slave);*/
     free(ip);
     free(interface);
     free(portStr);
     free(originatorAddressStr);
     free(commonAddressStr);
+
+    Logger_destroy(logger);
     return 0;
     /*exit_program:
-    CS104_Slave_destroy(slave);
     Thread_sleep(500)*/
 }
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "slave_queue.h"
+#include "timer_wheel.h"
+#include "metrics.h"
+
+#define DEFAULT_BLOCK_TIMEOUT 5000
+
+static const char* policyNames[] = { "oldest", "newest", "block" };
+
+SlaveQueue
+SlaveQueue_create(CS104_Slave slave, int size, QueuePolicy policy)
+{
+    SlaveQueue self = (SlaveQueue) calloc(1, sizeof(struct sSlaveQueue));
+
+    if (self) {
+        self->slave = slave;
+        self->size = size;
+        self->policy = policy;
+        self->blockTimeout = DEFAULT_BLOCK_TIMEOUT;
+    }
+
+    return self;
+}
+
+static void
+dropHeld(SlaveQueue self)
+{
+    CS101_ASDU_destroy(self->held[self->heldFirst]);
+
+    self->heldFirst++;
+    self->heldCount--;
+}
+
+void
+SlaveQueue_destroy(SlaveQueue self)
+{
+    if (self) {
+        while (self->heldCount > 0)
+            dropHeld(self);
+
+        free(self->held);
+        free(self);
+    }
+}
+
+bool
+SlaveQueue_parsePolicy(const char* name, QueuePolicy* policy)
+{
+    int i;
+    for (i = 0; i < (int) (sizeof(policyNames) / sizeof(policyNames[0])); i++) {
+        if (strcmp(name, policyNames[i]) == 0) {
+            *policy = (QueuePolicy) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+int
+SlaveQueue_getFill(SlaveQueue self)
+{
+    return CS104_Slave_getNumberOfQueueEntries(self->slave, NULL);
+}
+
+bool
+SlaveQueue_enqueue(SlaveQueue self, CS101_ASDU asdu)
+{
+    if (self->heldFirst + self->heldCount == self->heldCapacity) {
+        if (self->heldFirst > 0) {
+            memmove(self->held, self->held + self->heldFirst, self->heldCount * sizeof(CS101_ASDU));
+            self->heldFirst = 0;
+        }
+        else {
+            int newCapacity = (self->heldCapacity > 0) ? (self->heldCapacity * 2) : 64;
+
+            CS101_ASDU* held = (CS101_ASDU*) realloc(self->held, newCapacity * sizeof(CS101_ASDU));
+
+            if (held == NULL) {
+                self->dropped++;
+                return false;
+            }
+
+            self->held = held;
+            self->heldCapacity = newCapacity;
+        }
+    }
+
+    CS101_ASDU copy = CS101_ASDU_clone(asdu, NULL);
+
+    if (copy == NULL) {
+        self->dropped++;
+        return false;
+    }
+
+    self->held[self->heldFirst + self->heldCount] = copy;
+    self->heldCount++;
+
+    return true;
+}
+
+/* block policy: false while the held ASDUs still have to wait */
+static bool
+waitForSpace(SlaveQueue self)
+{
+    uint64_t now = TimerWheel_getMonotonicTime();
+
+    if (!self->blocked) {
+        self->blocked = true;
+        self->progressTime = now;
+        self->checkTime = now;
+    }
+
+    self->blockedTime += now - self->checkTime;
+    self->checkTime = now;
+
+    if (now - self->progressTime < (uint64_t) self->blockTimeout)
+        return false;
+
+    /* the master does not drain the queue */
+    self->dropped += self->heldCount;
+
+    while (self->heldCount > 0)
+        dropHeld(self);
+
+    return true;
+}
+
+bool
+SlaveQueue_transmit(SlaveQueue self)
+{
+    int fill = SlaveQueue_getFill(self);
+
+    while (self->heldCount > 0) {
+        CS101_ASDU asdu = self->held[self->heldFirst];
+
+        if (fill >= self->size) {
+            if (self->policy == QUEUE_POLICY_DROP_NEWEST) {
+                self->dropped++;
+                dropHeld(self);
+                continue;
+            }
+            else if (self->policy == QUEUE_POLICY_BLOCK) {
+                if (!waitForSpace(self))
+                    return false;
+
+                break;
+            }
+            else {
+                /* the library overwrites the oldest entry */
+                self->dropped++;
+                fill--;
+            }
+        }
+
+        CS104_Slave_enqueueASDU(self->slave, asdu);
+        self->enqueued++;
+
+        Metrics_countASDU(CS101_ASDU_getTypeID(asdu), CS101_ASDU_getCOT(asdu), CS101_ASDU_getNumberOfElements(asdu));
+
+        if (fill + 1 > self->highWaterMark)
+            self->highWaterMark = fill + 1;
+
+        fill++;
+
+        if (self->blocked)
+            self->progressTime = TimerWheel_getMonotonicTime();
+
+        dropHeld(self);
+    }
+
+    if (self->blocked) {
+        self->blockedTime += TimerWheel_getMonotonicTime() - self->checkTime;
+        self->blocked = false;
+    }
+
+    self->heldFirst = 0;
+
+    return true;
+}
@@ -0,0 +1,118 @@
+#ifndef SLAVE_QUEUE_H_
+#define SLAVE_QUEUE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+
+/*
+ * Accounting and overflow policy for the low priority (spontaneous and
+ * cyclic) queue of a CS104_Slave.
+ *
+ * All ASDUs enqueued by the server go through the SlaveQueue. A producer
+ * packs its ASDUs while it holds the point table lock; SlaveQueue_enqueue
+ * only copies them. SlaveQueue_transmit, called after the lock was
+ * released, hands them to the library queue. When the library queue is
+ * full, the library itself would overwrite the oldest entry; the policy
+ * decides instead:
+ *
+ *   drop oldest  enqueue anyway, the library drops the oldest entry
+ *   drop newest  don't enqueue the new ASDU
+ *   block        keep the ASDUs that don't fit until the master drained
+ *                entries (when no entry was drained for blockTimeout ms,
+ *                drop them)
+ *
+ * The producer never waits: while ASDUs are held back (SlaveQueue_isBlocked)
+ * it reschedules its work and calls SlaveQueue_transmit again later. The
+ * worker thread that drains the library queue may need the point table
+ * lock, so waiting with the lock held would never end.
+ *
+ * Dropped ASDUs and the high-water mark of the queue are counted, so the
+ * queue size can be chosen for the largest burst that must not be lost.
+ * Not thread safe: all enqueues have to come from one thread.
+ */
+
+/* ms a blocked producer waits before it tries again */
+#define SLAVE_QUEUE_RETRY_INTERVAL 5
+
+typedef enum {
+    QUEUE_POLICY_DROP_OLDEST,
+    QUEUE_POLICY_DROP_NEWEST,
+    QUEUE_POLICY_BLOCK
+} QueuePolicy;
+
+typedef struct sSlaveQueue* SlaveQueue;
+
+struct sSlaveQueue {
+    CS104_Slave slave;
+    int size;               /* capacity of the library queue */
+    QueuePolicy policy;
+    int blockTimeout;       /* ms */
+
+    /* ASDUs not handed to the library yet, oldest first */
+    CS101_ASDU* held;
+    int heldFirst;
+    int heldCount;
+    int heldCapacity;
+
+    bool blocked;           /* the library queue was full at the last transmit (block policy) */
+    uint64_t progressTime;  /* ms, monotonic time the library queue last accepted an ASDU while blocked */
+    uint64_t checkTime;     /* ms, monotonic time of the last transmit while blocked */
+
+    /* statistics */
+    uint64_t enqueued;
+    uint64_t dropped;
+    uint64_t blockedTime;   /* ms ASDUs were held back */
+    int highWaterMark;
+};
+
+/**
+ * \param size the maxLowPrioQueueSize the slave was created with
+ */
+SlaveQueue
+SlaveQueue_create(CS104_Slave slave, int size, QueuePolicy policy);
+
+void
+SlaveQueue_destroy(SlaveQueue self);
+
+/**
+ * \return true when name is a policy name (oldest, newest, block)
+ */
+bool
+SlaveQueue_parsePolicy(const char* name, QueuePolicy* policy);
+
+/**
+ * \return number of ASDUs waiting in the library queue
+ */
+int
+SlaveQueue_getFill(SlaveQueue self);
+
+/**
+ * Add an ASDU to the ASDUs waiting for SlaveQueue_transmit. The ASDU is
+ * copied, so the caller may hold the point table lock.
+ *
+ * \return false when out of memory (the ASDU is dropped)
+ */
+bool
+SlaveQueue_enqueue(SlaveQueue self, CS101_ASDU asdu);
+
+/**
+ * Hand the waiting ASDUs to the library queue according to the overflow
+ * policy. Call without holding a point table lock.
+ *
+ * \return false when ASDUs are still held back (block policy)
+ */
+bool
+SlaveQueue_transmit(SlaveQueue self);
+
+/**
+ * \return true when ASDUs are held back because the library queue is full
+ */
+static inline bool
+SlaveQueue_isBlocked(SlaveQueue self)
+{
+    return self->blocked;
+}
+
+#endif /* SLAVE_QUEUE_H_ */
@@ -0,0 +1,354 @@
+#include <stdlib.h>
+
+#include "station.h"
+
+/* ms a worker sleeps between two rounds while one of its endpoints has an open connection */
+#define STATION_POOL_POLL_INTERVAL 1
+
+/* longest sleep of a worker whose endpoints only accept connections (ms) */
+#define STATION_POOL_IDLE_INTERVAL 20
+
+Station
+Station_create(int number, int oa, int ca)
+{
+    Station self = (Station) calloc(1, sizeof(struct sStation));
+
+    if (self) {
+        self->number = number;
+        self->oa = oa;
+        self->ca = ca;
+    }
+
+    return self;
+}
+
+void
+Station_destroy(Station self)
+{
+    if (self) {
+        int group;
+        for (group = 0; group <= POINT_DB_MAX_GROUPS; group++)
+            GICache_release(self->giCaches[group]);
+
+        PeriodicScan_destroyAll(self->periodicScans, self->periodicScanCount);
+        LoadGenerator_destroy(self->load);
+        EventGenerator_destroy(self->events);
+        OperationList_destroy(self->operations);
+        SelectTable_destroy(self->selections);
+        PointDB_release(self->db);
+
+        free(self);
+    }
+}
+
+StationEndpoint
+StationEndpoint_create(int number, int port)
+{
+    StationEndpoint self = (StationEndpoint) calloc(1, sizeof(struct sStationEndpoint));
+
+    if (self) {
+        self->number = number;
+        self->port = port;
+        self->router = CARouter_create();
+        self->timers = TimerWheel_create(TimerWheel_getMonotonicTime());
+    }
+
+    return self;
+}
+
+bool
+StationEndpoint_addStation(StationEndpoint self, Station station)
+{
+    if (self->stationCount == self->stationCapacity) {
+        int newCapacity = (self->stationCapacity > 0) ? (self->stationCapacity * 2) : 4;
+
+        Station* stations = (Station*) realloc(self->stations, newCapacity * sizeof(Station));
+
+        if (stations == NULL)
+            return false;
+
+        self->stations = stations;
+        self->stationCapacity = newCapacity;
+    }
+
+    if (station->selections == NULL) {
+        station->selections = SelectTable_create(self->timers);
+
+        if (station->selections == NULL)
+            return false;
+    }
+
+    if (!CARouter_add(self->router, station->ca, station))
+        return false;
+
+    station->endpoint = self;
+    self->stations[self->stationCount++] = station;
+
+    return true;
+}
+
+void
+StationEndpoint_addConnection(StationEndpoint self, IMasterConnection connection)
+{
+    if (self->connectionCount == self->connectionCapacity) {
+        int newCapacity = (self->connectionCapacity > 0) ? (self->connectionCapacity * 2) : 4;
+
+        StationConnection* connections = (StationConnection*) realloc(self->connections,
+                newCapacity * sizeof(StationConnection));
+
+        if (connections == NULL)
+            return;
+
+        self->connections = connections;
+        self->connectionCapacity = newCapacity;
+    }
+
+    self->connections[self->connectionCount].connection = connection;
+    self->connections[self->connectionCount].stalled = false;
+    self->connections[self->connectionCount].responses = NULL;
+    self->connectionCount++;
+}
+
+static void
+freeResponses(StationConnection* connection)
+{
+    while (connection->responses)
+        StationConnection_removeResponse(connection);
+}
+
+bool
+StationEndpoint_removeConnection(StationEndpoint self, IMasterConnection connection)
+{
+    int i;
+    for (i = 0; i < self->connectionCount; i++) {
+        if (self->connections[i].connection == connection) {
+            freeResponses(&(self->connections[i]));
+
+            self->connections[i] = self->connections[--self->connectionCount];
+            return true;
+        }
+    }
+
+    return false;
+}
+
+StationConnection*
+StationEndpoint_getConnection(StationEndpoint self, IMasterConnection connection)
+{
+    int i;
+    for (i = 0; i < self->connectionCount; i++) {
+        if (self->connections[i].connection == connection)
+            return &(self->connections[i]);
+    }
+
+    return NULL;
+}
+
+void
+StationConnection_addResponse(StationConnection* self, PendingResponse response)
+{
+    PendingResponse* last = &(self->responses);
+
+    while (*last)
+        last = &((*last)->next);
+
+    response->next = NULL;
+    *last = response;
+}
+
+void
+StationConnection_removeResponse(StationConnection* self)
+{
+    PendingResponse response = self->responses;
+
+    if (response) {
+        self->responses = response->next;
+
+        GICache_release(response->cache);
+        PointDB_release(response->db);
+        free(response);
+    }
+}
+
+void
+StationEndpoint_destroy(StationEndpoint self)
+{
+    if (self) {
+        int i;
+        for (i = 0; i < self->stationCount; i++)
+            Station_destroy(self->stations[i]);
+
+        SlaveQueue_destroy(self->queue);
+
+        if (self->slave)
+            CS104_Slave_destroy(self->slave);
+
+        for (i = 0; i < self->connectionCount; i++)
+            freeResponses(&(self->connections[i]));
+
+        CARouter_destroy(self->router);
+        TimerWheel_destroy(self->timers);
+        free(self->address);
+        free(self->stations);
+        free(self->connections);
+        free(self);
+    }
+}
+
+typedef struct {
+    StationPool pool;
+    int index;
+} Worker;
+
+static void*
+workerThread(void* parameter)
+{
+    Worker* worker = (Worker*) parameter;
+    StationPool self = worker->pool;
+
+    while (self->running) {
+        uint64_t nextExpiry = UINT64_MAX;
+        bool connected = false;
+
+        int i;
+        for (i = worker->index; i < self->endpointCount; i += self->threadCount) {
+            StationEndpoint endpoint = self->endpoints[i];
+
+            CS104_Slave_tick(endpoint->slave);
+
+            TimerWheel_advance(endpoint->timers, TimerWheel_getMonotonicTime());
+
+            if (self->tickHandler)
+                self->tickHandler(self->tickParameter, endpoint);
+
+            uint64_t expiry = TimerWheel_getNextExpiry(endpoint->timers);
+
+            if (expiry < nextExpiry)
+                nextExpiry = expiry;
+
+            if (CS104_Slave_getOpenConnections(endpoint->slave) > 0)
+                connected = true;
+        }
+
+        /* end of the round: a waiting StationPool_synchronize may continue */
+        if (__atomic_exchange_n(&(self->syncRequests[worker->index]), false, __ATOMIC_ACQ_REL))
+            Semaphore_post(self->syncDone);
+
+        uint64_t now = TimerWheel_getMonotonicTime();
+        uint64_t sleepTime = connected ? STATION_POOL_POLL_INTERVAL : STATION_POOL_IDLE_INTERVAL;
+
+        if (nextExpiry <= now)
+            sleepTime = 0;
+        else if (nextExpiry - now < sleepTime)
+            sleepTime = nextExpiry - now;
+
+        if (sleepTime > 0)
+            Thread_sleep((int) sleepTime);
+    }
+
+    free(worker);
+
+    return NULL;
+}
+
+StationPool
+StationPool_create(StationEndpoint* endpoints, int endpointCount, int threadCount)
+{
+    StationPool self = (StationPool) calloc(1, sizeof(struct sStationPool));
+
+    if (self) {
+        if (threadCount < 1)
+            threadCount = 1;
+        if (threadCount > endpointCount)
+            threadCount = (endpointCount > 0) ? endpointCount : 1;
+
+        self->endpoints = endpoints;
+        self->endpointCount = endpointCount;
+        self->threadCount = threadCount;
+        self->threads = (Thread*) calloc(threadCount, sizeof(Thread));
+        self->syncRequests = (bool*) calloc(threadCount, sizeof(bool));
+        self->syncDone = Semaphore_create(0);
+    }
+
+    return self;
+}
+
+void
+StationPool_setTickHandler(StationPool self, StationPool_TickHandler handler, void* parameter)
+{
+    self->tickHandler = handler;
+    self->tickParameter = parameter;
+}
+
+int
+StationPool_start(StationPool self)
+{
+    int failed = 0;
+    int i;
+
+    for (i = 0; i < self->endpointCount; i++) {
+        CS104_Slave_startThreadless(self->endpoints[i]->slave);
+
+        if (!CS104_Slave_isRunning(self->endpoints[i]->slave))
+            failed++;
+    }
+
+    self->running = true;
+
+    for (i = 0; i < self->threadCount; i++) {
+        Worker* worker = (Worker*) malloc(sizeof(Worker));
+        worker->pool = self;
+        worker->index = i;
+
+        self->threads[i] = Thread_create(workerThread, worker, false);
+        Thread_start(self->threads[i]);
+    }
+
+    return failed;
+}
+
+void
+StationPool_synchronize(StationPool self)
+{
+    if (!self->running)
+        return;
+
+    int i;
+    for (i = 0; i < self->threadCount; i++)
+        __atomic_store_n(&(self->syncRequests[i]), true, __ATOMIC_RELEASE);
+
+    /* every worker posts once, after the round it is in */
+    for (i = 0; i < self->threadCount; i++)
+        Semaphore_wait(self->syncDone);
+}
+
+void
+StationPool_stop(StationPool self)
+{
+    int i;
+
+    if (self->running) {
+        self->running = false;
+
+        for (i = 0; i < self->threadCount; i++) {
+            Thread_destroy(self->threads[i]);
+            self->threads[i] = NULL;
+        }
+
+        for (i = 0; i < self->endpointCount; i++)
+            CS104_Slave_stopThreadless(self->endpoints[i]->slave);
+    }
+}
+
+void
+StationPool_destroy(StationPool self)
+{
+    if (self) {
+        StationPool_stop(self);
+
+        free(self->threads);
+        free(self->syncRequests);
+        Semaphore_destroy(self->syncDone);
+        free(self);
+    }
+}
@@ -0,0 +1,260 @@
+#ifndef STATION_H_
+#define STATION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cs104_slave.h"
+#include "hal_thread.h"
+#include "point_db.h"
+#include "gi_cache.h"
+#include "slave_queue.h"
+#include "event_generator.h"
+#include "load_generator.h"
+#include "periodic.h"
+#include "ca_router.h"
+#include "timer_wheel.h"
+#include "select_table.h"
+#include "operation.h"
+#include "station_clock.h"
+
+/*
+ * One emulated controlled station: a common address (CA) with its own point
+ * table, and the objects producing its data.
+ *
+ * Several stations can sit behind one TCP endpoint (a CS104_Slave). The
+ * endpoint routes received ASDUs to the station by their CA and fans
+ * broadcast requests out to all of its stations.
+ *
+ * Many endpoints can run in one process. The timers of all stations
+ * (cyclic scans, value models, load generator) share the timer wheel of the
+ * main thread. The slaves run in threadless mode and are driven by a
+ * StationPool with a fixed number of worker threads, so the number of OS
+ * threads does not grow with the number of stations. A worker whose
+ * endpoints have no open connection sleeps until the next timer of its
+ * endpoints; the threadless slave does not expose its sockets, so open
+ * connections are polled every ms.
+ *
+ * Everything a received command touches (select state and its timeouts)
+ * belongs to the endpoint and is only used by its worker thread.
+ */
+
+typedef struct sStation* Station;
+typedef struct sStationEndpoint* StationEndpoint;
+
+/*
+ * Interrogation response (GI or counter interrogation) of a connection.
+ *
+ * A response of many ASDUs does not fit into the send window (k) and the
+ * send queue of the connection. When an ASDU is refused, the response keeps
+ * its position and continues in a later tick once the connection is ready
+ * again; the ACT_TERM follows the last ASDU. Responses of a connection are
+ * sent one after another in the order the activations were received.
+ *
+ * The response holds references to the GI cache and the point table it
+ * started with, so a reload that replaces them in the meantime does not
+ * change (or free) what the rest of the response is sent from. A counter
+ * interrogation is sent from a copy of the frozen readings.
+ */
+typedef struct sPendingResponse* PendingResponse;
+
+struct sPendingResponse {
+    Station station;
+    bool isCounter;                 /* counter interrogation, else (group) interrogation */
+    uint8_t qualifier;              /* QOI or QCC */
+    bool confirmed;                 /* ACT_CON sent */
+    GICache cache;                  /* GI: the response taken with the ACT_CON (one reference) */
+    PointDB db;                     /* table of the cache, counter interrogation: frozen readings copied with the ACT_CON */
+    int frame;                      /* next ASDU of the response */
+    int point;                      /* counter interrogation: next point of the copy */
+
+    struct sCS101_StaticASDU asdu;  /* copy of the activation for ACT_CON and ACT_TERM */
+    uint64_t received;              /* ns, monotonic time the activation was received */
+
+    PendingResponse next;
+};
+
+typedef struct {
+    IMasterConnection connection;
+    bool stalled;           /* send window was full at the last check */
+
+    PendingResponse responses;      /* not completely sent, oldest first */
+} StationConnection;
+
+struct sStation {
+    int number;             /* 1..N over all endpoints */
+    int oa;
+    int ca;
+
+    StationEndpoint endpoint;
+    PointDB db;
+
+    /* [0] station interrogation, [1..16] group 1..16 */
+    GICache giCaches[POINT_DB_MAX_GROUPS + 1];
+
+    EventGenerator events;
+    LoadGenerator load;     /* NULL when not in load generator mode */
+
+    /* time tags of the station, set by clock synchronization */
+    struct sStationClock clock;
+
+    PeriodicScan* periodicScans;
+    int periodicScanCount;
+
+    SelectTable selections;     /* created by StationEndpoint_addStation */
+    OperationList operations;   /* executed commands waiting for their operating time */
+};
+
+Station
+Station_create(int number, int oa, int ca);
+
+/**
+ * Destroy the station and everything it owns.
+ */
+void
+Station_destroy(Station self);
+
+struct sStationEndpoint {
+    int number;             /* 1..N */
+    char* address;          /* local IP address the slave is bound to */
+    int port;
+
+    CS104_Slave slave;
+    SlaveQueue queue;       /* shared by all stations of the endpoint */
+
+    CARouter router;        /* CA -> Station */
+
+    Station* stations;
+    int stationCount;
+    int stationCapacity;
+
+    /* activated master connections, only used by the worker thread of the endpoint */
+    StationConnection* connections;
+    int connectionCount;
+    int connectionCapacity;
+
+    uint64_t lastTick;      /* us, worker thread */
+
+    /* select timeouts, advanced by the worker thread after every tick */
+    TimerWheel timers;
+};
+
+StationEndpoint
+StationEndpoint_create(int number, int port);
+
+/**
+ * Add a station to the endpoint, the endpoint takes ownership.
+ *
+ * \return false when the common address is already served by the endpoint
+ */
+bool
+StationEndpoint_addStation(StationEndpoint self, Station station);
+
+/**
+ * \return the station with the common address, NULL when the address is unknown
+ */
+static inline Station
+StationEndpoint_getStation(StationEndpoint self, int ca)
+{
+    return (Station) CARouter_lookup(self->router, ca);
+}
+
+/**
+ * Track an activated connection (call from the connection event handler).
+ */
+void
+StationEndpoint_addConnection(StationEndpoint self, IMasterConnection connection);
+
+/**
+ * \return false when the connection was not tracked
+ */
+bool
+StationEndpoint_removeConnection(StationEndpoint self, IMasterConnection connection);
+
+/**
+ * \return the tracked connection, NULL when the connection is not activated
+ */
+StationConnection*
+StationEndpoint_getConnection(StationEndpoint self, IMasterConnection connection);
+
+/**
+ * \brief Queue a response behind the pending responses of the connection
+ */
+void
+StationConnection_addResponse(StationConnection* self, PendingResponse response);
+
+/**
+ * \brief Remove the oldest response of the connection (completely sent)
+ */
+void
+StationConnection_removeResponse(StationConnection* self);
+
+/**
+ * Destroy the endpoint and its stations (the slave has to be stopped).
+ */
+void
+StationEndpoint_destroy(StationEndpoint self);
+
+typedef struct sStationPool* StationPool;
+
+/**
+ * Called by the worker thread after every tick of an endpoint.
+ */
+typedef void (*StationPool_TickHandler)(void* parameter, StationEndpoint endpoint);
+
+struct sStationPool {
+    StationEndpoint* endpoints;
+    int endpointCount;
+
+    StationPool_TickHandler tickHandler;
+    void* tickParameter;
+
+    Thread* threads;
+    int threadCount;
+
+    /* StationPool_synchronize: set per worker, cleared and posted at the end of its round */
+    bool* syncRequests;
+    Semaphore syncDone;
+
+    bool running;
+};
+
+/**
+ * \param threadCount number of worker threads, every worker serves
+ *        every threadCount-th endpoint
+ */
+StationPool
+StationPool_create(StationEndpoint* endpoints, int endpointCount, int threadCount);
+
+/**
+ * Set a handler called after every endpoint tick (before StationPool_start).
+ */
+void
+StationPool_setTickHandler(StationPool self, StationPool_TickHandler handler, void* parameter);
+
+/**
+ * Start all slaves in threadless mode and the worker threads.
+ *
+ * \return number of slaves that could not be started (e.g. port in use),
+ *         see CS104_Slave_isRunning
+ */
+int
+StationPool_start(StationPool self);
+
+/**
+ * Wait until every worker completed the round it is in (RCU grace period).
+ *
+ * Handlers run inside the rounds of the workers. After a pointer a handler
+ * reads (point table, GI cache) was replaced, the old object can be freed
+ * once this returns.
+ */
+void
+StationPool_synchronize(StationPool self);
+
+void
+StationPool_stop(StationPool self);
+
+void
+StationPool_destroy(StationPool self);
+
+#endif /* STATION_H_ */
@@ -0,0 +1,40 @@
+#include "station_clock.h"
+#include "timer_wheel.h"
+#include "hal_time.h"
+
+void
+StationClock_init(StationClock self, double speed)
+{
+    self->start = TimerWheel_getMonotonicTime();
+    self->origin = (int64_t) Hal_getTimeInMs();
+    self->speed = (speed > 0.0) ? speed : 1.0;
+}
+
+static int64_t
+getElapsed(StationClock self, uint64_t monotonic)
+{
+    /* timers of a batch can have expired a little before the clock was started */
+    int64_t elapsed = (int64_t) (monotonic - self->start);
+
+    return (int64_t) ((double) elapsed * self->speed);
+}
+
+uint64_t
+StationClock_getTime(StationClock self, uint64_t monotonic)
+{
+    return (uint64_t) (__atomic_load_n(&(self->origin), __ATOMIC_RELAXED) + getElapsed(self, monotonic));
+}
+
+uint64_t
+StationClock_now(StationClock self)
+{
+    return StationClock_getTime(self, TimerWheel_getMonotonicTime());
+}
+
+void
+StationClock_setTime(StationClock self, uint64_t time)
+{
+    int64_t origin = (int64_t) time - getElapsed(self, TimerWheel_getMonotonicTime());
+
+    __atomic_store_n(&(self->origin), origin, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,68 @@
+#ifndef STATION_CLOCK_H_
+#define STATION_CLOCK_H_
+
+#include <stdint.h>
+
+/*
+ * Virtual clock of a station.
+ *
+ * The time tags of a station (events, command results, frozen counters)
+ * are read from its own clock instead of the system time. The clock starts
+ * at the system time and runs speed times faster than real time:
+ *
+ *   time = origin + (monotonic - start) * speed
+ *
+ * A clock synchronization command moves the origin, so every station keeps
+ * the time of its master without touching the clock of the host. With
+ * CLOCKSPEED=60 a scenario of 24 hours runs in 24 minutes and its events
+ * carry the time tags of the whole day.
+ *
+ * The clock is set by the worker thread of the endpoint and read by all
+ * threads. Only the origin changes after the start, it is accessed
+ * atomically.
+ */
+
+typedef struct sStationClock* StationClock;
+
+struct sStationClock {
+    uint64_t start;     /* ms, monotonic time the speed was set */
+    int64_t origin;     /* ms since 1970, station time at start */
+    double speed;       /* station seconds per real second */
+};
+
+/**
+ * \brief Start the clock at the system time
+ *
+ * \param speed factor of the station time to real time, 1 = real time
+ */
+void
+StationClock_init(StationClock self, double speed);
+
+/**
+ * \brief Convert a monotonic time to station time
+ *
+ * Lets a batch of timers (or events) take their time tags from the time
+ * the batch was started at, without reading the system clock per object.
+ *
+ * \param monotonic ms, like TimerWheel_getMonotonicTime
+ *
+ * \return ms since 1970
+ */
+uint64_t
+StationClock_getTime(StationClock self, uint64_t monotonic);
+
+/**
+ * \return the current station time in ms since 1970
+ */
+uint64_t
+StationClock_now(StationClock self);
+
+/**
+ * \brief Set the station time (clock synchronization), the speed is kept
+ *
+ * \param time ms since 1970
+ */
+void
+StationClock_setTime(StationClock self, uint64_t time);
+
+#endif /* STATION_CLOCK_H_ */
@@ -0,0 +1,35 @@
+#ifndef CHECK_H_
+#define CHECK_H_
+
+#include <stdio.h>
+
+/*
+ * Minimal assertions of the check programs. A failed check is reported
+ * with its location and counted; the program continues and returns
+ * CHECK_RESULT from main, non zero when any check failed.
+ */
+
+static int checkFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            checkFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+    do { \
+        long long checkActual = (long long) (actual); \
+        long long checkExpected = (long long) (expected); \
+        if (checkActual != checkExpected) { \
+            printf("%s:%d: check failed: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, \
+                    checkActual, checkExpected); \
+            checkFailures++; \
+        } \
+    } while (0)
+
+#define CHECK_RESULT (checkFailures ? 1 : 0)
+
+#endif /* CHECK_H_ */
@@ -0,0 +1,359 @@
+/*
+ * ASDU packer: the SQ=0/SQ=1 decision at ASDU_PACKER_MIN_SEQUENCE, full
+ * ASDUs, sequences broken by gaps and type switches, the object limit,
+ * aborting from the send handler and continuing after it.
+ */
+
+#include <stdlib.h>
+
+#include "asdu_packer.h"
+#include "check.h"
+
+#define MAX_ASDUS 64
+#define MAX_OBJECTS 1024
+
+typedef struct {
+    TypeID type;
+    bool isSequence;
+    int count;
+    int payloadSize;
+    int firstObject;            /* position of the first object in Sent.ioas */
+} SentASDU;
+
+typedef struct {
+    SentASDU asdus[MAX_ASDUS];
+    int asduCount;
+
+    int ioas[MAX_OBJECTS];      /* of all sent objects, in order */
+    int objectCount;
+
+    int abortAfter;             /* refuse the ASDU after this many, -1 = never */
+} Sent;
+
+static bool
+recordASDU(void* parameter, CS101_ASDU asdu)
+{
+    Sent* sent = (Sent*) parameter;
+
+    if ((sent->abortAfter != -1) && (sent->asduCount >= sent->abortAfter))
+        return false;
+
+    if (sent->asduCount == MAX_ASDUS)
+        return false;
+
+    SentASDU* record = &(sent->asdus[sent->asduCount++]);
+
+    record->type = CS101_ASDU_getTypeID(asdu);
+    record->isSequence = CS101_ASDU_isSequence(asdu);
+    record->count = CS101_ASDU_getNumberOfElements(asdu);
+    record->payloadSize = CS101_ASDU_getPayloadSize(asdu);
+    record->firstObject = sent->objectCount;
+
+    for (int i = 0; (i < record->count) && (sent->objectCount < MAX_OBJECTS); i++) {
+        InformationObject io = CS101_ASDU_getElement(asdu, i);
+
+        sent->ioas[sent->objectCount++] = InformationObject_getObjectAddress(io);
+
+        InformationObject_destroy(io);
+    }
+
+    return true;
+}
+
+/* encoded size of the value part of an object */
+static int
+getObjectSize(TypeID type)
+{
+    switch (type) {
+    case M_SP_NA_1:
+        return 1;
+    case M_ME_NB_1:
+        return 3;
+    case M_ME_NC_1:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+typedef struct {
+    CS104_Slave slave;
+    CS101_AppLayerParameters alParams;
+    PointDB db;
+    Sent sent;
+    struct sASDUPacker packer;
+} Fixture;
+
+static void
+initFixture(Fixture* fixture)
+{
+    /* the packer is used with the default parameters of the server */
+    fixture->slave = CS104_Slave_create(10, 10);
+    fixture->alParams = CS104_Slave_getAppLayerParameters(fixture->slave);
+    fixture->db = PointDB_create();
+    fixture->sent.asduCount = 0;
+    fixture->sent.objectCount = 0;
+    fixture->sent.abortAfter = -1;
+
+    ASDUPacker_init(&(fixture->packer), fixture->alParams, CS101_COT_INTERROGATED_BY_STATION, 0, 1, recordASDU,
+            &(fixture->sent));
+}
+
+static void
+addRun(Fixture* fixture, TypeID type, int firstIOA, int count)
+{
+    for (int i = 0; i < count; i++)
+        PointDB_add(fixture->db, type, firstIOA + i, 0);
+}
+
+/* sort, pack all points in table order and check that every object was sent once, in order */
+static bool
+pack(Fixture* fixture)
+{
+    PointDB db = fixture->db;
+
+    PointDB_sort(db);
+
+    bool success = ASDUPacker_addPoints(&(fixture->packer), db, NULL, PointDB_getCount(db), false) &&
+            ASDUPacker_flush(&(fixture->packer));
+
+    if (success) {
+        CHECK_EQUAL(fixture->sent.objectCount, PointDB_getCount(db));
+
+        for (int i = 0; i < fixture->sent.objectCount; i++)
+            CHECK_EQUAL(fixture->sent.ioas[i], db->ioa[i]);
+    }
+
+    return success;
+}
+
+/* ASDUs are encoded as announced; an ASDU continued by the next one (same type and SQ,
+ * for sequences the next IOA) has no room for another object */
+static void
+checkFull(Fixture* fixture)
+{
+    CS101_AppLayerParameters alParams = fixture->alParams;
+    int headerSize = alParams->sizeOfTypeId + alParams->sizeOfVSQ + alParams->sizeOfCOT + alParams->sizeOfCA;
+    int payloadLimit = alParams->maxSizeOfASDU - headerSize;
+
+    for (int i = 0; i < fixture->sent.asduCount; i++) {
+        SentASDU* asdu = &(fixture->sent.asdus[i]);
+        int objectSize = getObjectSize(asdu->type);
+
+        int expectedSize = asdu->isSequence ? (alParams->sizeOfIOA + asdu->count * objectSize) :
+                (asdu->count * (alParams->sizeOfIOA + objectSize));
+
+        CHECK_EQUAL(asdu->payloadSize, expectedSize);
+        CHECK(asdu->payloadSize <= payloadLimit);
+        CHECK(asdu->count <= ASDU_PACKER_MAX_OBJECTS);
+
+        if (i + 1 == fixture->sent.asduCount)
+            break;
+
+        SentASDU* next = &(fixture->sent.asdus[i + 1]);
+
+        bool continued = (next->type == asdu->type) && (next->isSequence == asdu->isSequence);
+
+        if (continued && asdu->isSequence)
+            continued = (fixture->sent.ioas[next->firstObject] == fixture->sent.ioas[next->firstObject - 1] + 1);
+
+        if (continued) {
+            int nextSize = asdu->isSequence ? objectSize : (alParams->sizeOfIOA + objectSize);
+
+            CHECK((asdu->count == ASDU_PACKER_MAX_OBJECTS) || (asdu->payloadSize + nextSize > payloadLimit));
+        }
+    }
+}
+
+static void
+destroyFixture(Fixture* fixture)
+{
+    PointDB_destroy(fixture->db);
+    CS104_Slave_destroy(fixture->slave);
+}
+
+/* a run of ASDU_PACKER_MIN_SEQUENCE IOAs is a sequence, one less is not */
+static void
+checkSequenceThreshold(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    addRun(&fixture, M_SP_NA_1, 100, ASDU_PACKER_MIN_SEQUENCE - 1);
+    addRun(&fixture, M_SP_NA_1, 200, ASDU_PACKER_MIN_SEQUENCE);
+
+    CHECK(pack(&fixture));
+    CHECK_EQUAL(fixture.sent.asduCount, 2);
+    CHECK(!fixture.sent.asdus[0].isSequence);
+    CHECK_EQUAL(fixture.sent.asdus[0].count, ASDU_PACKER_MIN_SEQUENCE - 1);
+    CHECK(fixture.sent.asdus[1].isSequence);
+    CHECK_EQUAL(fixture.sent.asdus[1].count, ASDU_PACKER_MIN_SEQUENCE);
+
+    destroyFixture(&fixture);
+}
+
+/* long runs fill sequence ASDUs up to the size or the object limit */
+static void
+checkFullSequences(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    addRun(&fixture, M_SP_NA_1, 1000, 300);
+    addRun(&fixture, M_ME_NC_1, 5000, 150);
+
+    CHECK(pack(&fixture));
+    checkFull(&fixture);
+
+    for (int i = 0; i < fixture.sent.asduCount; i++)
+        CHECK(fixture.sent.asdus[i].isSequence);
+
+    /* 127 single points (the VSQ limit), 48 floats (the size limit) per ASDU */
+    CHECK_EQUAL(fixture.sent.asduCount, 3 + 4);
+    CHECK_EQUAL(fixture.sent.asdus[0].count, ASDU_PACKER_MAX_OBJECTS);
+
+    destroyFixture(&fixture);
+}
+
+/* sparse points fill SQ=0 ASDUs */
+static void
+checkFullSparse(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    for (int i = 0; i < 100; i++)
+        PointDB_add(fixture.db, M_ME_NC_1, 10 + i * 2, 0);
+
+    CHECK(pack(&fixture));
+    checkFull(&fixture);
+
+    for (int i = 0; i < fixture.sent.asduCount; i++)
+        CHECK(!fixture.sent.asdus[i].isSequence);
+
+    /* 30 objects of 8 bytes per ASDU */
+    CHECK_EQUAL(fixture.sent.asduCount, 4);
+
+    destroyFixture(&fixture);
+}
+
+/* a gap, a type switch or the end of a run closes the ASDU */
+static void
+checkBreaks(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    /* 1..10 and 12..20: two sequences */
+    addRun(&fixture, M_SP_NA_1, 1, 10);
+    addRun(&fixture, M_SP_NA_1, 12, 9);
+
+    /* 21..30 continue the IOAs with another type, followed by sparse points of that type */
+    addRun(&fixture, M_ME_NB_1, 21, 10);
+    PointDB_add(fixture.db, M_ME_NB_1, 100, 0);
+    PointDB_add(fixture.db, M_ME_NB_1, 200, 0);
+
+    CHECK(pack(&fixture));
+    checkFull(&fixture);
+
+    CHECK_EQUAL(fixture.sent.asduCount, 4);
+
+    SentASDU* asdus = fixture.sent.asdus;
+
+    CHECK(asdus[0].isSequence && (asdus[0].type == M_SP_NA_1) && (asdus[0].count == 10));
+    CHECK(asdus[1].isSequence && (asdus[1].type == M_SP_NA_1) && (asdus[1].count == 9));
+    CHECK(asdus[2].isSequence && (asdus[2].type == M_ME_NB_1) && (asdus[2].count == 10));
+    CHECK(!asdus[3].isSequence && (asdus[3].type == M_ME_NB_1) && (asdus[3].count == 2));
+
+    destroyFixture(&fixture);
+}
+
+static void
+checkMaxObjects(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    fixture.packer.maxObjects = 10;
+
+    addRun(&fixture, M_SP_NA_1, 1, 25);
+
+    CHECK(pack(&fixture));
+    CHECK_EQUAL(fixture.sent.asduCount, 3);
+    CHECK_EQUAL(fixture.sent.asdus[0].count, 10);
+    CHECK_EQUAL(fixture.sent.asdus[1].count, 10);
+    CHECK_EQUAL(fixture.sent.asdus[2].count, 5);
+
+    destroyFixture(&fixture);
+}
+
+/* a refused ASDU stops packing, nothing is sent afterwards */
+static void
+checkAbort(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    fixture.sent.abortAfter = 1;
+
+    addRun(&fixture, M_SP_NA_1, 1, 300);
+
+    CHECK(!pack(&fixture));
+    CHECK_EQUAL(fixture.sent.asduCount, 1);
+    CHECK(!ASDUPacker_flush(&fixture.packer));
+    CHECK(!ASDUPacker_addPoint(&fixture.packer, fixture.db, 0, M_SP_NA_1));
+    CHECK_EQUAL(fixture.packer.asduCount, 1);
+
+    destroyFixture(&fixture);
+}
+
+/* a refused response continues with the first object not sent, every object is sent once */
+static void
+checkResume(void)
+{
+    Fixture fixture;
+    initFixture(&fixture);
+
+    addRun(&fixture, M_SP_NA_1, 1, 300);
+    addRun(&fixture, M_ME_NC_1, 1000, 40);
+    PointDB_sort(fixture.db);
+
+    int count = PointDB_getCount(fixture.db);
+    int position = 0;
+    int parts = 0;
+
+    while (position < count) {
+        fixture.sent.abortAfter = fixture.sent.asduCount + 1;
+
+        ASDUPacker_init(&(fixture.packer), fixture.alParams, CS101_COT_INTERROGATED_BY_STATION, 0, 1, recordASDU,
+                &(fixture.sent));
+
+        ASDUPacker_addPointRange(&(fixture.packer), fixture.db, NULL, position, count, false);
+        ASDUPacker_flush(&(fixture.packer));
+
+        position += fixture.packer.objectCount;
+        parts++;
+    }
+
+    CHECK_EQUAL(parts, fixture.sent.asduCount);
+    CHECK_EQUAL(fixture.sent.objectCount, count);
+
+    for (int i = 0; i < fixture.sent.objectCount; i++)
+        CHECK_EQUAL(fixture.sent.ioas[i], fixture.db->ioa[i]);
+
+    destroyFixture(&fixture);
+}
+
+int
+main(int argc, char** argv)
+{
+    checkSequenceThreshold();
+    checkFullSequences();
+    checkFullSparse();
+    checkBreaks();
+    checkMaxObjects();
+    checkAbort();
+    checkResume();
+
+    return CHECK_RESULT;
+}
@@ -0,0 +1,183 @@
+/*
+ * Point table: insert and lookup with strided IOA plans, rejected inserts,
+ * the index after sorting, group and counter indexes, change tracking.
+ */
+
+#include <stdlib.h>
+
+#include "point_db.h"
+#include "ioa_hash.h"
+#include "check.h"
+
+/* longest acceptable probe chain of the IOA index at 50 % load */
+#define MAX_PROBES 64
+
+static const int strides[] = { 1, 7, 256, 1024, 65536 };
+
+/* slots visited to find the IOA, 0 when it is not in the index */
+static int
+countProbes(PointDB db, int ioa)
+{
+    uint32_t slot = IOAHash_get(ioa) & db->indexMask;
+    int probes = 1;
+
+    while (db->index[slot] != -1) {
+        if (db->ioa[db->index[slot]] == ioa)
+            return probes;
+
+        slot = (slot + 1) & db->indexMask;
+        probes++;
+    }
+
+    return 0;
+}
+
+static void
+checkStride(int stride, int count)
+{
+    PointDB db = PointDB_create();
+
+    /* alternate the types so sorting moves every point */
+    for (int i = 0; i < count; i++) {
+        TypeID type = (i % 3 == 0) ? M_ME_NC_1 : ((i % 3 == 1) ? M_SP_NA_1 : M_IT_NA_1);
+
+        CHECK_EQUAL(PointDB_add(db, type, 1 + i * stride, (float) i), i);
+    }
+
+    CHECK_EQUAL(PointDB_getCount(db), count);
+
+    int maxProbes = 0;
+
+    for (int i = 0; i < count; i++) {
+        int ioa = 1 + i * stride;
+
+        CHECK_EQUAL(PointDB_lookup(db, ioa), i);
+
+        int probes = countProbes(db, ioa);
+
+        if (probes > maxProbes)
+            maxProbes = probes;
+    }
+
+    if (maxProbes > MAX_PROBES)
+        printf("stride %d: probe chain of %d slots\n", stride, maxProbes);
+
+    CHECK(maxProbes <= MAX_PROBES);
+
+    /* addresses between the points */
+    if (stride > 1) {
+        CHECK_EQUAL(PointDB_lookup(db, 2), -1);
+        CHECK_EQUAL(PointDB_lookup(db, count * stride), -1);
+    }
+
+    CHECK_EQUAL(PointDB_lookup(db, 1 + count * stride), -1);
+
+    /* duplicates, invalid addresses and types are rejected */
+    CHECK_EQUAL(PointDB_add(db, M_SP_NA_1, 1, 0), -1);
+    CHECK_EQUAL(PointDB_add(db, M_SP_NA_1, 1 + (count - 1) * stride, 0), -1);
+    CHECK_EQUAL(PointDB_add(db, M_SP_NA_1, 0, 0), -1);
+    CHECK_EQUAL(PointDB_add(db, M_SP_NA_1, POINT_DB_MAX_IOA + 1, 0), -1);
+    CHECK_EQUAL(PointDB_add(db, C_IC_NA_1, 2, 0), -1);
+    CHECK_EQUAL(PointDB_getCount(db), count);
+
+    CHECK(PointDB_sort(db));
+
+    /* ordered by type, then IOA; the index follows the new positions */
+    for (int i = 0; i < count; i++) {
+        int ioa = 1 + i * stride;
+        int idx = PointDB_lookup(db, ioa);
+
+        CHECK(idx >= 0);
+
+        if (idx >= 0)
+            CHECK_EQUAL(db->ioa[idx], ioa);
+    }
+
+    for (int i = 1; i < count; i++) {
+        uint64_t previous = ((uint64_t) PointDB_getUntimedType((TypeID) db->type[i - 1]) << 32) |
+                (uint32_t) db->ioa[i - 1];
+        uint64_t current = ((uint64_t) PointDB_getUntimedType((TypeID) db->type[i]) << 32) | (uint32_t) db->ioa[i];
+
+        CHECK(previous < current);
+    }
+
+    /* the counters form one range */
+    CHECK_EQUAL(db->counterCount, count / 3);
+
+    for (int i = 0; i < db->counterCount; i++)
+        CHECK_EQUAL(db->type[db->counterFirst + i], M_IT_NA_1);
+
+    PointDB_destroy(db);
+}
+
+static void
+checkGroups(void)
+{
+    PointDB db = PointDB_create();
+
+    for (int i = 0; i < 1000; i++) {
+        int idx = PointDB_add(db, M_SP_NA_1, 1 + i * 1024, 0);
+
+        /* point i is in group 1 + i % 16 */
+        PointDB_setGroups(db, idx, (uint16_t) (1 << (i % POINT_DB_MAX_GROUPS)));
+    }
+
+    PointDB_sort(db);
+
+    for (int group = 1; group <= POINT_DB_MAX_GROUPS; group++) {
+        int count;
+        const int32_t* points = PointDB_getGroupPoints(db, group, &count);
+
+        CHECK_EQUAL(count, (1000 - group) / POINT_DB_MAX_GROUPS + 1);
+
+        for (int i = 0; i < count; i++) {
+            CHECK_EQUAL(((db->ioa[points[i]] - 1) / 1024) % POINT_DB_MAX_GROUPS, group - 1);
+
+            if (i > 0)
+                CHECK(points[i] > points[i - 1]);
+        }
+    }
+
+    PointDB_destroy(db);
+}
+
+static void
+checkChangeTracking(void)
+{
+    PointDB db = PointDB_create();
+
+    for (int i = 0; i < 4 * POINT_DB_BLOCK_SIZE; i++)
+        PointDB_add(db, M_ME_NC_1, 100 + i, 0);
+
+    PointDB_sort(db);
+
+    uint64_t version = PointDB_getVersion(db);
+    PointValue value;
+    value.f = 1.5f;
+
+    CHECK(!PointDB_isChangedSince(db, 0, 4 * POINT_DB_BLOCK_SIZE - 1, version));
+
+    PointDB_lock(db);
+    PointDB_setValue(db, 2 * POINT_DB_BLOCK_SIZE + 3, value, IEC60870_QUALITY_GOOD, 0);
+    PointDB_unlock(db);
+
+    CHECK(PointDB_getVersion(db) > version);
+    CHECK(PointDB_isChangedSince(db, 2 * POINT_DB_BLOCK_SIZE, 3 * POINT_DB_BLOCK_SIZE - 1, version));
+    CHECK(PointDB_isChangedSince(db, 0, 4 * POINT_DB_BLOCK_SIZE - 1, version));
+    CHECK(!PointDB_isChangedSince(db, 0, 2 * POINT_DB_BLOCK_SIZE - 1, version));
+    CHECK(!PointDB_isChangedSince(db, 3 * POINT_DB_BLOCK_SIZE, 4 * POINT_DB_BLOCK_SIZE - 1, version));
+
+    PointDB_destroy(db);
+}
+
+int
+main(int argc, char** argv)
+{
+    for (int i = 0; i < (int) (sizeof(strides) / sizeof(strides[0])); i++)
+        checkStride(strides[i], (strides[i] == 65536) ? 255 : 5000);
+
+    checkGroups();
+    checkChangeTracking();
+
+    return CHECK_RESULT;
+}
@@ -0,0 +1,369 @@
+/*
+ * Binary point image: a written table, its indexes and GI responses come
+ * back unchanged; truncated, corrupted and inconsistent images are
+ * rejected by PointImage_open.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "point_image.h"
+#include "check.h"
+
+#define IMAGE_PATH "check_point_image.img"
+#define CORRUPT_PATH "check_point_image_corrupt.img"
+
+#define OA 3
+#define CA 17
+
+static uint8_t* imageData;
+static size_t imageSize;
+
+static PointDB
+createTable(void)
+{
+    PointDB db = PointDB_create();
+
+    /* strided IOAs of several types, runs and gaps */
+    for (int i = 0; i < 2000; i++) {
+        static const TypeID types[] = { M_SP_NA_1, M_DP_TB_1, M_ME_NC_1, M_ME_NB_1, M_IT_NA_1 };
+        TypeID type = types[i % 5];
+        int ioa = 1 + (i / 5) * 256 + (i % 5) * ((i % 7) ? 1 : 16);
+
+        int idx = PointDB_add(db, type, ioa, (float) (i % 100));
+
+        if (idx == -1)
+            continue;
+
+        PointDB_setGroups(db, idx, (uint16_t) (i * 7919));
+        db->increment[idx] = i % 13;
+    }
+
+    for (int i = 0; i < 50; i++) {
+        int idx = PointDB_add(db, C_SC_NA_1, 1000000 + i * 1024, 0);
+
+        db->flags[idx] = POINT_DB_FLAG_SELECT;
+        db->period[idx] = 1000 + i;
+        db->link[idx] = 1 + i * 256;
+        db->delay[idx] = 10 * i;
+    }
+
+    PointDB_sort(db);
+
+    return db;
+}
+
+static void
+createGICaches(PointDB db, CS101_AppLayerParameters alParams, GICache* giCaches)
+{
+    giCaches[0] = GICache_create(db, NULL, PointDB_getCount(db), alParams, CS101_COT_INTERROGATED_BY_STATION, OA, CA);
+
+    for (int group = 1; group <= POINT_DB_MAX_GROUPS; group++) {
+        int groupSize;
+        const int32_t* groupPoints = PointDB_getGroupPoints(db, group, &groupSize);
+
+        giCaches[group] = GICache_create(db, groupPoints, groupSize, alParams,
+                (CS101_CauseOfTransmission) (CS101_COT_INTERROGATED_BY_STATION + group), OA, CA);
+    }
+}
+
+static void
+compareTables(PointDB expected, PointDB actual)
+{
+    CHECK_EQUAL(actual->count, expected->count);
+    CHECK_EQUAL(actual->counterFirst, expected->counterFirst);
+    CHECK_EQUAL(actual->counterCount, expected->counterCount);
+
+    if (actual->count != expected->count)
+        return;
+
+    int count = expected->count;
+
+    CHECK(memcmp(actual->ioa, expected->ioa, count * sizeof(int32_t)) == 0);
+    CHECK(memcmp(actual->type, expected->type, count * sizeof(uint8_t)) == 0);
+    CHECK(memcmp(actual->value, expected->value, count * sizeof(PointValue)) == 0);
+    CHECK(memcmp(actual->quality, expected->quality, count * sizeof(uint8_t)) == 0);
+    CHECK(memcmp(actual->groups, expected->groups, count * sizeof(uint16_t)) == 0);
+    CHECK(memcmp(actual->increment, expected->increment, count * sizeof(int32_t)) == 0);
+    CHECK(memcmp(actual->flags, expected->flags, count * sizeof(uint8_t)) == 0);
+    CHECK(memcmp(actual->period, expected->period, count * sizeof(uint32_t)) == 0);
+    CHECK(memcmp(actual->link, expected->link, count * sizeof(int32_t)) == 0);
+    CHECK(memcmp(actual->delay, expected->delay, count * sizeof(uint32_t)) == 0);
+
+    for (int i = 0; i < count; i++)
+        CHECK_EQUAL(PointDB_lookup(actual, expected->ioa[i]), i);
+
+    CHECK_EQUAL(PointDB_lookup(actual, 200), -1);
+
+    for (int group = 1; group <= POINT_DB_MAX_GROUPS; group++) {
+        int expectedCount;
+        int actualCount;
+        const int32_t* expectedPoints = PointDB_getGroupPoints(expected, group, &expectedCount);
+        const int32_t* actualPoints = PointDB_getGroupPoints(actual, group, &actualCount);
+
+        CHECK_EQUAL(actualCount, expectedCount);
+
+        if (actualCount == expectedCount)
+            CHECK(memcmp(actualPoints, expectedPoints, actualCount * sizeof(int32_t)) == 0);
+    }
+
+    for (int group = 0; group <= POINT_DB_MAX_COUNTER_GROUPS; group++) {
+        CHECK_EQUAL(actual->counterGroupCount[group], expected->counterGroupCount[group]);
+
+        if (actual->counterGroupCount[group] == expected->counterGroupCount[group])
+            CHECK(memcmp(actual->counterGroupPoints[group], expected->counterGroupPoints[group],
+                    actual->counterGroupCount[group] * sizeof(int32_t)) == 0);
+    }
+}
+
+static void
+compareGICaches(GICache expected, GICache actual)
+{
+    CHECK(actual != NULL);
+
+    if (actual == NULL)
+        return;
+
+    CHECK_EQUAL(actual->frameCount, expected->frameCount);
+    CHECK_EQUAL(actual->pointCount, expected->pointCount);
+
+    for (int frame = 0; (frame < actual->frameCount) && (frame < expected->frameCount); frame++) {
+        GICacheEncodedFrame expectedLayout;
+        GICacheEncodedFrame actualLayout;
+
+        const uint8_t* expectedASDU = GICache_getEncodedFrame(expected, frame, &expectedLayout);
+        const uint8_t* actualASDU = GICache_getEncodedFrame(actual, frame, &actualLayout);
+
+        CHECK(memcmp(&actualLayout, &expectedLayout, sizeof(GICacheEncodedFrame)) == 0);
+
+        if (actualLayout.length == expectedLayout.length)
+            CHECK(memcmp(actualASDU, expectedASDU, actualLayout.length) == 0);
+    }
+}
+
+static void
+checkRoundTrip(void)
+{
+    CS104_Slave slave = CS104_Slave_create(10, 10);
+    CS101_AppLayerParameters alParams = CS104_Slave_getAppLayerParameters(slave);
+
+    PointDB db = createTable();
+    GICache giCaches[POINT_DB_MAX_GROUPS + 1];
+
+    createGICaches(db, alParams, giCaches);
+
+    CHECK(PointImage_write(IMAGE_PATH, db, NULL, giCaches));
+
+    PointImage image = PointImage_open(IMAGE_PATH);
+    CHECK(image != NULL);
+
+    if (image) {
+        PointDB mapped = PointImage_getPointDB(image);
+
+        compareTables(db, mapped);
+
+        for (int group = 0; group <= POINT_DB_MAX_GROUPS; group++) {
+            GICache cache = PointImage_createGICache(image, group, alParams, OA, CA);
+
+            compareGICaches(giCaches[group], cache);
+            GICache_destroy(cache);
+        }
+
+        /* responses encoded for other addresses are not used */
+        CHECK(PointImage_createGICache(image, 0, alParams, OA, CA + 1) == NULL);
+
+        /* a mapped table is fixed */
+        CHECK_EQUAL(PointDB_add(mapped, M_SP_NA_1, 200, 0), -1);
+
+        PointImage_destroy(image);
+        PointDB_destroy(mapped);
+    }
+
+    for (int group = 0; group <= POINT_DB_MAX_GROUPS; group++)
+        GICache_destroy(giCaches[group]);
+
+    PointDB_destroy(db);
+    CS104_Slave_destroy(slave);
+}
+
+static bool
+readImage(void)
+{
+    FILE* file = fopen(IMAGE_PATH, "rb");
+
+    if (file == NULL)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    imageSize = (size_t) ftell(file);
+    rewind(file);
+
+    imageData = (uint8_t*) malloc(imageSize + 8);
+
+    bool success = (imageData != NULL) && (fread(imageData, 1, imageSize, file) == imageSize);
+
+    fclose(file);
+
+    return success;
+}
+
+/* CRC-32 like the image writer, the checksum field counted as zero */
+static uint32_t
+getChecksum(const uint8_t* data, size_t size)
+{
+    uint32_t crc = 0xffffffffu;
+
+    for (size_t i = 0; i < size; i++) {
+        bool isChecksumField = (i >= offsetof(struct sPointImageHeader, checksum)) &&
+                (i < offsetof(struct sPointImageHeader, checksum) + sizeof(uint32_t));
+
+        crc ^= isChecksumField ? 0 : data[i];
+
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320u) : (crc >> 1);
+    }
+
+    return crc ^ 0xffffffffu;
+}
+
+/* write the modified copy, optionally with a valid checksum, and try to open it */
+static bool
+openModified(uint8_t* data, size_t size, bool fixChecksum)
+{
+    if (fixChecksum)
+        ((PointImageHeader) data)->checksum = getChecksum(data, size);
+
+    FILE* file = fopen(CORRUPT_PATH, "wb");
+
+    if (file == NULL)
+        return false;
+
+    fwrite(data, 1, size, file);
+    fclose(file);
+
+    PointImage image = PointImage_open(CORRUPT_PATH);
+
+    if (image == NULL)
+        return false;
+
+    PointImage_destroy(image);
+
+    return true;
+}
+
+/* a fresh copy of the image for every case */
+static uint8_t*
+copyImage(void)
+{
+    uint8_t* copy = (uint8_t*) malloc(imageSize + 8);
+
+    memcpy(copy, imageData, imageSize);
+    memset(copy + imageSize, 0, 8);
+
+    return copy;
+}
+
+static void
+checkCorruption(void)
+{
+    CHECK(readImage());
+
+    if (imageData == NULL)
+        return;
+
+    uint8_t* data = copyImage();
+    PointImageHeader header = (PointImageHeader) data;
+
+    /* the unmodified copy is valid, also with a recomputed checksum */
+    CHECK(openModified(data, imageSize, false));
+    CHECK(openModified(data, imageSize, true));
+    CHECK_EQUAL(header->checksum, ((PointImageHeader) imageData)->checksum);
+
+    /* empty, truncated and extended files */
+    CHECK(!openModified(data, 0, false));
+    CHECK(!openModified(data, sizeof(struct sPointImageHeader) - 1, false));
+    CHECK(!openModified(data, imageSize - 8, false));
+    CHECK(!openModified(data, imageSize + 8, false));
+
+    /* a flipped bit in the header, a column and the last byte */
+    size_t positions[] = { offsetof(struct sPointImageHeader, count), header->sections[POINT_IMAGE_VALUE].offset + 5,
+            imageSize - 1 };
+
+    for (int i = 0; i < 3; i++) {
+        free(data);
+        data = copyImage();
+        data[positions[i]] ^= 0x10;
+
+        CHECK(!openModified(data, imageSize, false));
+    }
+
+    /* magic and version */
+    free(data);
+    data = copyImage();
+    header = (PointImageHeader) data;
+    header->magic[0] = 'X';
+    CHECK(!openModified(data, imageSize, true));
+
+    free(data);
+    data = copyImage();
+    header = (PointImageHeader) data;
+    header->version++;
+    CHECK(!openModified(data, imageSize, true));
+
+    /* inconsistent headers with a valid checksum: counts and sections out of bounds */
+    for (int i = 0; i < 8; i++) {
+        free(data);
+        data = copyImage();
+        header = (PointImageHeader) data;
+
+        switch (i) {
+        case 0:
+            header->count = header->capacity + 1;
+            break;
+        case 1:
+            header->indexMask = (uint32_t) header->count - 1;
+            break;
+        case 2:
+            header->counterFirst = header->count;
+            break;
+        case 3:
+            header->groupCount[4] = header->count + 1;
+            break;
+        case 4:
+            header->giCount = POINT_DB_MAX_GROUPS + 2;
+            break;
+        case 5:
+            header->sections[POINT_IMAGE_IOA].offset = imageSize;
+            break;
+        case 6:
+            header->sections[POINT_IMAGE_TIMESTAMP].offset += 4;
+            break;
+        case 7:
+            header->sections[POINT_IMAGE_GI_ASDUS].size = imageSize;
+            break;
+        }
+
+        bool accepted = openModified(data, imageSize, true);
+
+        if (accepted)
+            printf("inconsistent header case %d accepted\n", i);
+
+        CHECK(!accepted);
+    }
+
+    free(data);
+    free(imageData);
+}
+
+int
+main(int argc, char** argv)
+{
+    checkRoundTrip();
+    checkCorruption();
+
+    remove(IMAGE_PATH);
+    remove(CORRUPT_PATH);
+
+    return CHECK_RESULT;
+}
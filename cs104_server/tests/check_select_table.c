@@ -0,0 +1,146 @@
+/*
+ * Select-before-operate table: selections of strided IOAs across growth,
+ * removal in the middle of probe chains, ownership, timeouts.
+ */
+
+#include <stdlib.h>
+
+#include "select_table.h"
+#include "check.h"
+
+#define COUNT 3000
+#define TIMEOUT 10000
+
+/* connections are only compared */
+static struct sIMasterConnection* const connectionA = (struct sIMasterConnection*) 0x1000;
+static struct sIMasterConnection* const connectionB = (struct sIMasterConnection*) 0x2000;
+
+static PointValue
+getValue(int i)
+{
+    PointValue value;
+    value.i = i & 1;
+
+    return value;
+}
+
+static void
+checkStride(int stride)
+{
+    TimerWheel wheel = TimerWheel_create(TimerWheel_getMonotonicTime());
+    SelectTable table = SelectTable_create(wheel);
+
+    for (int i = 0; i < COUNT; i++) {
+        IMasterConnection connection = (i % 5 == 0) ? connectionB : connectionA;
+
+        CHECK(SelectTable_select(table, 1 + i * stride, C_SC_NA_1, getValue(i), connection, TIMEOUT));
+    }
+
+    CHECK_EQUAL(SelectTable_getCount(table), COUNT);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), COUNT);
+
+    for (int i = 0; i < COUNT; i++)
+        CHECK(SelectTable_isSelected(table, 1 + i * stride));
+
+    CHECK(!SelectTable_isSelected(table, 1 + COUNT * stride));
+
+    /* reserved for the owner */
+    CHECK(!SelectTable_select(table, 1 + stride, C_SC_NA_1, getValue(1), connectionB, TIMEOUT));
+    CHECK(!SelectTable_execute(table, 1 + stride, C_SC_NA_1, getValue(1), connectionB));
+
+    /* the execute has to match type and value */
+    CHECK(!SelectTable_execute(table, 1 + stride, C_DC_NA_1, getValue(1), connectionA));
+    CHECK(!SelectTable_execute(table, 1 + stride, C_SC_NA_1, getValue(0), connectionA));
+
+    /* remove every third point: execute, cancel (deactivation) in turn */
+    int removed = 0;
+
+    for (int i = 0; i < COUNT; i += 3) {
+        IMasterConnection connection = (i % 5 == 0) ? connectionB : connectionA;
+
+        if (i % 2)
+            CHECK(SelectTable_execute(table, 1 + i * stride, C_SC_NA_1, getValue(i), connection));
+        else
+            CHECK(SelectTable_cancel(table, 1 + i * stride, C_SC_NA_1, connection));
+
+        removed++;
+    }
+
+    CHECK_EQUAL(SelectTable_getCount(table), COUNT - removed);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), COUNT - removed);
+
+    /* the chains were closed without losing the entries behind the gaps */
+    for (int i = 0; i < COUNT; i++)
+        CHECK_EQUAL(SelectTable_isSelected(table, 1 + i * stride), (i % 3) != 0);
+
+    /* a selection executes once */
+    CHECK(!SelectTable_execute(table, 1 + 3 * stride, C_SC_NA_1, getValue(3), connectionA));
+
+    /* a closed connection drops its selections only */
+    SelectTable_removeConnection(table, connectionB);
+
+    int remaining = 0;
+
+    for (int i = 0; i < COUNT; i++) {
+        bool expected = ((i % 3) != 0) && ((i % 5) != 0);
+
+        CHECK_EQUAL(SelectTable_isSelected(table, 1 + i * stride), expected);
+
+        if (expected)
+            remaining++;
+    }
+
+    CHECK_EQUAL(SelectTable_getCount(table), remaining);
+
+    /* the rest runs into the timeout */
+    TimerWheel_advance(wheel, TimerWheel_getMonotonicTime() + TIMEOUT + 1);
+
+    CHECK_EQUAL(SelectTable_getCount(table), 0);
+    CHECK_EQUAL(table->timeouts, remaining);
+
+    for (int i = 0; i < COUNT; i++)
+        CHECK(!SelectTable_isSelected(table, 1 + i * stride));
+
+    SelectTable_destroy(table);
+
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 0);
+
+    TimerWheel_destroy(wheel);
+}
+
+/* a repeated select of the owner restarts the timeout */
+static void
+checkReselect(void)
+{
+    uint64_t start = TimerWheel_getMonotonicTime();
+    TimerWheel wheel = TimerWheel_create(start);
+    SelectTable table = SelectTable_create(wheel);
+
+    CHECK(SelectTable_select(table, 100, C_SE_NC_1, getValue(0), connectionA, TIMEOUT));
+    CHECK(SelectTable_select(table, 100, C_SE_NC_1, getValue(0), connectionA, 3 * TIMEOUT));
+
+    CHECK_EQUAL(SelectTable_getCount(table), 1);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 1);
+
+    TimerWheel_advance(wheel, start + 2 * TIMEOUT);
+    CHECK(SelectTable_isSelected(table, 100));
+
+    TimerWheel_advance(wheel, TimerWheel_getMonotonicTime() + 3 * TIMEOUT + 1);
+    CHECK(!SelectTable_isSelected(table, 100));
+    CHECK_EQUAL(table->timeouts, 1);
+
+    SelectTable_destroy(table);
+    TimerWheel_destroy(wheel);
+}
+
+int
+main(int argc, char** argv)
+{
+    checkStride(1);
+    checkStride(256);
+    checkStride(1024);
+    checkStride(4096);
+    checkReselect();
+
+    return CHECK_RESULT;
+}
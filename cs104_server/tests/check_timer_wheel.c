@@ -0,0 +1,183 @@
+/*
+ * Timer wheel: expiries on every level and across the cascade boundaries,
+ * cancellation of pending and running timers, periodic re-arming.
+ */
+
+#include <stdlib.h>
+
+#include "timer_wheel.h"
+#include "check.h"
+
+#define START 1000003       /* not aligned to a slot boundary */
+
+typedef struct {
+    TimerWheel wheel;
+    int fired;
+    uint64_t expiry;        /* of the last call */
+    uint64_t firedAt;       /* wheel time of the last call */
+    int cancel;             /* timer cancelled by the handler, -1 for none */
+} Probe;
+
+static void
+probeHandler(void* parameter, uint64_t expiry)
+{
+    Probe* probe = (Probe*) parameter;
+
+    probe->fired++;
+    probe->expiry = expiry;
+    probe->firedAt = probe->wheel->time;
+
+    if (probe->cancel != -1)
+        TimerWheel_cancel(probe->wheel, probe->cancel);
+}
+
+static void
+initProbe(Probe* probe, TimerWheel wheel)
+{
+    probe->wheel = wheel;
+    probe->fired = 0;
+    probe->expiry = 0;
+    probe->firedAt = 0;
+    probe->cancel = -1;
+}
+
+/* every timer fires exactly at its expiry, not a tick early or late */
+static void
+checkLevels(void)
+{
+    static const uint64_t offsets[] = {
+        1, 2, 255, 256, 257, 511, 512, 65535, 65536, 65537, 70000,
+        16777215, 16777216, 16777217, 20000000, 4294967295ULL, 4294967296ULL
+    };
+    int count = (int) (sizeof(offsets) / sizeof(offsets[0]));
+
+    TimerWheel wheel = TimerWheel_create(START);
+    Probe* probes = (Probe*) calloc(count, sizeof(Probe));
+
+    for (int i = 0; i < count; i++) {
+        initProbe(&probes[i], wheel);
+        CHECK(TimerWheel_add(wheel, START + offsets[i], 0, probeHandler, &probes[i]) >= 0);
+    }
+
+    CHECK_EQUAL(TimerWheel_getCount(wheel), count);
+
+    for (int i = 0; i < count; i++) {
+        uint64_t expiry = START + offsets[i];
+
+        CHECK(TimerWheel_getNextExpiry(wheel) <= expiry);
+
+        TimerWheel_advance(wheel, expiry - 1);
+        CHECK_EQUAL(probes[i].fired, 0);
+
+        CHECK_EQUAL(TimerWheel_advance(wheel, expiry), 1);
+        CHECK_EQUAL(probes[i].fired, 1);
+        CHECK_EQUAL(probes[i].expiry, expiry);
+        CHECK_EQUAL(probes[i].firedAt, expiry);
+    }
+
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 0);
+    CHECK(TimerWheel_getNextExpiry(wheel) == UINT64_MAX);
+
+    free(probes);
+    TimerWheel_destroy(wheel);
+}
+
+/* a single advance over all levels fires every timer once, in order */
+static void
+checkCascade(void)
+{
+    TimerWheel wheel = TimerWheel_create(START);
+    Probe probes[300];
+
+    /* strided over level 0 to level 2 */
+    for (int i = 0; i < 300; i++) {
+        initProbe(&probes[i], wheel);
+        TimerWheel_add(wheel, START + 1 + (uint64_t) i * 997, 0, probeHandler, &probes[i]);
+    }
+
+    CHECK_EQUAL(TimerWheel_advance(wheel, START + 300 * 997), 300);
+
+    for (int i = 0; i < 300; i++) {
+        CHECK_EQUAL(probes[i].fired, 1);
+        CHECK_EQUAL(probes[i].firedAt, START + 1 + (uint64_t) i * 997);
+    }
+
+    TimerWheel_destroy(wheel);
+}
+
+static void
+checkCancel(void)
+{
+    TimerWheel wheel = TimerWheel_create(START);
+    Probe probes[6];
+    int timers[6];
+
+    /* two timers on each of level 0, 1 and 2 */
+    static const uint64_t offsets[] = { 10, 20, 1000, 2000, 100000, 200000 };
+
+    for (int i = 0; i < 6; i++) {
+        initProbe(&probes[i], wheel);
+        timers[i] = TimerWheel_add(wheel, START + offsets[i], 0, probeHandler, &probes[i]);
+    }
+
+    TimerWheel_cancel(wheel, timers[0]);
+    TimerWheel_cancel(wheel, timers[3]);
+    TimerWheel_cancel(wheel, timers[4]);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 3);
+
+    /* a handler cancels a timer of a higher level */
+    probes[1].cancel = timers[5];
+
+    TimerWheel_advance(wheel, START + 300000);
+
+    CHECK_EQUAL(probes[0].fired, 0);
+    CHECK_EQUAL(probes[1].fired, 1);
+    CHECK_EQUAL(probes[2].fired, 1);
+    CHECK_EQUAL(probes[3].fired, 0);
+    CHECK_EQUAL(probes[4].fired, 0);
+    CHECK_EQUAL(probes[5].fired, 0);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 0);
+
+    /* cancelled ids are reused */
+    CHECK(TimerWheel_add(wheel, START + 300010, 0, probeHandler, &probes[0]) >= 0);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 1);
+
+    TimerWheel_destroy(wheel);
+}
+
+/* periodic timers keep their phase, a handler can stop its own timer */
+static void
+checkPeriodic(void)
+{
+    TimerWheel wheel = TimerWheel_create(START);
+    Probe periodic;
+    Probe stopping;
+
+    initProbe(&periodic, wheel);
+    initProbe(&stopping, wheel);
+
+    TimerWheel_add(wheel, START + 100, 300, probeHandler, &periodic);
+    stopping.cancel = TimerWheel_add(wheel, START + 50, 50, probeHandler, &stopping);
+
+    for (uint64_t now = START; now <= START + 100000; now += 7)
+        TimerWheel_advance(wheel, now);
+
+    /* expiries 100, 400, ... up to 99700 */
+    CHECK_EQUAL(periodic.fired, 333);
+    CHECK_EQUAL(periodic.expiry, START + 99700);
+    CHECK_EQUAL(stopping.fired, 1);
+    CHECK_EQUAL(TimerWheel_getCount(wheel), 1);
+
+    TimerWheel_destroy(wheel);
+}
+
+int
+main(int argc, char** argv)
+{
+    checkLevels();
+    checkCascade();
+    checkCancel();
+    checkPeriodic();
+
+    return CHECK_RESULT;
+}
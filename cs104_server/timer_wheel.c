@@ -0,0 +1,298 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "timer_wheel.h"
+
+#define TIMER_STATE_FREE -1
+#define TIMER_STATE_RUNNING -2      /* handler is being called */
+#define TIMER_STATE_CANCELLED -3    /* cancelled by its own handler */
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+
+#define INITIAL_CAPACITY 64
+
+static bool
+grow(TimerWheel self)
+{
+    int newCapacity = (self->capacity > 0) ? (self->capacity * 2) : INITIAL_CAPACITY;
+
+    TimerWheelTimer timers = (TimerWheelTimer) realloc(self->timers, newCapacity * sizeof(struct sTimerWheelTimer));
+
+    if (timers == NULL)
+        return false;
+
+    int i;
+    for (i = self->capacity; i < newCapacity; i++) {
+        timers[i].slot = TIMER_STATE_FREE;
+        timers[i].next = (i + 1 < newCapacity) ? (i + 1) : self->freeList;
+    }
+
+    self->freeList = self->capacity;
+    self->timers = timers;
+    self->capacity = newCapacity;
+
+    return true;
+}
+
+TimerWheel
+TimerWheel_create(uint64_t now)
+{
+    TimerWheel self = (TimerWheel) calloc(1, sizeof(struct sTimerWheel));
+
+    if (self) {
+        self->time = now;
+        self->freeList = -1;
+
+        memset(self->slots, 0xff, sizeof(self->slots));
+    }
+
+    return self;
+}
+
+void
+TimerWheel_destroy(TimerWheel self)
+{
+    if (self) {
+        free(self->timers);
+        free(self);
+    }
+}
+
+/* link the timer into the slot for its expiry (expiry >= self->time) */
+static void
+linkTimer(TimerWheel self, int id)
+{
+    TimerWheelTimer timer = &(self->timers[id]);
+
+    uint64_t delta = timer->expiry - self->time;
+    int level = 0;
+
+    while ((level < TIMER_WHEEL_LEVELS - 1) && (delta >= ((uint64_t) 1 << (TIMER_WHEEL_SLOT_BITS * (level + 1)))))
+        level++;
+
+    if (delta >= ((uint64_t) 1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))) {
+        /* beyond the range of the wheel -> park in the last slot and check again when cascaded */
+        level = TIMER_WHEEL_LEVELS - 1;
+        delta = ((uint64_t) 1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS)) - 1;
+    }
+
+    int slot = (int) (((self->time + delta) >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK);
+    int index = level * TIMER_WHEEL_SLOTS + slot;
+
+    timer->slot = (int16_t) index;
+    timer->prev = -1;
+    timer->next = self->slots[index];
+
+    if (timer->next != -1)
+        self->timers[timer->next].prev = id;
+
+    self->slots[index] = id;
+    self->levelCount[level]++;
+
+    if (level == 0)
+        self->occupied[slot >> 6] |= ((uint64_t) 1 << (slot & 63));
+}
+
+static void
+unlinkTimer(TimerWheel self, int id)
+{
+    TimerWheelTimer timer = &(self->timers[id]);
+    int index = timer->slot;
+
+    if (timer->prev != -1)
+        self->timers[timer->prev].next = timer->next;
+    else
+        self->slots[index] = timer->next;
+
+    if (timer->next != -1)
+        self->timers[timer->next].prev = timer->prev;
+
+    self->levelCount[index / TIMER_WHEEL_SLOTS]--;
+
+    if ((index < TIMER_WHEEL_SLOTS) && (self->slots[index] == -1))
+        self->occupied[index >> 6] &= ~((uint64_t) 1 << (index & 63));
+}
+
+static void
+release(TimerWheel self, int id)
+{
+    self->timers[id].slot = TIMER_STATE_FREE;
+    self->timers[id].next = self->freeList;
+    self->freeList = id;
+    self->activeCount--;
+}
+
+int
+TimerWheel_add(TimerWheel self, uint64_t expiry, uint32_t period, TimerWheel_Handler handler, void* parameter)
+{
+    if (self->freeList == -1) {
+        if (!grow(self))
+            return -1;
+    }
+
+    int id = self->freeList;
+    TimerWheelTimer timer = &(self->timers[id]);
+
+    self->freeList = timer->next;
+    self->activeCount++;
+
+    /* the tick at self->time is already processed */
+    timer->expiry = (expiry > self->time) ? expiry : (self->time + 1);
+    timer->period = period;
+    timer->handler = handler;
+    timer->parameter = parameter;
+
+    linkTimer(self, id);
+
+    return id;
+}
+
+void
+TimerWheel_cancel(TimerWheel self, int timer)
+{
+    if ((timer < 0) || (timer >= self->capacity))
+        return;
+
+    int16_t state = self->timers[timer].slot;
+
+    if (state >= 0) {
+        unlinkTimer(self, timer);
+        release(self, timer);
+    }
+    else if (state == TIMER_STATE_RUNNING)
+        self->timers[timer].slot = TIMER_STATE_CANCELLED;
+}
+
+/* move the timers of a slot of a higher level to the levels below */
+static void
+cascade(TimerWheel self, int level, int slot)
+{
+    int index = level * TIMER_WHEEL_SLOTS + slot;
+    int id = self->slots[index];
+
+    self->slots[index] = -1;
+
+    while (id != -1) {
+        int next = self->timers[id].next;
+
+        self->levelCount[level]--;
+        linkTimer(self, id);
+
+        id = next;
+    }
+}
+
+static int
+fireSlot(TimerWheel self, int slot)
+{
+    int fired = 0;
+
+    /* handlers never add timers to this slot: new expiries are > self->time */
+    while (self->slots[slot] != -1) {
+        int id = self->slots[slot];
+
+        unlinkTimer(self, id);
+
+        TimerWheelTimer timer = &(self->timers[id]);
+        uint64_t expiry = timer->expiry;
+
+        timer->slot = TIMER_STATE_RUNNING;
+        timer->handler(timer->parameter, expiry);
+        fired++;
+
+        /* the handler may have added timers -> the array may have moved */
+        timer = &(self->timers[id]);
+
+        if ((timer->slot == TIMER_STATE_RUNNING) && (timer->period > 0)) {
+            timer->expiry = expiry + timer->period;
+
+            /* don't try to catch up when the handler or the caller fell behind */
+            if (timer->expiry <= self->time)
+                timer->expiry = self->time + 1;
+
+            linkTimer(self, id);
+        }
+        else
+            release(self, id);
+    }
+
+    return fired;
+}
+
+int
+TimerWheel_advance(TimerWheel self, uint64_t now)
+{
+    int fired = 0;
+
+    while (self->time < now) {
+        if ((self->occupied[0] | self->occupied[1] | self->occupied[2] | self->occupied[3]) == 0) {
+            /* level 0 is empty -> skip to the next cascade (or to now) */
+            uint64_t boundary = (self->time | SLOT_MASK) + 1;
+
+            if ((self->levelCount[1] | self->levelCount[2] | self->levelCount[3]) == 0) {
+                self->time = now;
+                break;
+            }
+
+            if (boundary > now) {
+                self->time = now;
+                break;
+            }
+
+            self->time = boundary - 1;
+        }
+
+        uint64_t tick = self->time + 1;
+
+        self->time = tick;
+
+        if ((tick & SLOT_MASK) == 0) {
+            int level;
+            for (level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                int slot = (int) ((tick >> (TIMER_WHEEL_SLOT_BITS * level)) & SLOT_MASK);
+
+                cascade(self, level, slot);
+
+                if (slot != 0)
+                    break;
+            }
+        }
+
+        fired += fireSlot(self, (int) (tick & SLOT_MASK));
+    }
+
+    return fired;
+}
+
+uint64_t
+TimerWheel_getNextExpiry(TimerWheel self)
+{
+    if (self->activeCount == 0)
+        return UINT64_MAX;
+
+    uint64_t boundary = (self->time | SLOT_MASK) + 1;
+
+    uint64_t tick;
+    for (tick = self->time + 1; tick <= self->time + SLOT_MASK; tick++) {
+        int slot = (int) (tick & SLOT_MASK);
+
+        if (self->occupied[slot >> 6] & ((uint64_t) 1 << (slot & 63)))
+            return tick;
+
+        /* timers of the higher levels can't expire before the next cascade */
+        if ((tick == boundary) && (self->levelCount[1] | self->levelCount[2] | self->levelCount[3]))
+            return tick;
+    }
+
+    return boundary;
+}
+
+uint64_t
+TimerWheel_getMonotonicTime(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * 1000 + (uint64_t) (ts.tv_nsec / 1000000);
+}
@@ -0,0 +1,115 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Hierarchical timer wheel with millisecond resolution.
+ *
+ * Four levels of 256 slots: level 0 holds the timers of the next 256 ms
+ * with one slot per millisecond, every higher level covers 256 times the
+ * range of the level below (65 s, 4.6 h, 49 days). Adding and cancelling a
+ * timer is O(1). When level 0 wraps around, the due slot of the next level
+ * is moved down (cascaded). Ticks without timers are skipped, so advancing
+ * over a long idle period is cheap.
+ *
+ * Timers live in one growing array and are linked by index, which keeps
+ * the overhead at ~40 bytes per timer and allows millions of timers.
+ *
+ * The wheel is not thread safe. Handlers may add and cancel timers,
+ * including their own.
+ */
+
+/**
+ * \param expiry the time the timer was scheduled for (ms)
+ */
+typedef void (*TimerWheel_Handler)(void* parameter, uint64_t expiry);
+
+typedef struct sTimerWheel* TimerWheel;
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_SLOT_BITS 8
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_SLOT_BITS)
+
+typedef struct sTimerWheelTimer* TimerWheelTimer;
+
+struct sTimerWheelTimer {
+    uint64_t expiry;
+    uint32_t period;            /* 0 = one shot */
+    int32_t next;               /* slot list / free list links */
+    int32_t prev;
+    int16_t slot;               /* level * TIMER_WHEEL_SLOTS + slot, or a TIMER_STATE_* value */
+    TimerWheel_Handler handler;
+    void* parameter;
+};
+
+struct sTimerWheel {
+    uint64_t time;              /* all timers up to this time have fired */
+
+    TimerWheelTimer timers;
+    int capacity;
+    int freeList;
+    int activeCount;
+
+    int32_t slots[TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS];    /* list heads */
+    int levelCount[TIMER_WHEEL_LEVELS];
+
+    uint64_t occupied[TIMER_WHEEL_SLOTS / 64];                /* non-empty level 0 slots */
+};
+
+/**
+ * \param now start time of the wheel (ms)
+ */
+TimerWheel
+TimerWheel_create(uint64_t now);
+
+void
+TimerWheel_destroy(TimerWheel self);
+
+/**
+ * Add a timer. An expiry in the past fires with the next tick.
+ *
+ * \param expiry time of the first expiry (ms)
+ * \param period re-arm interval in ms after each expiry, 0 for a one shot timer
+ *
+ * \return the timer id, or -1 when out of memory
+ */
+int
+TimerWheel_add(TimerWheel self, uint64_t expiry, uint32_t period, TimerWheel_Handler handler, void* parameter);
+
+/**
+ * Cancel a pending timer. The id must not be used afterwards.
+ */
+void
+TimerWheel_cancel(TimerWheel self, int timer);
+
+/**
+ * Fire all timers that expire up to now. Periodic timers are re-armed
+ * relative to their expiry, so they don't drift.
+ *
+ * \return number of fired timers
+ */
+int
+TimerWheel_advance(TimerWheel self, uint64_t now);
+
+/**
+ * \return a lower bound of the next expiry (exact when the timer is within
+ *         the next 256 ms), or UINT64_MAX when no timer is pending
+ */
+uint64_t
+TimerWheel_getNextExpiry(TimerWheel self);
+
+static inline int
+TimerWheel_getCount(TimerWheel self)
+{
+    return self->activeCount;
+}
+
+/**
+ * \return monotonic time in ms (not related to the wall clock)
+ */
+uint64_t
+TimerWheel_getMonotonicTime(void);
+
+#endif /* TIMER_WHEEL_H_ */